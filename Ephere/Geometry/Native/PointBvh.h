@@ -0,0 +1,337 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Matrix.h"
+#include "Ephere/NativeTools/MacroTools.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace Ephere { namespace Geometry
+{
+
+/*! Bounding volume hierarchy over points, for nearest neighbor and radius queries.
+
+The hierarchy is built like a k-d tree, splitting the points at the median along the longest axis of their bounds, but every node stores the bounds of its
+points instead of a split plane. This allows Refit() to move the points without rebuilding: the queries stay exact and only lose some speed if the points
+move a lot relative to each other. Nodes are stored depth first with the first child following its parent, and the points are copied in the same order,
+so the points of a leaf are contiguous in memory.
+*/
+template <unsigned N>
+class PointBvh
+{
+public:
+
+	typedef Matrix<N, 1, float> Point;
+
+	enum
+	{
+		MaxLeafSize = 8
+	};
+
+	PointBvh()
+	{
+	}
+
+	void Build( Point const* points, int count )
+	{
+		nodes_.clear();
+		order_.resize( count );
+		for( auto index = 0; index < count; ++index )
+		{
+			order_[index] = index;
+		}
+
+		if( count > 0 )
+		{
+			nodes_.reserve( 2 * ( count / MaxLeafSize + 1 ) );
+			BuildNode( points, 0, count );
+		}
+
+		points_.resize( count );
+		for( auto index = 0; index < count; ++index )
+		{
+			points_[index] = points[order_[index]];
+		}
+	}
+
+	/*! Updates the bounds for new positions of the points the hierarchy was built with
+	@return False if the number of points differs, the hierarchy needs to be rebuilt then
+	*/
+	bool Refit( Point const* points, int count )
+	{
+		if( count != GetPointCount() )
+		{
+			return false;
+		}
+
+		for( auto index = 0; index < count; ++index )
+		{
+			points_[index] = points[order_[index]];
+		}
+
+		// Children follow their parents, so going backwards visits them first
+		for( auto nodeIndex = static_cast<int>( nodes_.size() ) - 1; nodeIndex >= 0; --nodeIndex )
+		{
+			auto& node = nodes_[nodeIndex];
+			if( node.IsLeaf() )
+			{
+				SetBounds( node, node.first, node.first + node.count );
+			}
+			else
+			{
+				auto const& first = nodes_[nodeIndex + 1];
+				auto const& second = nodes_[node.secondChild];
+				for( unsigned axis = 0; axis < N; ++axis )
+				{
+					node.minimum[axis] = std::min( first.minimum[axis], second.minimum[axis] );
+					node.maximum[axis] = std::max( first.maximum[axis], second.maximum[axis] );
+				}
+			}
+		}
+
+		return true;
+	}
+
+	EPHERE_NODISCARD int GetPointCount() const
+	{
+		return static_cast<int>( points_.size() );
+	}
+
+	/*! Finds up to maxCount points closest to position, nearest first
+	@param indices Receives the indices of the points as passed to Build()
+	@param squaredDistances Receives the squared distances of the points, can be null
+	@param maxDistance Points further away are not considered, nor are points whose squared distance overflows
+	@return Number of points found
+	*/
+	int FindNearest( Point const& position, int maxCount, int* indices, float* squaredDistances = nullptr,
+		float maxDistance = std::numeric_limits<float>::max() ) const
+	{
+		if( nodes_.empty() || maxCount <= 0 )
+		{
+			return 0;
+		}
+
+		// Few neighbors are asked for, so keeping the results sorted by insertion beats a heap. Distances go to a local buffer if not requested.
+		std::vector<float> distanceBuffer;
+		float localDistances[16];
+		if( squaredDistances == nullptr )
+		{
+			if( maxCount > 16 )
+			{
+				distanceBuffer.resize( maxCount );
+			}
+
+			squaredDistances = maxCount > 16 ? distanceBuffer.data() : localDistances;
+		}
+
+		// Points whose squared distance overflows are never found
+		auto foundCount = 0;
+		auto limit = std::min( maxDistance * maxDistance, std::numeric_limits<float>::max() );
+
+		int stack[64];
+		auto stackSize = 0;
+		stack[stackSize++] = 0;
+		while( stackSize > 0 )
+		{
+			auto const& node = nodes_[stack[--stackSize]];
+			if( GetSquaredDistance( node, position ) > limit )
+			{
+				continue;
+			}
+
+			if( node.IsLeaf() )
+			{
+				for( auto index = node.first; index < node.first + node.count; ++index )
+				{
+					auto const distance = GetSquaredDistance( points_[index], position );
+					if( distance > limit || ( foundCount == maxCount && distance >= limit ) )
+					{
+						continue;
+					}
+
+					auto slot = std::min( foundCount, maxCount - 1 );
+					for( ; slot > 0 && squaredDistances[slot - 1] > distance; --slot )
+					{
+						squaredDistances[slot] = squaredDistances[slot - 1];
+						indices[slot] = indices[slot - 1];
+					}
+
+					squaredDistances[slot] = distance;
+					indices[slot] = order_[index];
+					foundCount = std::min( foundCount + 1, maxCount );
+					if( foundCount == maxCount )
+					{
+						limit = squaredDistances[maxCount - 1];
+					}
+				}
+
+				continue;
+			}
+
+			// Visit the nearer child first by pushing it last
+			auto const firstChild = static_cast<int>( &node - nodes_.data() ) + 1;
+			auto const secondChild = node.secondChild;
+			auto const isFirstNearer = GetSquaredDistance( nodes_[firstChild], position ) <= GetSquaredDistance( nodes_[secondChild], position );
+			stack[stackSize++] = isFirstNearer ? secondChild : firstChild;
+			stack[stackSize++] = isFirstNearer ? firstChild : secondChild;
+		}
+
+		return foundCount;
+	}
+
+	//! Appends the indices of all points within radius of position to result, in no particular order
+	void FindInRadius( Point const& position, float radius, std::vector<int>& result ) const
+	{
+		if( nodes_.empty() )
+		{
+			return;
+		}
+
+		auto const squaredRadius = radius * radius;
+		int stack[64];
+		auto stackSize = 0;
+		stack[stackSize++] = 0;
+		while( stackSize > 0 )
+		{
+			auto const nodeIndex = stack[--stackSize];
+			auto const& node = nodes_[nodeIndex];
+			if( GetSquaredDistance( node, position ) > squaredRadius )
+			{
+				continue;
+			}
+
+			if( node.IsLeaf() )
+			{
+				for( auto index = node.first; index < node.first + node.count; ++index )
+				{
+					if( GetSquaredDistance( points_[index], position ) <= squaredRadius )
+					{
+						result.push_back( order_[index] );
+					}
+				}
+			}
+			else
+			{
+				stack[stackSize++] = node.secondChild;
+				stack[stackSize++] = nodeIndex + 1;
+			}
+		}
+	}
+
+private:
+
+	struct Node
+	{
+		float minimum[N];
+		float maximum[N];
+
+		//! Range of points of leaves, count is 0 for inner nodes
+		int first;
+		int count;
+
+		//! Index of the second child of inner nodes, the first one follows the node
+		int secondChild;
+
+		bool IsLeaf() const
+		{
+			return count > 0;
+		}
+	};
+
+	static float GetSquaredDistance( Point const& point, Point const& position )
+	{
+		auto result = 0.0f;
+		for( unsigned axis = 0; axis < N; ++axis )
+		{
+			auto const difference = point[axis] - position[axis];
+			result += difference * difference;
+		}
+
+		return result;
+	}
+
+	static float GetSquaredDistance( Node const& node, Point const& position )
+	{
+		auto result = 0.0f;
+		for( unsigned axis = 0; axis < N; ++axis )
+		{
+			auto const difference = std::max( std::max( node.minimum[axis] - position[axis], position[axis] - node.maximum[axis] ), 0.0f );
+			result += difference * difference;
+		}
+
+		return result;
+	}
+
+	// Bounds of points_[begin, end), used by Refit() once points_ is in tree order
+	void SetBounds( Node& node, int begin, int end ) const
+	{
+		for( unsigned axis = 0; axis < N; ++axis )
+		{
+			node.minimum[axis] = std::numeric_limits<float>::max();
+			node.maximum[axis] = -std::numeric_limits<float>::max();
+			for( auto index = begin; index < end; ++index )
+			{
+				node.minimum[axis] = std::min( node.minimum[axis], points_[index][axis] );
+				node.maximum[axis] = std::max( node.maximum[axis], points_[index][axis] );
+			}
+		}
+	}
+
+	// Median splits keep the depth at log2 of the point count, well within the query stacks
+	int BuildNode( Point const* points, int begin, int end )
+	{
+		auto const nodeIndex = static_cast<int>( nodes_.size() );
+		nodes_.push_back( Node() );
+
+		Node node;
+		node.first = begin;
+		node.count = 0;
+		node.secondChild = -1;
+		for( unsigned axis = 0; axis < N; ++axis )
+		{
+			node.minimum[axis] = std::numeric_limits<float>::max();
+			node.maximum[axis] = -std::numeric_limits<float>::max();
+			for( auto index = begin; index < end; ++index )
+			{
+				node.minimum[axis] = std::min( node.minimum[axis], points[order_[index]][axis] );
+				node.maximum[axis] = std::max( node.maximum[axis], points[order_[index]][axis] );
+			}
+		}
+
+		if( end - begin <= MaxLeafSize )
+		{
+			node.count = end - begin;
+			nodes_[nodeIndex] = node;
+			return nodeIndex;
+		}
+
+		unsigned splitAxis = 0;
+		for( unsigned axis = 1; axis < N; ++axis )
+		{
+			if( node.maximum[axis] - node.minimum[axis] > node.maximum[splitAxis] - node.minimum[splitAxis] )
+			{
+				splitAxis = axis;
+			}
+		}
+
+		auto const middle = begin + ( end - begin ) / 2;
+		std::nth_element( order_.begin() + begin, order_.begin() + middle, order_.begin() + end, [points, splitAxis]( int left, int right )
+		{
+			return points[left][splitAxis] < points[right][splitAxis];
+		} );
+
+		BuildNode( points, begin, middle );
+		node.secondChild = BuildNode( points, middle, end );
+		nodes_[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	std::vector<Node> nodes_;
+	std::vector<int> order_;
+	std::vector<Point> points_;
+};
+
+} }
@@ -0,0 +1,475 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Matrix.h"
+#include "Ephere/NativeTools/MacroTools.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Ephere { namespace Geometry
+{
+
+/*! Bounding volume hierarchy over triangles, for intersecting segments and polylines with meshes.
+
+Triangles are split at the median of their centroids along the longest axis of the node, like PointBvh. The hierarchy keeps the vertices and refers to
+them by index, so when only the vertices move Refit() updates the bounds in linear time instead of rebuilding it. Nodes are stored depth first with the
+first child following its parent.
+*/
+class TriangleBvh
+{
+public:
+
+	typedef std::array<int, 3> Triangle;
+
+	enum
+	{
+		MaxLeafSize = 4,
+
+		//! Groups of segments culled separately by FindFirstIntersectingSegment(), one bit each
+		MaxSegmentGroupCount = 32
+	};
+
+	TriangleBvh()
+	{
+	}
+
+	void Build( Vector3f const* vertices, int vertexCount, Triangle const* triangles, int triangleCount )
+	{
+		vertices_.assign( vertices, vertices + vertexCount );
+		nodes_.clear();
+		triangles_.resize( triangleCount );
+		triangleIndices_.resize( triangleCount );
+		for( auto index = 0; index < triangleCount; ++index )
+		{
+			triangleIndices_[index] = index;
+		}
+
+		if( triangleCount > 0 )
+		{
+			std::vector<Vector3f> centroids( triangleCount );
+			for( auto index = 0; index < triangleCount; ++index )
+			{
+				auto const& triangle = triangles[index];
+				for( unsigned axis = 0; axis < 3; ++axis )
+				{
+					centroids[index][axis] = ( vertices[triangle[0]][axis] + vertices[triangle[1]][axis] + vertices[triangle[2]][axis] ) / 3;
+				}
+			}
+
+			nodes_.reserve( 2 * ( triangleCount / MaxLeafSize + 1 ) );
+			BuildNode( centroids, 0, triangleCount );
+		}
+
+		for( auto index = 0; index < triangleCount; ++index )
+		{
+			triangles_[index] = triangles[triangleIndices_[index]];
+		}
+
+		for( auto nodeIndex = static_cast<int>( nodes_.size() ) - 1; nodeIndex >= 0; --nodeIndex )
+		{
+			UpdateBounds( nodeIndex );
+		}
+	}
+
+	/*! Updates the hierarchy for new positions of the vertices it was built with
+	@return False if the number of vertices differs, the hierarchy needs to be rebuilt then
+	*/
+	bool Refit( Vector3f const* vertices, int vertexCount )
+	{
+		if( vertexCount != static_cast<int>( vertices_.size() ) )
+		{
+			return false;
+		}
+
+		vertices_.assign( vertices, vertices + vertexCount );
+
+		// Children follow their parents, so going backwards visits them first
+		for( auto nodeIndex = static_cast<int>( nodes_.size() ) - 1; nodeIndex >= 0; --nodeIndex )
+		{
+			UpdateBounds( nodeIndex );
+		}
+
+		return true;
+	}
+
+	EPHERE_NODISCARD int GetTriangleCount() const
+	{
+		return static_cast<int>( triangles_.size() );
+	}
+
+	EPHERE_NODISCARD int GetVertexCount() const
+	{
+		return static_cast<int>( vertices_.size() );
+	}
+
+	/*! Finds the first intersection of the segment from start to end with the triangles
+	@param parameter Receives the position of the intersection along the segment, from 0 at start to 1 at end
+	@param triangleIndex Receives the index of the triangle as passed to Build()
+	*/
+	bool IntersectSegment( Vector3f const& start, Vector3f const& end, float* parameter = nullptr, int* triangleIndex = nullptr ) const
+	{
+		auto closest = std::numeric_limits<float>::max();
+		auto closestTriangle = -1;
+		Vector3f const direction( end.x() - start.x(), end.y() - start.y(), end.z() - start.z() );
+		ForEachOverlappingLeaf( start, end, [&]( int first, int count )
+		{
+			for( auto index = first; index < first + count; ++index )
+			{
+				float hit;
+				if( IntersectTriangle( start, direction, triangles_[index], hit ) && hit < closest )
+				{
+					closest = hit;
+					closestTriangle = triangleIndices_[index];
+				}
+			}
+		} );
+
+		if( closestTriangle < 0 )
+		{
+			return false;
+		}
+
+		if( parameter != nullptr )
+		{
+			*parameter = closest;
+		}
+
+		if( triangleIndex != nullptr )
+		{
+			*triangleIndex = closestTriangle;
+		}
+
+		return true;
+	}
+
+	/*! Tests all segments of a polyline at once, traversing the hierarchy a single time.
+	Consecutive segments are grouped into at most 32 groups, and every node keeps the groups whose bounds overlap it and its ancestors, so a curved polyline
+	only visits the nodes near its segments instead of all nodes within its bounding box.
+	@return Index of the first segment which intersects a triangle, segment i goes from points[i] to points[i + 1], or -1 if none does
+	*/
+	int FindFirstIntersectingSegment( Vector3f const* points, int pointCount ) const
+	{
+		if( nodes_.empty() || pointCount < 2 )
+		{
+			return -1;
+		}
+
+		auto const segmentCount = pointCount - 1;
+		auto const groupSize = ( segmentCount + MaxSegmentGroupCount - 1 ) / MaxSegmentGroupCount;
+		auto const groupCount = ( segmentCount + groupSize - 1 ) / groupSize;
+		std::vector<float> segmentBounds( 6 * segmentCount );
+		std::vector<float> groupBounds( 6 * groupCount );
+		for( auto segment = 0; segment < segmentCount; ++segment )
+		{
+			auto* const group = &groupBounds[6 * ( segment / groupSize )];
+			for( unsigned axis = 0; axis < 3; ++axis )
+			{
+				segmentBounds[6 * segment + axis] = std::min( points[segment][axis], points[segment + 1][axis] );
+				segmentBounds[6 * segment + 3 + axis] = std::max( points[segment][axis], points[segment + 1][axis] );
+				auto const isFirstOfGroup = segment % groupSize == 0;
+				group[axis] = isFirstOfGroup ? segmentBounds[6 * segment + axis] : std::min( group[axis], segmentBounds[6 * segment + axis] );
+				group[3 + axis] = isFirstOfGroup ? segmentBounds[6 * segment + 3 + axis] : std::max( group[3 + axis], segmentBounds[6 * segment + 3 + axis] );
+			}
+		}
+
+		// Segments after the first intersecting one found so far don't need to be tested
+		auto result = segmentCount;
+		int stack[64];
+		std::uint32_t stackGroups[64];
+		auto stackSize = 0;
+		stack[stackSize] = 0;
+		stackGroups[stackSize++] = groupCount < 32 ? ( 1u << groupCount ) - 1 : ~0u;
+		while( stackSize > 0 )
+		{
+			--stackSize;
+			auto const nodeIndex = stack[stackSize];
+			auto const& node = nodes_[nodeIndex];
+			std::uint32_t groups = 0;
+			for( auto group = 0; group < groupCount && group * groupSize < result; ++group )
+			{
+				if( ( stackGroups[stackSize] & ( 1u << group ) ) != 0 && Overlaps( node, &groupBounds[6 * group] ) )
+				{
+					groups |= 1u << group;
+				}
+			}
+
+			if( groups == 0 )
+			{
+				continue;
+			}
+
+			if( !node.IsLeaf() )
+			{
+				stack[stackSize] = node.secondChild;
+				stackGroups[stackSize++] = groups;
+				stack[stackSize] = nodeIndex + 1;
+				stackGroups[stackSize++] = groups;
+				continue;
+			}
+
+			for( auto segment = 0; segment < result; ++segment )
+			{
+				if( ( groups & ( 1u << ( segment / groupSize ) ) ) == 0 || !Overlaps( node, &segmentBounds[6 * segment] ) )
+				{
+					continue;
+				}
+
+				Vector3f const direction( points[segment + 1].x() - points[segment].x(), points[segment + 1].y() - points[segment].y(),
+					points[segment + 1].z() - points[segment].z() );
+				for( auto index = node.first; index < node.first + node.count; ++index )
+				{
+					float hit;
+					if( IntersectTriangle( points[segment], direction, triangles_[index], hit ) )
+					{
+						result = segment;
+						break;
+					}
+				}
+			}
+		}
+
+		return result < segmentCount ? result : -1;
+	}
+
+private:
+
+	struct Node
+	{
+		float minimum[3];
+		float maximum[3];
+
+		//! Range of triangles of leaves, count is 0 for inner nodes
+		int first;
+		int count;
+
+		//! Index of the second child of inner nodes, the first one follows the node
+		int secondChild;
+
+		bool IsLeaf() const
+		{
+			return count > 0;
+		}
+	};
+
+	// Bounds are minimum x, y, z followed by maximum x, y, z
+	static bool Overlaps( Node const& node, float const* bounds )
+	{
+		for( unsigned axis = 0; axis < 3; ++axis )
+		{
+			if( bounds[axis] > node.maximum[axis] || bounds[3 + axis] < node.minimum[axis] )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Slab test of the segment start + t * direction, t in [0, 1]
+	static bool IntersectsSegment( Node const& node, Vector3f const& start, Vector3f const& direction )
+	{
+		auto nearest = 0.0f;
+		auto farthest = 1.0f;
+		for( unsigned axis = 0; axis < 3; ++axis )
+		{
+			if( direction[axis] == 0 )
+			{
+				if( start[axis] < node.minimum[axis] || start[axis] > node.maximum[axis] )
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			auto const inverse = 1 / direction[axis];
+			auto entry = ( node.minimum[axis] - start[axis] ) * inverse;
+			auto exit = ( node.maximum[axis] - start[axis] ) * inverse;
+			if( entry > exit )
+			{
+				std::swap( entry, exit );
+			}
+
+			nearest = std::max( nearest, entry );
+			farthest = std::min( farthest, exit );
+			if( nearest > farthest )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template <class TFunction>
+	void ForEachOverlappingLeaf( Vector3f const& start, Vector3f const& end, TFunction function ) const
+	{
+		if( nodes_.empty() )
+		{
+			return;
+		}
+
+		Vector3f const direction( end.x() - start.x(), end.y() - start.y(), end.z() - start.z() );
+		int stack[64];
+		auto stackSize = 0;
+		stack[stackSize++] = 0;
+		while( stackSize > 0 )
+		{
+			auto const nodeIndex = stack[--stackSize];
+			auto const& node = nodes_[nodeIndex];
+			if( !IntersectsSegment( node, start, direction ) )
+			{
+				continue;
+			}
+
+			if( node.IsLeaf() )
+			{
+				function( node.first, node.count );
+			}
+			else
+			{
+				stack[stackSize++] = node.secondChild;
+				stack[stackSize++] = nodeIndex + 1;
+			}
+		}
+	}
+
+	// Möller-Trumbore intersection of the segment start + t * direction, t in [0, 1], with a triangle
+	bool IntersectTriangle( Vector3f const& start, Vector3f const& direction, Triangle const& triangle, float& parameter ) const
+	{
+		auto const& vertex0 = vertices_[triangle[0]];
+		Vector3f const edge1( vertices_[triangle[1]].x() - vertex0.x(), vertices_[triangle[1]].y() - vertex0.y(), vertices_[triangle[1]].z() - vertex0.z() );
+		Vector3f const edge2( vertices_[triangle[2]].x() - vertex0.x(), vertices_[triangle[2]].y() - vertex0.y(), vertices_[triangle[2]].z() - vertex0.z() );
+		auto const p = Cross( direction, edge2 );
+		auto const determinant = Dot( edge1, p );
+		if( std::abs( determinant ) < 1e-12f )
+		{
+			return false;
+		}
+
+		auto const inverse = 1 / determinant;
+		Vector3f const offset( start.x() - vertex0.x(), start.y() - vertex0.y(), start.z() - vertex0.z() );
+		auto const u = Dot( offset, p ) * inverse;
+		if( u < 0 || u > 1 )
+		{
+			return false;
+		}
+
+		auto const q = Cross( offset, edge1 );
+		auto const v = Dot( direction, q ) * inverse;
+		if( v < 0 || u + v > 1 )
+		{
+			return false;
+		}
+
+		parameter = Dot( edge2, q ) * inverse;
+		return parameter >= 0 && parameter <= 1;
+	}
+
+	static Vector3f Cross( Vector3f const& left, Vector3f const& right )
+	{
+		return Vector3f( left.y() * right.z() - left.z() * right.y(), left.z() * right.x() - left.x() * right.z(), left.x() * right.y() - left.y() * right.x() );
+	}
+
+	static float Dot( Vector3f const& left, Vector3f const& right )
+	{
+		return left.x() * right.x() + left.y() * right.y() + left.z() * right.z();
+	}
+
+	void UpdateBounds( int nodeIndex )
+	{
+		auto& node = nodes_[nodeIndex];
+		if( node.IsLeaf() )
+		{
+			for( unsigned axis = 0; axis < 3; ++axis )
+			{
+				node.minimum[axis] = std::numeric_limits<float>::max();
+				node.maximum[axis] = -std::numeric_limits<float>::max();
+				for( auto index = node.first; index < node.first + node.count; ++index )
+				{
+					for( auto corner = 0; corner < 3; ++corner )
+					{
+						node.minimum[axis] = std::min( node.minimum[axis], vertices_[triangles_[index][corner]][axis] );
+						node.maximum[axis] = std::max( node.maximum[axis], vertices_[triangles_[index][corner]][axis] );
+					}
+				}
+			}
+
+			return;
+		}
+
+		auto const& first = nodes_[nodeIndex + 1];
+		auto const& second = nodes_[node.secondChild];
+		for( unsigned axis = 0; axis < 3; ++axis )
+		{
+			node.minimum[axis] = std::min( first.minimum[axis], second.minimum[axis] );
+			node.maximum[axis] = std::max( first.maximum[axis], second.maximum[axis] );
+		}
+	}
+
+	// Median splits keep the depth at log2 of the triangle count, well within the query stacks. Bounds are set by UpdateBounds() afterwards.
+	int BuildNode( std::vector<Vector3f> const& centroids, int begin, int end )
+	{
+		auto const nodeIndex = static_cast<int>( nodes_.size() );
+		nodes_.push_back( Node() );
+
+		Node node;
+		node.first = begin;
+		node.count = 0;
+		node.secondChild = -1;
+		if( end - begin <= MaxLeafSize )
+		{
+			node.count = end - begin;
+			nodes_[nodeIndex] = node;
+			return nodeIndex;
+		}
+
+		float minimum[3], maximum[3];
+		for( unsigned axis = 0; axis < 3; ++axis )
+		{
+			minimum[axis] = std::numeric_limits<float>::max();
+			maximum[axis] = -std::numeric_limits<float>::max();
+			for( auto index = begin; index < end; ++index )
+			{
+				minimum[axis] = std::min( minimum[axis], centroids[triangleIndices_[index]][axis] );
+				maximum[axis] = std::max( maximum[axis], centroids[triangleIndices_[index]][axis] );
+			}
+		}
+
+		unsigned splitAxis = 0;
+		for( unsigned axis = 1; axis < 3; ++axis )
+		{
+			if( maximum[axis] - minimum[axis] > maximum[splitAxis] - minimum[splitAxis] )
+			{
+				splitAxis = axis;
+			}
+		}
+
+		auto const middle = begin + ( end - begin ) / 2;
+		std::nth_element( triangleIndices_.begin() + begin, triangleIndices_.begin() + middle, triangleIndices_.begin() + end,
+			[&centroids, splitAxis]( int left, int right )
+		{
+			return centroids[left][splitAxis] < centroids[right][splitAxis];
+		} );
+
+		BuildNode( centroids, begin, middle );
+		node.secondChild = BuildNode( centroids, middle, end );
+		nodes_[nodeIndex] = node;
+		return nodeIndex;
+	}
+
+	std::vector<Node> nodes_;
+	std::vector<Vector3f> vertices_;
+
+	//! Triangles in the order of the leaves, and their indices as passed to Build()
+	std::vector<Triangle> triangles_;
+	std::vector<int> triangleIndices_;
+};
+
+} }
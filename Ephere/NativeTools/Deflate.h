@@ -0,0 +1,729 @@
+// Must compile with VC 2012 / GCC 4.8 (partial C++11)
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/MacroTools.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Ephere
+{
+
+/*! Minimal encoder of raw deflate streams (RFC 1951), the counterpart of Inflater.
+
+Matches are found with hash chains whose length depends on the compression level, from level 4 on with the lazy matching of zlib. Every block of literals
+and matches is encoded with Huffman codes built for it, the fixed codes of the format or without compression, whichever takes the fewest bits.
+Independent chunks of a file can be compressed concurrently and concatenated: every chunk except the last one ends with an empty stored block, like a zlib
+sync flush, so the next one starts on a byte boundary.
+*/
+class Deflater
+{
+public:
+
+	enum
+	{
+		//! Level 0 stores the data without compression
+		NoCompression = 0,
+		BestSpeed = 1,
+		DefaultLevel = 6,
+		BestCompression = 9
+	};
+
+	/*! Appends the compressed data to the output
+	@param isLast True for the last chunk of a stream, otherwise the output ends on a byte boundary and another chunk can follow it
+	*/
+	static void Compress( void const* data, std::size_t size, int level, bool isLast, std::string& output )
+	{
+		Deflater deflater( static_cast<unsigned char const*>( data ), size, output );
+		if( level <= NoCompression )
+		{
+			deflater.Store( 0, size, isLast );
+		}
+		else
+		{
+			deflater.CompressBlocks( std::min<int>( level, BestCompression ), isLast );
+		}
+	}
+
+private:
+
+	enum
+	{
+		WindowSize = 32768,
+		HashBits = 15,
+		MinMatch = 3,
+		MaxMatch = 258,
+		// Matches of the minimum length which are further away take more bits than the literals, same as in zlib
+		MaxMinMatchDistance = 4096,
+		MaxStoredBlockSize = 65535,
+		// Number of literals and matches encoded with the same Huffman codes
+		MaxBlockSymbolCount = 1 << 15,
+		EndOfBlock = 256,
+		LiteralLengthCodeCount = 286,
+		DistanceCodeCount = 30,
+		CodeLengthCodeCount = 19,
+		// The fixed codes have two more symbols, which never occur in the data
+		MaxSymbolCount = 288,
+		MaxCodeLength = 15,
+		MaxCodeLengthCodeLength = 7
+	};
+
+	// A literal if distance is 0, otherwise a match
+	struct Symbol
+	{
+		std::uint16_t literalOrLength;
+		std::uint16_t distance;
+	};
+
+	struct Match
+	{
+		int length;
+		int distance;
+	};
+
+	// Code lengths and the bit reversed canonical codes of a Huffman code, ready to be put into the output
+	struct Code
+	{
+		unsigned char lengths[MaxSymbolCount];
+		std::uint16_t codes[MaxSymbolCount];
+	};
+
+	Deflater( unsigned char const* input, std::size_t inputSize, std::string& output )
+		: input_( input ),
+		inputSize_( inputSize ),
+		output_( output ),
+		bitBuffer_( 0 ),
+		bitCount_( 0 )
+	{
+	}
+
+	static short const* LengthBase()
+	{
+		static short const result[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		return result;
+	}
+
+	static short const* LengthExtra()
+	{
+		static short const result[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		return result;
+	}
+
+	static int const* DistanceBase()
+	{
+		static int const result[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+			8193, 12289, 16385, 24577 };
+		return result;
+	}
+
+	static short const* DistanceExtra()
+	{
+		static short const result[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+		return result;
+	}
+
+	static int GetLengthIndex( int length )
+	{
+		return static_cast<int>( std::upper_bound( LengthBase(), LengthBase() + 29, length ) - LengthBase() ) - 1;
+	}
+
+	static int GetDistanceIndex( int distance )
+	{
+		return static_cast<int>( std::upper_bound( DistanceBase(), DistanceBase() + 30, distance ) - DistanceBase() ) - 1;
+	}
+
+	void PutBits( std::uint32_t value, int count )
+	{
+		bitBuffer_ |= static_cast<std::uint64_t>( value ) << bitCount_;
+		bitCount_ += count;
+		while( bitCount_ >= 8 )
+		{
+			output_.push_back( static_cast<char>( bitBuffer_ & 0xff ) );
+			bitBuffer_ >>= 8;
+			bitCount_ -= 8;
+		}
+	}
+
+	void AlignToByte()
+	{
+		if( bitCount_ > 0 )
+		{
+			PutBits( 0, 8 - bitCount_ );
+		}
+	}
+
+	// The block header is followed by padding to the next byte, the length and its complement
+	void PutStoredBlock( unsigned char const* data, std::size_t size, bool isLast )
+	{
+		PutBits( isLast ? 1 : 0, 3 );
+		AlignToByte();
+		PutBits( static_cast<std::uint32_t>( size ), 16 );
+		PutBits( static_cast<std::uint32_t>( ~size & 0xffff ), 16 );
+		if( size > 0 )
+		{
+			output_.append( reinterpret_cast<char const*>( data ), size );
+		}
+	}
+
+	// Stores the input range [start, end) in as many blocks as needed
+	void Store( std::size_t start, std::size_t end, bool isLast )
+	{
+		auto position = start;
+		do
+		{
+			auto const blockSize = std::min<std::size_t>( end - position, MaxStoredBlockSize );
+			auto const isLastBlock = position + blockSize == end;
+			if( isLastBlock && !isLast && blockSize == 0 )
+			{
+				break;
+			}
+
+			PutStoredBlock( input_ + position, blockSize, isLast && isLastBlock );
+			position += blockSize;
+		}
+		while( position < end );
+	}
+
+	/*! Sets the lengths of a Huffman code for the frequencies with codes of at most maxLength bits. Symbols with 0 frequency get no code.
+	Codes of two or more symbols are always complete, as inflaters require.
+	*/
+	static void BuildCodeLengths( std::uint32_t const* frequencies, int symbolCount, int maxLength, unsigned char* lengths )
+	{
+		std::fill( lengths, lengths + symbolCount, static_cast<unsigned char>( 0 ) );
+		std::vector<int> symbols;
+		for( auto symbol = 0; symbol < symbolCount; ++symbol )
+		{
+			if( frequencies[symbol] > 0 )
+			{
+				symbols.push_back( symbol );
+			}
+		}
+
+		auto const leafCount = static_cast<int>( symbols.size() );
+		if( leafCount < 2 )
+		{
+			if( leafCount == 1 )
+			{
+				lengths[symbols[0]] = 1;
+			}
+
+			return;
+		}
+
+		std::stable_sort( symbols.begin(), symbols.end(), [frequencies]( int left, int right )
+		{
+			return frequencies[left] < frequencies[right];
+		} );
+
+		// Leaves are sorted by weight and internal nodes are created with non-decreasing weights, so the two lightest nodes are at the front of either
+		auto const nodeCount = 2 * leafCount - 1;
+		std::vector<std::uint64_t> weights( nodeCount );
+		std::vector<int> parents( nodeCount );
+		for( auto index = 0; index < leafCount; ++index )
+		{
+			weights[index] = frequencies[symbols[index]];
+		}
+
+		auto nextLeaf = 0, nextNode = leafCount;
+		for( auto node = leafCount; node < nodeCount; ++node )
+		{
+			for( auto child = 0; child < 2; ++child )
+			{
+				auto const lightest = nextLeaf < leafCount && ( nextNode >= node || weights[nextLeaf] <= weights[nextNode] ) ? nextLeaf++ : nextNode++;
+				weights[node] += weights[lightest];
+				parents[lightest] = node;
+			}
+		}
+
+		// Depths of the nodes from the root down, stored in place of the weights. Parents are always created after their children.
+		std::vector<int> lengthCounts( std::max( leafCount, maxLength ) + 1 );
+		weights[nodeCount - 1] = 0;
+		for( auto node = nodeCount - 2; node >= 0; --node )
+		{
+			weights[node] = weights[parents[node]] + 1;
+			if( node < leafCount )
+			{
+				++lengthCounts[static_cast<int>( weights[node] )];
+			}
+		}
+
+		// Longer codes are shortened to the limit, then the code is made complete again by lengthening some of the shorter ones, the same as in zlib
+		for( auto length = maxLength + 1; length < static_cast<int>( lengthCounts.size() ); ++length )
+		{
+			lengthCounts[maxLength] += lengthCounts[length];
+			lengthCounts[length] = 0;
+		}
+
+		std::uint32_t total = 0;
+		for( auto length = 1; length <= maxLength; ++length )
+		{
+			total += static_cast<std::uint32_t>( lengthCounts[length] ) << ( maxLength - length );
+		}
+
+		for( ; total > 1u << maxLength; --total )
+		{
+			--lengthCounts[maxLength];
+			for( auto length = maxLength - 1; length > 0; --length )
+			{
+				if( lengthCounts[length] > 0 )
+				{
+					--lengthCounts[length];
+					lengthCounts[length + 1] += 2;
+					break;
+				}
+			}
+		}
+
+		// The most frequent symbols get the shortest codes
+		auto leaf = leafCount;
+		for( auto length = 1; length <= maxLength; ++length )
+		{
+			for( auto count = lengthCounts[length]; count > 0; --count )
+			{
+				lengths[symbols[--leaf]] = static_cast<unsigned char>( length );
+			}
+		}
+	}
+
+	// Assigns the canonical codes of the lengths, bit reversed since Huffman codes are packed starting with their most significant bit
+	static void BuildCodes( int symbolCount, Code& code )
+	{
+		int lengthCounts[MaxCodeLength + 1] = {};
+		for( auto symbol = 0; symbol < symbolCount; ++symbol )
+		{
+			++lengthCounts[code.lengths[symbol]];
+		}
+
+		lengthCounts[0] = 0;
+		int nextCodes[MaxCodeLength + 2] = {};
+		for( auto length = 1; length <= MaxCodeLength; ++length )
+		{
+			nextCodes[length + 1] = ( nextCodes[length] + lengthCounts[length] ) << 1;
+		}
+
+		for( auto symbol = 0; symbol < symbolCount; ++symbol )
+		{
+			auto const length = code.lengths[symbol];
+			std::uint32_t reversed = 0;
+			if( length > 0 )
+			{
+				auto const canonical = static_cast<std::uint32_t>( nextCodes[length]++ );
+				for( auto bit = 0; bit < length; ++bit )
+				{
+					reversed |= ( canonical >> bit & 1 ) << ( length - 1 - bit );
+				}
+			}
+
+			code.codes[symbol] = static_cast<std::uint16_t>( reversed );
+		}
+	}
+
+	static Code const& GetFixedLiteralLengthCode()
+	{
+		struct FixedCode : Code
+		{
+			FixedCode()
+			{
+				for( auto symbol = 0; symbol < MaxSymbolCount; ++symbol )
+				{
+					lengths[symbol] = static_cast<unsigned char>( symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8 );
+				}
+
+				BuildCodes( MaxSymbolCount, *this );
+			}
+		};
+
+		static FixedCode const result;
+		return result;
+	}
+
+	static Code const& GetFixedDistanceCode()
+	{
+		struct FixedCode : Code
+		{
+			FixedCode()
+			{
+				std::fill( lengths, lengths + DistanceCodeCount + 2, static_cast<unsigned char>( 5 ) );
+				BuildCodes( DistanceCodeCount + 2, *this );
+			}
+		};
+
+		static FixedCode const result;
+		return result;
+	}
+
+	// Number of bits the symbols with these frequencies take with the codes, including the extra bits of lengths and distances
+	static std::uint64_t GetEncodedSize( std::uint32_t const* literalLengthFrequencies, std::uint32_t const* distanceFrequencies, Code const& literalLengthCode,
+		Code const& distanceCode )
+	{
+		std::uint64_t result = 0;
+		for( auto symbol = 0; symbol < LiteralLengthCodeCount; ++symbol )
+		{
+			result += static_cast<std::uint64_t>( literalLengthFrequencies[symbol] )
+				* ( literalLengthCode.lengths[symbol] + ( symbol > EndOfBlock ? LengthExtra()[symbol - EndOfBlock - 1] : 0 ) );
+		}
+
+		for( auto symbol = 0; symbol < DistanceCodeCount; ++symbol )
+		{
+			result += static_cast<std::uint64_t>( distanceFrequencies[symbol] ) * ( distanceCode.lengths[symbol] + DistanceExtra()[symbol] );
+		}
+
+		return result;
+	}
+
+	// Run length encoding of the code lengths of a dynamic block, pairs of code length symbol and the value of its extra bits
+	static void EncodeCodeLengths( unsigned char const* lengths, int count, std::vector<std::pair<unsigned char, unsigned char>>& result )
+	{
+		result.clear();
+		for( auto index = 0; index < count; )
+		{
+			auto const length = lengths[index];
+			auto runLength = 1;
+			while( index + runLength < count && lengths[index + runLength] == length )
+			{
+				++runLength;
+			}
+
+			index += runLength;
+			if( length == 0 )
+			{
+				while( runLength >= 11 )
+				{
+					auto const repeatCount = std::min( runLength, 138 );
+					result.push_back( std::make_pair( static_cast<unsigned char>( 18 ), static_cast<unsigned char>( repeatCount - 11 ) ) );
+					runLength -= repeatCount;
+				}
+
+				if( runLength >= 3 )
+				{
+					result.push_back( std::make_pair( static_cast<unsigned char>( 17 ), static_cast<unsigned char>( runLength - 3 ) ) );
+					runLength = 0;
+				}
+			}
+			else
+			{
+				result.push_back( std::make_pair( length, static_cast<unsigned char>( 0 ) ) );
+				for( --runLength; runLength >= 3; )
+				{
+					auto const repeatCount = std::min( runLength, 6 );
+					result.push_back( std::make_pair( static_cast<unsigned char>( 16 ), static_cast<unsigned char>( repeatCount - 3 ) ) );
+					runLength -= repeatCount;
+				}
+			}
+
+			for( ; runLength > 0; --runLength )
+			{
+				result.push_back( std::make_pair( length, static_cast<unsigned char>( 0 ) ) );
+			}
+		}
+	}
+
+	void PutSymbol( Code const& code, int symbol )
+	{
+		PutBits( code.codes[symbol], code.lengths[symbol] );
+	}
+
+	void PutSymbols( std::vector<Symbol> const& symbols, Code const& literalLengthCode, Code const& distanceCode )
+	{
+		for( auto const& symbol : symbols )
+		{
+			if( symbol.distance == 0 )
+			{
+				PutSymbol( literalLengthCode, symbol.literalOrLength );
+				continue;
+			}
+
+			auto const lengthIndex = GetLengthIndex( symbol.literalOrLength );
+			PutSymbol( literalLengthCode, EndOfBlock + 1 + lengthIndex );
+			PutBits( symbol.literalOrLength - LengthBase()[lengthIndex], LengthExtra()[lengthIndex] );
+
+			auto const distanceIndex = GetDistanceIndex( symbol.distance );
+			PutSymbol( distanceCode, distanceIndex );
+			PutBits( symbol.distance - DistanceBase()[distanceIndex], DistanceExtra()[distanceIndex] );
+		}
+
+		PutSymbol( literalLengthCode, EndOfBlock );
+	}
+
+	// Puts the symbols encoding the input range [start, end) as a single dynamic, fixed or stored block, whichever is smallest
+	void PutBlock( std::vector<Symbol> const& symbols, std::size_t start, std::size_t end, bool isLast )
+	{
+		static unsigned char const CodeLengthOrder[CodeLengthCodeCount] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		static int const RepeatExtraBits[3] = { 2, 3, 7 };
+
+		std::uint32_t literalLengthFrequencies[LiteralLengthCodeCount] = {};
+		std::uint32_t distanceFrequencies[DistanceCodeCount] = {};
+		for( auto const& symbol : symbols )
+		{
+			if( symbol.distance == 0 )
+			{
+				++literalLengthFrequencies[symbol.literalOrLength];
+			}
+			else
+			{
+				++literalLengthFrequencies[EndOfBlock + 1 + GetLengthIndex( symbol.literalOrLength )];
+				++distanceFrequencies[GetDistanceIndex( symbol.distance )];
+			}
+		}
+
+		literalLengthFrequencies[EndOfBlock] = 1;
+
+		Code literalLengthCode, distanceCode;
+		BuildCodeLengths( literalLengthFrequencies, LiteralLengthCodeCount, MaxCodeLength, literalLengthCode.lengths );
+		BuildCodeLengths( distanceFrequencies, DistanceCodeCount, MaxCodeLength, distanceCode.lengths );
+
+		// Blocks without matches still describe one distance code
+		auto distanceCount = static_cast<int>( DistanceCodeCount );
+		while( distanceCount > 1 && distanceCode.lengths[distanceCount - 1] == 0 )
+		{
+			--distanceCount;
+		}
+
+		if( distanceCode.lengths[0] == 0 && distanceCount == 1 )
+		{
+			distanceCode.lengths[0] = 1;
+		}
+
+		auto literalLengthCount = static_cast<int>( LiteralLengthCodeCount );
+		while( literalLengthCount > EndOfBlock + 1 && literalLengthCode.lengths[literalLengthCount - 1] == 0 )
+		{
+			--literalLengthCount;
+		}
+
+		BuildCodes( LiteralLengthCodeCount, literalLengthCode );
+		BuildCodes( DistanceCodeCount, distanceCode );
+
+		unsigned char allLengths[LiteralLengthCodeCount + DistanceCodeCount];
+		std::copy( literalLengthCode.lengths, literalLengthCode.lengths + literalLengthCount, allLengths );
+		std::copy( distanceCode.lengths, distanceCode.lengths + distanceCount, allLengths + literalLengthCount );
+		std::vector<std::pair<unsigned char, unsigned char>> encodedLengths;
+		EncodeCodeLengths( allLengths, literalLengthCount + distanceCount, encodedLengths );
+
+		// The code length code has to be complete, so it needs at least two symbols
+		std::uint32_t codeLengthFrequencies[CodeLengthCodeCount] = {};
+		for( auto const& encoded : encodedLengths )
+		{
+			++codeLengthFrequencies[encoded.first];
+		}
+
+		if( std::count( codeLengthFrequencies, codeLengthFrequencies + CodeLengthCodeCount, 0u ) > CodeLengthCodeCount - 2 )
+		{
+			++codeLengthFrequencies[codeLengthFrequencies[0] == 0 ? 0 : 1];
+		}
+
+		Code codeLengthCode;
+		BuildCodeLengths( codeLengthFrequencies, CodeLengthCodeCount, MaxCodeLengthCodeLength, codeLengthCode.lengths );
+		BuildCodes( CodeLengthCodeCount, codeLengthCode );
+
+		auto codeLengthCount = static_cast<int>( CodeLengthCodeCount );
+		while( codeLengthCount > 4 && codeLengthCode.lengths[CodeLengthOrder[codeLengthCount - 1]] == 0 )
+		{
+			--codeLengthCount;
+		}
+
+		std::uint64_t dynamicSize = 3 + 5 + 5 + 4 + 3 * codeLengthCount
+			+ GetEncodedSize( literalLengthFrequencies, distanceFrequencies, literalLengthCode, distanceCode );
+		for( auto const& encoded : encodedLengths )
+		{
+			dynamicSize += codeLengthCode.lengths[encoded.first] + ( encoded.first >= 16 ? RepeatExtraBits[encoded.first - 16] : 0 );
+		}
+
+		auto const fixedSize = 3 + GetEncodedSize( literalLengthFrequencies, distanceFrequencies, GetFixedLiteralLengthCode(), GetFixedDistanceCode() );
+		auto const storedSize = ( ( end - start ) / MaxStoredBlockSize + 1 ) * ( 3 + 7 + 32 ) + 8 * static_cast<std::uint64_t>( end - start );
+		if( storedSize < dynamicSize && storedSize < fixedSize )
+		{
+			Store( start, end, isLast );
+			return;
+		}
+
+		PutBits( isLast ? 1 : 0, 1 );
+		if( fixedSize <= dynamicSize )
+		{
+			PutBits( 1, 2 );
+			PutSymbols( symbols, GetFixedLiteralLengthCode(), GetFixedDistanceCode() );
+			return;
+		}
+
+		PutBits( 2, 2 );
+		PutBits( literalLengthCount - EndOfBlock - 1, 5 );
+		PutBits( distanceCount - 1, 5 );
+		PutBits( codeLengthCount - 4, 4 );
+		for( auto index = 0; index < codeLengthCount; ++index )
+		{
+			PutBits( codeLengthCode.lengths[CodeLengthOrder[index]], 3 );
+		}
+
+		for( auto const& encoded : encodedLengths )
+		{
+			PutSymbol( codeLengthCode, encoded.first );
+			if( encoded.first >= 16 )
+			{
+				PutBits( encoded.second, RepeatExtraBits[encoded.first - 16] );
+			}
+		}
+
+		PutSymbols( symbols, literalLengthCode, distanceCode );
+	}
+
+	void CompressBlocks( int level, bool isLast )
+	{
+		// Number of chain links followed per position, the match length which is good enough to stop searching, and the match length below which a
+		// longer match is searched at the next position (lazy matching)
+		static int const ChainLimits[BestCompression + 1] = { 0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096 };
+		static int const NiceLengths[BestCompression + 1] = { 0, 16, 32, 32, 64, 128, 128, 258, 258, 258 };
+		static int const LazyLengths[BestCompression + 1] = { 0, 0, 0, 0, 16, 16, 32, 128, 258, 258 };
+
+		output_.reserve( output_.size() + inputSize_ / 3 + 64 );
+
+		std::vector<std::int32_t> head( 1 << HashBits, -1 );
+		std::vector<std::int32_t> previous( inputSize_ );
+		auto const hash = [this]( std::size_t position )
+		{
+			return ( input_[position] << 10 ^ input_[position + 1] << 5 ^ input_[position + 2] ) & ( ( 1 << HashBits ) - 1 );
+		};
+
+		auto const insert = [&]( std::size_t position )
+		{
+			if( position + MinMatch <= inputSize_ )
+			{
+				auto& first = head[hash( position )];
+				previous[position] = first;
+				first = static_cast<std::int32_t>( position );
+			}
+		};
+
+		auto const findMatch = [&]( std::size_t position )
+		{
+			Match result = { 0, 0 };
+			if( position + MinMatch > inputSize_ )
+			{
+				return result;
+			}
+
+			auto const maxLength = static_cast<int>( std::min<std::size_t>( MaxMatch, inputSize_ - position ) );
+			auto candidate = head[hash( position )];
+			for( auto chainLength = ChainLimits[level]; candidate >= 0 && chainLength > 0; --chainLength, candidate = previous[candidate] )
+			{
+				auto const distance = static_cast<int>( position - candidate );
+				if( distance > WindowSize )
+				{
+					break;
+				}
+
+				auto const* const current = input_ + position;
+				auto const* const earlier = input_ + candidate;
+				if( earlier[result.length] != current[result.length] )
+				{
+					continue;
+				}
+
+				auto length = 0;
+				while( length < maxLength && earlier[length] == current[length] )
+				{
+					++length;
+				}
+
+				if( length > result.length )
+				{
+					result.length = length;
+					result.distance = distance;
+					if( length >= NiceLengths[level] || length == maxLength )
+					{
+						break;
+					}
+				}
+			}
+
+			if( result.length < MinMatch || ( result.length == MinMatch && result.distance > MaxMinMatchDistance ) )
+			{
+				result.length = 0;
+			}
+
+			return result;
+		};
+
+		std::vector<Symbol> symbols;
+		symbols.reserve( std::min<std::size_t>( inputSize_, MaxBlockSymbolCount ) );
+		std::size_t blockStart = 0;
+		std::size_t position = 0;
+		Match nextMatch = { 0, 0 };
+		auto hasNextMatch = false;
+		while( position < inputSize_ )
+		{
+			auto match = hasNextMatch ? nextMatch : findMatch( position );
+			hasNextMatch = false;
+			insert( position );
+
+			// A longer match at the next position is worth a literal
+			if( match.length > 0 && match.length < LazyLengths[level] )
+			{
+				nextMatch = findMatch( position + 1 );
+				hasNextMatch = nextMatch.length > match.length;
+			}
+
+			if( match.length == 0 || hasNextMatch )
+			{
+				Symbol const literal = { input_[position], 0 };
+				symbols.push_back( literal );
+				++position;
+			}
+			else
+			{
+				Symbol const matchSymbol = { static_cast<std::uint16_t>( match.length ), static_cast<std::uint16_t>( match.distance ) };
+				symbols.push_back( matchSymbol );
+
+				// Faster levels don't index the inside of matches
+				auto const end = position + match.length;
+				if( level >= 4 )
+				{
+					for( ++position; position < end; ++position )
+					{
+						insert( position );
+					}
+				}
+
+				position = end;
+			}
+
+			if( symbols.size() == MaxBlockSymbolCount )
+			{
+				PutBlock( symbols, blockStart, position, false );
+				symbols.clear();
+				blockStart = position;
+			}
+		}
+
+		// The last block of a stream may be empty, it just marks the end
+		if( !symbols.empty() || isLast )
+		{
+			PutBlock( symbols, blockStart, inputSize_, isLast );
+		}
+
+		if( !isLast )
+		{
+			PutStoredBlock( nullptr, 0, false );
+		}
+
+		AlignToByte();
+	}
+
+	Deflater( Deflater const& );
+
+	Deflater& operator=( Deflater const& );
+
+	unsigned char const* input_;
+	std::size_t inputSize_;
+
+	std::string& output_;
+
+	std::uint64_t bitBuffer_;
+	int bitCount_;
+};
+
+}
@@ -0,0 +1,553 @@
+// Must compile with VC 2012 / GCC 4.8 (partial C++11)
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/MacroTools.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Ephere
+{
+
+/*! Minimal decoder of raw deflate streams (RFC 1951), as stored in zip archives.
+
+It is meant for reading zip archives without a compression library, e.g. the header of a zipped groom or the entries of an archive which are decompressed in
+parallel by ReadZipArchive(). Decoding stops when the output buffer is full, so only the requested prefix of a large entry is ever decompressed.
+Codes of up to FastBits bits are decoded with a lookup table, longer ones bit by bit.
+*/
+class Inflater
+{
+public:
+
+	enum class Status
+	{
+		//! The whole stream was decoded
+		Complete,
+
+		//! The output buffer is full, the decoded prefix is valid
+		OutputFull,
+
+		//! The input ended before the end of the stream, the decoded prefix is valid
+		InputTruncated,
+
+		//! The stream is not valid deflate data
+		Invalid
+	};
+
+	/*! Decodes the source into the destination buffer
+	@param destinationSize Size of the destination buffer on input, number of decoded bytes on output
+	*/
+	static Status Inflate( void const* source, std::size_t sourceSize, void* destination, std::size_t& destinationSize )
+	{
+		Inflater inflater( static_cast<unsigned char const*>( source ), sourceSize, static_cast<unsigned char*>( destination ), destinationSize );
+		auto const status = inflater.Run();
+		destinationSize = inflater.outputCount_;
+		return status;
+	}
+
+private:
+
+	enum
+	{
+		MaxBits = 15,
+		FastBits = 9,
+		MaxLengthCodes = 286,
+		MaxDistanceCodes = 30,
+		FixedLengthCodes = 288
+	};
+
+	struct Huffman
+	{
+		short count[MaxBits + 1];
+		short symbol[FixedLengthCodes];
+
+		// Indexed by the next FastBits input bits, holds the code length << 9 | symbol, or 0 for longer codes
+		std::uint16_t fast[1 << FastBits];
+	};
+
+	Inflater( unsigned char const* input, std::size_t inputSize, unsigned char* output, std::size_t outputSize )
+		: input_( input ),
+		inputSize_( inputSize ),
+		inputCount_( 0 ),
+		output_( output ),
+		outputSize_( outputSize ),
+		outputCount_( 0 ),
+		bitBuffer_( 0 ),
+		bitCount_( 0 ),
+		status_( Status::Complete )
+	{
+	}
+
+	Status Run()
+	{
+		int isLast;
+		do
+		{
+			isLast = Bits( 1 );
+			auto const type = Bits( 2 );
+			if( status_ != Status::Complete )
+			{
+				break;
+			}
+
+			switch( type )
+			{
+				case 0:
+					Stored();
+					break;
+				case 1:
+					Fixed();
+					break;
+				case 2:
+					Dynamic();
+					break;
+				default:
+					status_ = Status::Invalid;
+					break;
+			}
+		}
+		while( !isLast && status_ == Status::Complete );
+
+		return status_;
+	}
+
+	// Returns 0 and sets the status once the input runs out, callers check the status before using the value
+	int Bits( int count )
+	{
+		while( bitCount_ < count )
+		{
+			if( inputCount_ == inputSize_ )
+			{
+				Fail( Status::InputTruncated );
+				return 0;
+			}
+
+			bitBuffer_ |= static_cast<std::uint64_t>( input_[inputCount_++] ) << bitCount_;
+			bitCount_ += 8;
+		}
+
+		auto const result = static_cast<int>( bitBuffer_ & ( ( 1u << count ) - 1 ) );
+		bitBuffer_ >>= count;
+		bitCount_ -= count;
+		return result;
+	}
+
+	void Fail( Status status )
+	{
+		if( status_ == Status::Complete )
+		{
+			status_ = status;
+		}
+	}
+
+	bool Put( unsigned char value )
+	{
+		if( outputCount_ == outputSize_ )
+		{
+			Fail( Status::OutputFull );
+			return false;
+		}
+
+		output_[outputCount_++] = value;
+		return true;
+	}
+
+	void Stored()
+	{
+		bitBuffer_ = 0;
+		bitCount_ = 0;
+		if( inputSize_ - inputCount_ < 4 )
+		{
+			Fail( Status::InputTruncated );
+			return;
+		}
+
+		auto const length = static_cast<unsigned>( input_[inputCount_] | input_[inputCount_ + 1] << 8 );
+		auto const complement = static_cast<unsigned>( input_[inputCount_ + 2] | input_[inputCount_ + 3] << 8 );
+		inputCount_ += 4;
+		if( length != ( ~complement & 0xffffu ) )
+		{
+			Fail( Status::Invalid );
+			return;
+		}
+
+		auto const available = std::min<std::size_t>( length, inputSize_ - inputCount_ );
+		auto const copied = std::min( available, outputSize_ - outputCount_ );
+		std::memcpy( output_ + outputCount_, input_ + inputCount_, copied );
+		inputCount_ += copied;
+		outputCount_ += copied;
+		if( copied < length )
+		{
+			Fail( copied < available ? Status::OutputFull : Status::InputTruncated );
+		}
+	}
+
+	// Returns the decoded symbol or -1. Short codes are looked up, the rest is read bit by bit from the canonical code counts.
+	int Decode( Huffman const& huffman )
+	{
+		while( bitCount_ < FastBits && inputCount_ < inputSize_ )
+		{
+			bitBuffer_ |= static_cast<std::uint64_t>( input_[inputCount_++] ) << bitCount_;
+			bitCount_ += 8;
+		}
+
+		if( bitCount_ >= FastBits )
+		{
+			auto const entry = huffman.fast[bitBuffer_ & ( ( 1u << FastBits ) - 1 )];
+			if( entry != 0 )
+			{
+				auto const length = entry >> 9;
+				bitBuffer_ >>= length;
+				bitCount_ -= length;
+				return entry & 0x1ff;
+			}
+		}
+
+		auto code = 0;
+		auto first = 0;
+		auto index = 0;
+		for( auto length = 1; length <= MaxBits; ++length )
+		{
+			code |= Bits( 1 );
+			if( status_ != Status::Complete )
+			{
+				return -1;
+			}
+
+			int const count = huffman.count[length];
+			if( code - count < first )
+			{
+				return huffman.symbol[index + ( code - first )];
+			}
+
+			index += count;
+			first += count;
+			first <<= 1;
+			code <<= 1;
+		}
+
+		Fail( Status::Invalid );
+		return -1;
+	}
+
+	// Returns 0 for a complete code, a negative value for an over-subscribed code and a positive value for an incomplete one
+	static int Construct( Huffman& huffman, short const* lengths, int count )
+	{
+		std::memset( huffman.count, 0, sizeof( huffman.count ) );
+		std::memset( huffman.fast, 0, sizeof( huffman.fast ) );
+		for( auto symbol = 0; symbol < count; ++symbol )
+		{
+			++huffman.count[lengths[symbol]];
+		}
+
+		if( huffman.count[0] == count )
+		{
+			return 0;
+		}
+
+		auto left = 1;
+		for( auto length = 1; length <= MaxBits; ++length )
+		{
+			left <<= 1;
+			left -= huffman.count[length];
+			if( left < 0 )
+			{
+				return left;
+			}
+		}
+
+		short offsets[MaxBits + 1];
+		offsets[1] = 0;
+		for( auto length = 1; length < MaxBits; ++length )
+		{
+			offsets[length + 1] = static_cast<short>( offsets[length] + huffman.count[length] );
+		}
+
+		// Canonical codes are stored most significant bit first, so the table is indexed by the reversed code
+		int nextCodes[MaxBits + 1];
+		nextCodes[0] = 0;
+		for( auto length = 1, code = 0; length <= MaxBits; ++length )
+		{
+			code = ( code + ( length > 1 ? huffman.count[length - 1] : 0 ) ) << 1;
+			nextCodes[length] = code;
+		}
+
+		for( auto symbol = 0; symbol < count; ++symbol )
+		{
+			int const length = lengths[symbol];
+			if( length == 0 )
+			{
+				continue;
+			}
+
+			huffman.symbol[offsets[length]++] = static_cast<short>( symbol );
+			auto const code = nextCodes[length]++;
+			if( length <= FastBits )
+			{
+				auto reversed = 0;
+				for( auto bit = 0; bit < length; ++bit )
+				{
+					reversed |= ( code >> bit & 1 ) << ( length - 1 - bit );
+				}
+
+				for( auto index = reversed; index < 1 << FastBits; index += 1 << length )
+				{
+					huffman.fast[index] = static_cast<std::uint16_t>( length << 9 | symbol );
+				}
+			}
+		}
+
+		return left;
+	}
+
+	void Codes( Huffman const& lengthCode, Huffman const& distanceCode )
+	{
+		static short const LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static short const LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static short const DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+			8193, 12289, 16385, 24577 };
+		static short const DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		for( ;; )
+		{
+			auto symbol = Decode( lengthCode );
+			if( symbol < 0 )
+			{
+				return;
+			}
+
+			if( symbol < 256 )
+			{
+				if( !Put( static_cast<unsigned char>( symbol ) ) )
+				{
+					return;
+				}
+
+				continue;
+			}
+
+			if( symbol == 256 )
+			{
+				return;
+			}
+
+			symbol -= 257;
+			if( symbol >= 29 )
+			{
+				Fail( Status::Invalid );
+				return;
+			}
+
+			auto const length = LengthBase[symbol] + Bits( LengthExtra[symbol] );
+			symbol = Decode( distanceCode );
+			if( symbol < 0 )
+			{
+				return;
+			}
+
+			if( symbol >= 30 )
+			{
+				Fail( Status::Invalid );
+				return;
+			}
+
+			auto const distance = static_cast<std::size_t>( DistanceBase[symbol] + Bits( DistanceExtra[symbol] ) );
+			if( status_ != Status::Complete )
+			{
+				return;
+			}
+
+			if( distance > outputCount_ )
+			{
+				Fail( Status::Invalid );
+				return;
+			}
+
+			// Byte by byte, the source may overlap the copied bytes
+			auto const copied = std::min<std::size_t>( length, outputSize_ - outputCount_ );
+			for( std::size_t index = 0; index < copied; ++index, ++outputCount_ )
+			{
+				output_[outputCount_] = output_[outputCount_ - distance];
+			}
+
+			if( copied < static_cast<std::size_t>( length ) )
+			{
+				Fail( Status::OutputFull );
+				return;
+			}
+		}
+	}
+
+	void Fixed()
+	{
+		short lengths[FixedLengthCodes];
+		auto symbol = 0;
+		for( ; symbol < 144; ++symbol )
+		{
+			lengths[symbol] = 8;
+		}
+
+		for( ; symbol < 256; ++symbol )
+		{
+			lengths[symbol] = 9;
+		}
+
+		for( ; symbol < 280; ++symbol )
+		{
+			lengths[symbol] = 7;
+		}
+
+		for( ; symbol < FixedLengthCodes; ++symbol )
+		{
+			lengths[symbol] = 8;
+		}
+
+		Huffman lengthCode, distanceCode;
+		Construct( lengthCode, lengths, FixedLengthCodes );
+
+		for( symbol = 0; symbol < MaxDistanceCodes; ++symbol )
+		{
+			lengths[symbol] = 5;
+		}
+
+		Construct( distanceCode, lengths, MaxDistanceCodes );
+		Codes( lengthCode, distanceCode );
+	}
+
+	void Dynamic()
+	{
+		static short const CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		auto const lengthCount = Bits( 5 ) + 257;
+		auto const distanceCount = Bits( 5 ) + 1;
+		auto const codeLengthCount = Bits( 4 ) + 4;
+		if( status_ != Status::Complete )
+		{
+			return;
+		}
+
+		if( lengthCount > MaxLengthCodes || distanceCount > MaxDistanceCodes )
+		{
+			Fail( Status::Invalid );
+			return;
+		}
+
+		short lengths[MaxLengthCodes + MaxDistanceCodes];
+		auto index = 0;
+		for( ; index < codeLengthCount; ++index )
+		{
+			lengths[CodeLengthOrder[index]] = static_cast<short>( Bits( 3 ) );
+		}
+
+		for( ; index < 19; ++index )
+		{
+			lengths[CodeLengthOrder[index]] = 0;
+		}
+
+		Huffman lengthCode, distanceCode;
+		if( status_ != Status::Complete || Construct( lengthCode, lengths, 19 ) != 0 )
+		{
+			Fail( Status::Invalid );
+			return;
+		}
+
+		index = 0;
+		while( index < lengthCount + distanceCount )
+		{
+			auto symbol = Decode( lengthCode );
+			if( symbol < 0 )
+			{
+				return;
+			}
+
+			if( symbol < 16 )
+			{
+				lengths[index++] = static_cast<short>( symbol );
+				continue;
+			}
+
+			short length = 0;
+			if( symbol == 16 )
+			{
+				if( index == 0 )
+				{
+					Fail( Status::Invalid );
+					return;
+				}
+
+				length = lengths[index - 1];
+				symbol = 3 + Bits( 2 );
+			}
+			else if( symbol == 17 )
+			{
+				symbol = 3 + Bits( 3 );
+			}
+			else
+			{
+				symbol = 11 + Bits( 7 );
+			}
+
+			if( status_ != Status::Complete )
+			{
+				return;
+			}
+
+			if( index + symbol > lengthCount + distanceCount )
+			{
+				Fail( Status::Invalid );
+				return;
+			}
+
+			while( symbol-- > 0 )
+			{
+				lengths[index++] = length;
+			}
+		}
+
+		// The end of block code is required, incomplete codes are only allowed with a single code
+		if( lengths[256] == 0 )
+		{
+			Fail( Status::Invalid );
+			return;
+		}
+
+		auto error = Construct( lengthCode, lengths, lengthCount );
+		if( error < 0 || ( error > 0 && lengthCount - lengthCode.count[0] != 1 ) )
+		{
+			Fail( Status::Invalid );
+			return;
+		}
+
+		error = Construct( distanceCode, lengths + lengthCount, distanceCount );
+		if( error < 0 || ( error > 0 && distanceCount - distanceCode.count[0] != 1 ) )
+		{
+			Fail( Status::Invalid );
+			return;
+		}
+
+		Codes( lengthCode, distanceCode );
+	}
+
+	Inflater( Inflater const& );
+
+	Inflater& operator=( Inflater const& );
+
+	unsigned char const* input_;
+	std::size_t inputSize_;
+	std::size_t inputCount_;
+
+	unsigned char* output_;
+	std::size_t outputSize_;
+	std::size_t outputCount_;
+
+	std::uint64_t bitBuffer_;
+	int bitCount_;
+
+	Status status_;
+};
+
+}
@@ -12,6 +12,35 @@
 #	define EPHERE_NOEXCEPT
 #endif
 
+#if defined( _MSC_VER ) && _MSC_VER < 1900
+#	define EPHERE_THREAD_LOCAL __declspec( thread )
+#else
+#	define EPHERE_THREAD_LOCAL thread_local
+#endif
+
+// SSE2 is part of every x64 target, 32-bit targets need to enable it
+#if defined( __SSE2__ ) || defined( _M_X64 ) || defined( _M_IX86_FP ) && _M_IX86_FP >= 2
+#	define EPHERE_HAVE_SSE2 1
+#endif
+
+// AVX2 code needs a target enabling it, or a compiler which can build single functions for AVX2: Visual C++ compiles AVX2 intrinsics in any function,
+// GCC 4.9 and Clang in the functions marked with EPHERE_AVX2_FUNCTION. The processor is checked at run time then.
+#if defined( __AVX2__ ) || defined( EPHERE_HAVE_SSE2 ) && defined( _MSC_VER ) && _MSC_VER >= 1800 && !defined( __clang__ )
+#	define EPHERE_HAVE_AVX2 1
+#	define EPHERE_AVX2_FUNCTION
+#elif defined( EPHERE_HAVE_SSE2 ) && !defined( _MSC_VER ) && ( defined( __clang__ ) || __GNUC__ > 4 || __GNUC__ == 4 && __GNUC_MINOR__ >= 9 )
+#	define EPHERE_HAVE_AVX2 1
+#	define EPHERE_AVX2_FUNCTION __attribute__( ( target( "avx2" ) ) )
+#endif
+
+#if defined( _MSC_VER )
+#	define EPHERE_FORCE_INLINE __forceinline
+#elif defined( __GNUC__ )
+#	define EPHERE_FORCE_INLINE inline __attribute__( ( always_inline ) )
+#else
+#	define EPHERE_FORCE_INLINE inline
+#endif
+
 #define EPHERE_NO_UTILITIES
 
 #ifndef UNUSED_VALUE
@@ -0,0 +1,174 @@
+// Must compile with VC 2012 / GCC 4.8 (partial C++11)
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/MacroTools.h"
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+
+// Declarations compatible with Windows.h, to avoid including it
+struct _SECURITY_ATTRIBUTES;
+union _LARGE_INTEGER;
+
+extern "C" {
+__declspec( dllimport ) void* __stdcall CreateFileA( char const* lpFileName, unsigned long dwDesiredAccess, unsigned long dwShareMode, _SECURITY_ATTRIBUTES* lpSecurityAttributes,
+	unsigned long dwCreationDisposition, unsigned long dwFlagsAndAttributes, void* hTemplateFile );
+__declspec( dllimport ) int __stdcall GetFileSizeEx( void* hFile, _LARGE_INTEGER* lpFileSize );
+__declspec( dllimport ) void* __stdcall CreateFileMappingA( void* hFile, _SECURITY_ATTRIBUTES* lpFileMappingAttributes, unsigned long flProtect, unsigned long dwMaximumSizeHigh,
+	unsigned long dwMaximumSizeLow, char const* lpName );
+__declspec( dllimport ) void* __stdcall MapViewOfFile( void* hFileMappingObject, unsigned long dwDesiredAccess, unsigned long dwFileOffsetHigh, unsigned long dwFileOffsetLow,
+	unsigned __int64 dwNumberOfBytesToMap );
+__declspec( dllimport ) int __stdcall UnmapViewOfFile( void const* lpBaseAddress );
+__declspec( dllimport ) int __stdcall CloseHandle( void* hObject );
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+namespace Ephere
+{
+
+/*! Read-only memory mapping of a whole file.
+
+The contents are paged in by the operating system on first access, so opening a large file is cheap and only the parts which are actually read cost I/O.
+The mapping is page aligned.
+*/
+class MappedFile
+{
+public:
+
+	MappedFile()
+		: data_( nullptr ),
+		size_( 0 )
+	{
+	}
+
+	explicit MappedFile( std::string const& filePath )
+		: data_( nullptr ),
+		size_( 0 )
+	{
+		Open( filePath );
+	}
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	//! Returns false if the file doesn't exist, can't be mapped or is empty
+	bool Open( std::string const& filePath )
+	{
+		Close();
+
+#ifdef _WIN32
+		// GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL
+		auto* const invalidHandle = reinterpret_cast<void*>( static_cast<std::ptrdiff_t>( -1 ) );
+		auto* const file = CreateFileA( filePath.c_str(), 0x80000000UL, 0x1, nullptr, 3, 0x80, nullptr );
+		if( file == invalidHandle )
+		{
+			return false;
+		}
+
+		long long fileSize = 0;
+		void* mapping = nullptr;
+		if( GetFileSizeEx( file, reinterpret_cast<_LARGE_INTEGER*>( &fileSize ) ) != 0 && fileSize > 0 )
+		{
+			// PAGE_READONLY
+			mapping = CreateFileMappingA( file, nullptr, 0x02, 0, 0, nullptr );
+		}
+
+		CloseHandle( file );
+		if( mapping == nullptr )
+		{
+			return false;
+		}
+
+		// FILE_MAP_READ
+		data_ = static_cast<char const*>( MapViewOfFile( mapping, 0x4, 0, 0, 0 ) );
+		CloseHandle( mapping );
+		if( data_ == nullptr )
+		{
+			return false;
+		}
+
+		size_ = static_cast<std::size_t>( fileSize );
+#else
+		auto const file = open( filePath.c_str(), O_RDONLY );
+		if( file < 0 )
+		{
+			return false;
+		}
+
+		struct stat fileStatus;
+		if( fstat( file, &fileStatus ) != 0 || fileStatus.st_size <= 0 )
+		{
+			close( file );
+			return false;
+		}
+
+		auto* const mapped = mmap( nullptr, static_cast<std::size_t>( fileStatus.st_size ), PROT_READ, MAP_PRIVATE, file, 0 );
+		close( file );
+		if( mapped == MAP_FAILED )
+		{
+			return false;
+		}
+
+		data_ = static_cast<char const*>( mapped );
+		size_ = static_cast<std::size_t>( fileStatus.st_size );
+#endif
+		return true;
+	}
+
+	void Close()
+	{
+		if( data_ == nullptr )
+		{
+			return;
+		}
+
+#ifdef _WIN32
+		UnmapViewOfFile( data_ );
+#else
+		munmap( const_cast<char*>( data_ ), size_ );
+#endif
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	EPHERE_NODISCARD bool IsOpen() const
+	{
+		return data_ != nullptr;
+	}
+
+	EPHERE_NODISCARD char const* data() const
+	{
+		return data_;
+	}
+
+	EPHERE_NODISCARD std::size_t size() const
+	{
+		return size_;
+	}
+
+private:
+
+	MappedFile( MappedFile const& );
+
+	MappedFile& operator=( MappedFile const& );
+
+	char const* data_;
+
+	std::size_t size_;
+};
+
+}
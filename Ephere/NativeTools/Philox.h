@@ -0,0 +1,54 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Ephere
+{
+
+/*! Philox4x32-10 counter-based random number generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011).
+
+Random numbers are a pure function of a 128-bit counter and a 64-bit key: every counter gives 4 independent 32-bit values. There is no state carried
+from one number to the next, so any number of a sequence can be computed directly, by any thread, in any order.
+*/
+class Philox4x32
+{
+public:
+
+	typedef std::array<std::uint32_t, 4> Counter;
+	typedef std::array<std::uint32_t, 2> Key;
+
+	enum
+	{
+		RoundCount = 10
+	};
+
+	static Counter Generate( Counter counter, Key key )
+	{
+		for( auto round = 0; round < RoundCount; ++round )
+		{
+			if( round > 0 )
+			{
+				key[0] += 0x9E3779B9u;
+				key[1] += 0xBB67AE85u;
+			}
+
+			auto const product0 = static_cast<std::uint64_t>( 0xD2511F53u ) * counter[0];
+			auto const product1 = static_cast<std::uint64_t>( 0xCD9E8D57u ) * counter[2];
+			Counter const next =
+			{ {
+				static_cast<std::uint32_t>( product1 >> 32 ) ^ counter[1] ^ key[0],
+				static_cast<std::uint32_t>( product1 ),
+				static_cast<std::uint32_t>( product0 >> 32 ) ^ counter[3] ^ key[1],
+				static_cast<std::uint32_t>( product0 )
+			} };
+			counter = next;
+		}
+
+		return counter;
+	}
+};
+
+}
@@ -0,0 +1,88 @@
+// Must compile with VC 2012 / GCC 4.8 (partial C++11)
+
+#pragma once
+
+#include "Ephere/NativeTools/MacroTools.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+
+// Declarations compatible with Windows.h, to avoid including it
+struct _FILETIME;
+
+extern "C" {
+__declspec( dllimport ) void* __stdcall GetCurrentThread();
+__declspec( dllimport ) int __stdcall GetThreadTimes( void* hThread, _FILETIME* lpCreationTime, _FILETIME* lpExitTime, _FILETIME* lpKernelTime, _FILETIME* lpUserTime );
+}
+
+#else
+
+#include <time.h>
+
+#endif
+
+namespace Ephere
+{
+
+//! Measures wall clock time using a monotonic clock
+class Stopwatch
+{
+public:
+
+	typedef std::chrono::steady_clock ClockType;
+
+	Stopwatch()
+		: startTime_( ClockType::now() )
+	{
+	}
+
+	void Restart()
+	{
+		startTime_ = ClockType::now();
+	}
+
+	//! Elapsed time in seconds since construction or the last Restart()
+	EPHERE_NODISCARD double GetElapsedSeconds() const
+	{
+		return std::chrono::duration<double>( ClockType::now() - startTime_ ).count();
+	}
+
+	//! Seconds since the (unspecified) epoch of the monotonic clock, only meaningful for comparisons with other values returned by this function
+	static double GetTimestamp()
+	{
+		return std::chrono::duration<double>( ClockType::now().time_since_epoch() ).count();
+	}
+
+private:
+
+	ClockType::time_point startTime_;
+};
+
+//! Returns the CPU time in seconds consumed by the calling thread, in user and kernel mode
+inline double GetThreadCpuTime()
+{
+#ifdef _WIN32
+	// FILETIME is a pair of 32-bit values counting 100ns intervals
+	unsigned long times[4][2] = {};
+	if( GetThreadTimes( GetCurrentThread(), reinterpret_cast<_FILETIME*>( times[0] ), reinterpret_cast<_FILETIME*>( times[1] ),
+		reinterpret_cast<_FILETIME*>( times[2] ), reinterpret_cast<_FILETIME*>( times[3] ) ) == 0 )
+	{
+		return 0;
+	}
+
+	auto const kernelTime = static_cast<unsigned long long>( times[2][1] ) << 32 | times[2][0];
+	auto const userTime = static_cast<unsigned long long>( times[3][1] ) << 32 | times[3][0];
+	return static_cast<double>( kernelTime + userTime ) * 1e-7;
+#else
+	timespec time;
+	if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &time ) != 0 )
+	{
+		return 0;
+	}
+
+	return static_cast<double>( time.tv_sec ) + static_cast<double>( time.tv_nsec ) * 1e-9;
+#endif
+}
+
+}
@@ -0,0 +1,404 @@
+// Must compile with VC 2012 / GCC 4.8 (partial C++11)
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDefault
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/Asserts.h"
+#include "Ephere/NativeTools/Span.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Ephere
+{
+
+/*! A small work-stealing thread pool.
+
+Every worker has its own task queue. Tasks submitted from a worker thread go to the back of that worker's queue and are picked up from there first (LIFO),
+which keeps the data produced by a task hot in the cache of the thread consuming it. Idle workers steal from the front of the other queues.
+*/
+class ThreadPool
+{
+public:
+
+	typedef std::function<void()> TaskType;
+
+	//! threadCount of 0 or less uses the number of hardware threads
+	explicit ThreadPool( int threadCount = 0 )
+		: pendingTaskCount_( 0 ),
+		nextQueueIndex_( 0 ),
+		isStopping_( false )
+	{
+		if( threadCount <= 0 )
+		{
+			threadCount = GetHardwareThreadCount();
+		}
+
+		queues_.resize( threadCount );
+		for( auto index = 0; index < threadCount; ++index )
+		{
+			queues_[index] = std::unique_ptr<Queue>( new Queue );
+		}
+
+		threads_.reserve( threadCount );
+		for( auto index = 0; index < threadCount; ++index )
+		{
+			threads_.push_back( std::thread( &ThreadPool::WorkerLoop, this, index ) );
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( wakeMutex_ );
+			isStopping_ = true;
+		}
+
+		wakeCondition_.notify_all();
+		for( auto& thread : threads_ )
+		{
+			thread.join();
+		}
+	}
+
+	static int GetHardwareThreadCount()
+	{
+		return std::max( 1, static_cast<int>( std::thread::hardware_concurrency() ) );
+	}
+
+	EPHERE_NODISCARD int GetThreadCount() const
+	{
+		return static_cast<int>( threads_.size() );
+	}
+
+	//! Returns the index of the calling worker thread, or -1 if it is called from a thread which doesn't belong to this pool
+	EPHERE_NODISCARD int GetCurrentWorkerIndex() const
+	{
+		auto const currentId = std::this_thread::get_id();
+		for( auto index = 0; index < static_cast<int>( threads_.size() ); ++index )
+		{
+			if( threads_[index].get_id() == currentId )
+			{
+				return index;
+			}
+		}
+
+		return -1;
+	}
+
+	void Submit( TaskType task )
+	{
+		auto queueIndex = GetCurrentWorkerIndex();
+		if( queueIndex < 0 )
+		{
+			queueIndex = static_cast<int>( nextQueueIndex_++ % queues_.size() );
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( queues_[queueIndex]->mutex );
+			queues_[queueIndex]->tasks.push_back( std::move( task ) );
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( wakeMutex_ );
+			++pendingTaskCount_;
+		}
+
+		wakeCondition_.notify_one();
+	}
+
+	/*! Runs one queued task on the calling thread, if it is a worker of this pool and there is a queued task.
+	A worker waiting for other tasks of the pool calls this instead of blocking, since the tasks it waits for may need its thread.
+	@return false if no task was run
+	*/
+	bool RunPendingTask()
+	{
+		auto const workerIndex = GetCurrentWorkerIndex();
+		if( workerIndex < 0 )
+		{
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( wakeMutex_ );
+			if( pendingTaskCount_ == 0 )
+			{
+				return false;
+			}
+
+			--pendingTaskCount_;
+		}
+
+		TaskType task;
+		while( !TryPop( workerIndex, task ) )
+		{
+			std::this_thread::yield();
+		}
+
+		task();
+		return true;
+	}
+
+private:
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<TaskType> tasks;
+	};
+
+	ThreadPool( ThreadPool const& );
+
+	ThreadPool& operator=( ThreadPool const& );
+
+	bool TryPop( int const workerIndex, TaskType& result )
+	{
+		// Own queue first, newest task
+		{
+			auto& queue = *queues_[workerIndex];
+			std::lock_guard<std::mutex> lock( queue.mutex );
+			if( !queue.tasks.empty() )
+			{
+				result = std::move( queue.tasks.back() );
+				queue.tasks.pop_back();
+				return true;
+			}
+		}
+
+		// Steal the oldest task from another worker
+		auto const queueCount = static_cast<int>( queues_.size() );
+		for( auto offset = 1; offset < queueCount; ++offset )
+		{
+			auto& queue = *queues_[( workerIndex + offset ) % queueCount];
+			std::lock_guard<std::mutex> lock( queue.mutex );
+			if( !queue.tasks.empty() )
+			{
+				result = std::move( queue.tasks.front() );
+				queue.tasks.pop_front();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void WorkerLoop( int const workerIndex )
+	{
+		for( ;; )
+		{
+			{
+				std::unique_lock<std::mutex> lock( wakeMutex_ );
+				wakeCondition_.wait( lock, [this]
+				{
+					return isStopping_ || pendingTaskCount_ > 0;
+				} );
+
+				if( pendingTaskCount_ == 0 )
+				{
+					return;
+				}
+
+				--pendingTaskCount_;
+			}
+
+			// A task is guaranteed to be in one of the queues since the pending count was decremented, but another worker may be holding a queue lock
+			TaskType task;
+			while( !TryPop( workerIndex, task ) )
+			{
+				std::this_thread::yield();
+			}
+
+			task();
+		}
+	}
+
+	std::vector<std::unique_ptr<Queue>> queues_;
+
+	std::vector<std::thread> threads_;
+
+	std::mutex wakeMutex_;
+
+	std::condition_variable wakeCondition_;
+
+	int pendingTaskCount_;
+
+	std::atomic<unsigned> nextQueueIndex_;
+
+	bool isStopping_;
+};
+
+/*! Executes a directed acyclic graph of tasks, starting each task as soon as all of its predecessors have completed.
+@param pool Pool to run the tasks on. If nullptr, tasks are executed serially on the calling thread in dependency order.
+@param predecessors For each task, the indices of the tasks that need to complete before it can start
+@param function Called as bool( int taskIndex ) for each task. Returning false marks the task as failed, and all tasks depending on it are skipped.
+@return true if all tasks were executed and succeeded. Tasks which are part of a cycle (or depend on one) are never started and make the result false.
+Can be called from a task running on the same pool, the calling worker then runs tasks while it waits.
+*/
+template <class TFunction>
+bool RunTaskGraph( ThreadPool* pool, std::vector<std::vector<int>> const& predecessors, TFunction function )
+{
+	auto const taskCount = static_cast<int>( predecessors.size() );
+	std::vector<std::vector<int>> successors( taskCount );
+	std::unique_ptr<std::atomic<int>[]> remainingPredecessorCounts( new std::atomic<int>[taskCount] );
+	std::unique_ptr<std::atomic<bool>[]> hasFailedPredecessor( new std::atomic<bool>[taskCount] );
+	for( auto taskIndex = 0; taskIndex < taskCount; ++taskIndex )
+	{
+		remainingPredecessorCounts[taskIndex] = static_cast<int>( predecessors[taskIndex].size() );
+		hasFailedPredecessor[taskIndex] = false;
+		for( auto const predecessorIndex : predecessors[taskIndex] )
+		{
+			successors[predecessorIndex].push_back( taskIndex );
+		}
+	}
+
+	// Tasks which are part of a cycle never become ready, find out how many tasks can actually run
+	std::vector<int> ready;
+	auto schedulableCount = 0;
+	{
+		// Tasks in the order they become ready, the ones before schedulableCount have been visited
+		std::vector<int> counts( taskCount );
+		std::vector<int> schedulable;
+		schedulable.reserve( taskCount );
+		for( auto taskIndex = 0; taskIndex < taskCount; ++taskIndex )
+		{
+			counts[taskIndex] = static_cast<int>( predecessors[taskIndex].size() );
+			if( counts[taskIndex] == 0 )
+			{
+				ready.push_back( taskIndex );
+				schedulable.push_back( taskIndex );
+			}
+		}
+
+		for( ; schedulableCount < static_cast<int>( schedulable.size() ); ++schedulableCount )
+		{
+			for( auto const successorIndex : successors[schedulable[schedulableCount]] )
+			{
+				if( --counts[successorIndex] == 0 )
+				{
+					schedulable.push_back( successorIndex );
+				}
+			}
+		}
+	}
+
+	std::atomic<int> completedCount( 0 );
+	std::atomic<bool> allSucceeded( schedulableCount == taskCount );
+
+	if( pool == nullptr || pool->GetThreadCount() <= 1 )
+	{
+		// Process in ascending order where possible so the serial order matches the order of the tasks
+		std::reverse( ready.begin(), ready.end() );
+		while( !ready.empty() )
+		{
+			auto const taskIndex = ready.back();
+			ready.pop_back();
+
+			auto const succeeded = !hasFailedPredecessor[taskIndex] && function( taskIndex );
+			if( !succeeded )
+			{
+				allSucceeded = false;
+			}
+
+			for( auto successorIndex = successors[taskIndex].rbegin(); successorIndex != successors[taskIndex].rend(); ++successorIndex )
+			{
+				if( !succeeded )
+				{
+					hasFailedPredecessor[*successorIndex] = true;
+				}
+
+				if( --remainingPredecessorCounts[*successorIndex] == 0 )
+				{
+					ready.push_back( *successorIndex );
+				}
+			}
+		}
+
+		return allSucceeded;
+	}
+
+	if( schedulableCount == 0 )
+	{
+		return allSucceeded;
+	}
+
+	std::mutex doneMutex;
+	std::condition_variable doneCondition;
+	auto isDone = false;
+
+	// Tasks schedule their successors, so the callable needs to refer to itself
+	std::function<void( int )> runTask;
+	runTask = [&]( int const taskIndex )
+	{
+		auto const succeeded = !hasFailedPredecessor[taskIndex] && function( taskIndex );
+		if( !succeeded )
+		{
+			allSucceeded = false;
+		}
+
+		for( auto const successorIndex : successors[taskIndex] )
+		{
+			if( !succeeded )
+			{
+				hasFailedPredecessor[successorIndex] = true;
+			}
+
+			if( --remainingPredecessorCounts[successorIndex] == 0 )
+			{
+				pool->Submit( [&runTask, successorIndex]
+				{
+					runTask( successorIndex );
+				} );
+			}
+		}
+
+		// Only signal completion after all successors were submitted, the graph state lives on the caller's stack
+		if( ++completedCount == schedulableCount )
+		{
+			std::lock_guard<std::mutex> lock( doneMutex );
+			isDone = true;
+			doneCondition.notify_all();
+		}
+	};
+
+	for( auto const taskIndex : ready )
+	{
+		pool->Submit( [&runTask, taskIndex]
+		{
+			runTask( taskIndex );
+		} );
+	}
+
+	// A graph run from a task of the same pool (e.g. an operator splitting its strands while the evaluator applies nodes in parallel) mustn't block its
+	// worker, all workers could end up waiting for tasks which no thread is left to run. Workers run queued tasks until the graph is done instead.
+	auto const isWorker = pool->GetCurrentWorkerIndex() >= 0;
+	std::unique_lock<std::mutex> lock( doneMutex );
+	while( !isDone )
+	{
+		if( !isWorker )
+		{
+			doneCondition.wait( lock );
+			continue;
+		}
+
+		lock.unlock();
+		auto const hasRunTask = pool->RunPendingTask();
+		lock.lock();
+		if( !hasRunTask && !isDone )
+		{
+			doneCondition.wait_for( lock, std::chrono::microseconds( 100 ) );
+		}
+	}
+
+	return allSucceeded;
+}
+
+}
@@ -0,0 +1,473 @@
+// Must compile with VC 2012 / GCC 4.8 (partial C++11)
+
+#pragma once
+
+#include "Ephere/NativeTools/Deflate.h"
+#include "Ephere/NativeTools/Inflate.h"
+#include "Ephere/NativeTools/StringToolsBase.h"
+#include "Ephere/NativeTools/ThreadPool.h"
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace Ephere
+{
+
+/*! CRC-32 of zip archives. Checksums of consecutive pieces of data can be computed independently and combined.
+*/
+class Crc32
+{
+public:
+
+	Crc32()
+	{
+		for( std::uint32_t index = 0; index < 256; ++index )
+		{
+			auto value = index;
+			for( auto bit = 0; bit < 8; ++bit )
+			{
+				value = value & 1 ? value >> 1 ^ Polynomial : value >> 1;
+			}
+
+			tables_[0][index] = value;
+		}
+
+		for( auto index = 0; index < 256; ++index )
+		{
+			for( auto table = 1; table < 4; ++table )
+			{
+				tables_[table][index] = tables_[table - 1][index] >> 8 ^ tables_[0][tables_[table - 1][index] & 0xff];
+			}
+		}
+	}
+
+	//! Continues the checksum crc with more data, start with 0
+	std::uint32_t Update( std::uint32_t crc, void const* data, std::size_t size ) const
+	{
+		auto const* bytes = static_cast<unsigned char const*>( data );
+		crc = ~crc;
+		for( ; size >= 4; size -= 4, bytes += 4 )
+		{
+			crc ^= static_cast<std::uint32_t>( bytes[0] | bytes[1] << 8 | bytes[2] << 16 ) | static_cast<std::uint32_t>( bytes[3] ) << 24;
+			crc = tables_[3][crc & 0xff] ^ tables_[2][crc >> 8 & 0xff] ^ tables_[1][crc >> 16 & 0xff] ^ tables_[0][crc >> 24];
+		}
+
+		for( ; size > 0; --size, ++bytes )
+		{
+			crc = crc >> 8 ^ tables_[0][( crc ^ *bytes ) & 0xff];
+		}
+
+		return ~crc;
+	}
+
+	//! Returns the checksum of two consecutive pieces of data, secondSize being the size of the second one
+	static std::uint32_t Combine( std::uint32_t firstCrc, std::uint32_t secondCrc, std::uint64_t secondSize )
+	{
+		if( secondSize == 0 )
+		{
+			return firstCrc;
+		}
+
+		// Appending zero bits is a linear operation, applied with matrices for 1, 2, 4, ... zero bytes
+		std::uint32_t even[32], odd[32];
+		odd[0] = Polynomial;
+		for( std::uint32_t index = 1, row = 1; index < 32; ++index, row <<= 1 )
+		{
+			odd[index] = row;
+		}
+
+		Square( even, odd );
+		Square( odd, even );
+		for( ;; )
+		{
+			Square( even, odd );
+			if( secondSize & 1 )
+			{
+				firstCrc = Multiply( even, firstCrc );
+			}
+
+			secondSize >>= 1;
+			if( secondSize == 0 )
+			{
+				break;
+			}
+
+			Square( odd, even );
+			if( secondSize & 1 )
+			{
+				firstCrc = Multiply( odd, firstCrc );
+			}
+
+			secondSize >>= 1;
+			if( secondSize == 0 )
+			{
+				break;
+			}
+		}
+
+		return firstCrc ^ secondCrc;
+	}
+
+private:
+
+	enum : std::uint32_t
+	{
+		Polynomial = 0xedb88320u
+	};
+
+	static std::uint32_t Multiply( std::uint32_t const* matrix, std::uint32_t vector )
+	{
+		std::uint32_t result = 0;
+		for( ; vector != 0; vector >>= 1, ++matrix )
+		{
+			if( vector & 1 )
+			{
+				result ^= *matrix;
+			}
+		}
+
+		return result;
+	}
+
+	static void Square( std::uint32_t* result, std::uint32_t const* matrix )
+	{
+		for( auto index = 0; index < 32; ++index )
+		{
+			result[index] = Multiply( matrix, matrix[index] );
+		}
+	}
+
+	std::uint32_t tables_[4][256];
+};
+
+struct ZipArchiveEntry
+{
+	std::string name;
+
+	std::string contents;
+};
+
+//! Entry to be written, the data is not copied
+struct ZipArchiveEntryView
+{
+	std::string_view name;
+
+	std::string_view contents;
+};
+
+namespace Detail
+{
+
+enum
+{
+	ZipLocalHeaderSignature = 0x04034b50,
+	ZipDirectoryEntrySignature = 0x02014b50,
+	ZipEndOfDirectorySignature = 0x06054b50,
+	ZipLocalHeaderSize = 30,
+	ZipDirectoryEntrySize = 46,
+	ZipEndOfDirectorySize = 22,
+	ZipVersion = 20,
+	ZipMethodStored = 0,
+	ZipMethodDeflated = 8,
+	MaxDeflateRatio = 1032,
+	// 1980-01-01, the earliest date zip can store
+	ZipDate = 0x21
+};
+
+inline void StoreZipValue( std::string& output, std::uint32_t value, int size )
+{
+	for( auto index = 0; index < size; ++index, value >>= 8 )
+	{
+		output.push_back( static_cast<char>( value & 0xff ) );
+	}
+}
+
+inline std::uint32_t LoadZipValue( char const* data, int size )
+{
+	std::uint32_t result = 0;
+	for( auto index = size - 1; index >= 0; --index )
+	{
+		result = result << 8 | static_cast<unsigned char>( data[index] );
+	}
+
+	return result;
+}
+
+}
+
+/*! Writes the entries as a zip archive.
+
+Every entry is split into chunks of chunkSize bytes which are compressed and checksummed concurrently on the pool (serially if it is nullptr), so a
+single large entry, like a baked hair cache, is compressed by all threads too. Entries which don't get smaller are stored instead.
+Zip64 is not supported, returns false if the archive would need it.
+@param compressionLevel Deflater level, 0 stores all entries
+*/
+inline bool WriteZipArchive( std::vector<ZipArchiveEntryView> const& entries, int compressionLevel, ThreadPool* pool, std::ostream& output,
+	std::size_t chunkSize = 1 << 20 )
+{
+	using namespace Detail;
+
+	struct Chunk
+	{
+		int entryIndex;
+		std::size_t offset;
+		std::size_t size;
+		std::string compressed;
+		std::uint32_t crc;
+	};
+
+	if( entries.size() > 0xffff )
+	{
+		return false;
+	}
+
+	std::vector<Chunk> chunks;
+	for( auto entryIndex = 0; entryIndex < static_cast<int>( entries.size() ); ++entryIndex )
+	{
+		auto const size = entries[entryIndex].contents.length();
+		if( static_cast<std::uint64_t>( size ) >= 0xffffffffu )
+		{
+			return false;
+		}
+
+		std::size_t offset = 0;
+		do
+		{
+			Chunk chunk = { entryIndex, offset, std::min( chunkSize, size - offset ), std::string(), 0 };
+			chunks.push_back( chunk );
+			offset += chunk.size;
+		}
+		while( offset < size );
+	}
+
+	Crc32 const crc32;
+	RunTaskGraph( pool, std::vector<std::vector<int>>( chunks.size() ), [&]( int chunkIndex )
+	{
+		auto& chunk = chunks[chunkIndex];
+		auto const& contents = entries[chunk.entryIndex].contents;
+		auto const isLast = chunk.offset + chunk.size == contents.length();
+		chunk.crc = crc32.Update( 0, contents.data() + chunk.offset, chunk.size );
+		if( compressionLevel > Deflater::NoCompression )
+		{
+			Deflater::Compress( contents.data() + chunk.offset, chunk.size, compressionLevel, isLast, chunk.compressed );
+		}
+
+		return true;
+	} );
+
+	std::string directory;
+	std::uint64_t position = 0;
+	std::size_t chunkIndex = 0;
+	for( auto entryIndex = 0; entryIndex < static_cast<int>( entries.size() ); ++entryIndex )
+	{
+		auto const& entry = entries[entryIndex];
+		auto const firstChunkIndex = chunkIndex;
+		std::uint32_t crc = 0;
+		std::uint64_t compressedSize = 0;
+		for( ; chunkIndex < chunks.size() && chunks[chunkIndex].entryIndex == entryIndex; ++chunkIndex )
+		{
+			crc = Crc32::Combine( crc, chunks[chunkIndex].crc, chunks[chunkIndex].size );
+			compressedSize += chunks[chunkIndex].compressed.size();
+		}
+
+		auto const isDeflated = compressionLevel > Deflater::NoCompression && compressedSize < entry.contents.length();
+		if( !isDeflated )
+		{
+			compressedSize = entry.contents.length();
+		}
+
+		if( position + ZipLocalHeaderSize + entry.name.length() + compressedSize >= 0xffffffffu )
+		{
+			return false;
+		}
+
+		std::string header;
+		StoreZipValue( header, ZipLocalHeaderSignature, 4 );
+		StoreZipValue( header, ZipVersion, 2 );
+		StoreZipValue( header, 0, 2 );
+		StoreZipValue( header, isDeflated ? ZipMethodDeflated : ZipMethodStored, 2 );
+		StoreZipValue( header, 0, 2 );
+		StoreZipValue( header, ZipDate, 2 );
+		StoreZipValue( header, crc, 4 );
+		StoreZipValue( header, static_cast<std::uint32_t>( compressedSize ), 4 );
+		StoreZipValue( header, static_cast<std::uint32_t>( entry.contents.length() ), 4 );
+		StoreZipValue( header, static_cast<std::uint32_t>( entry.name.length() ), 2 );
+		StoreZipValue( header, 0, 2 );
+		header.append( entry.name.data(), entry.name.length() );
+
+		// The directory entry repeats the local header, preceded by the version made by and followed by comment, disk, attributes and header offset
+		StoreZipValue( directory, ZipDirectoryEntrySignature, 4 );
+		StoreZipValue( directory, ZipVersion, 2 );
+		directory.append( header, 4, 26 );
+		StoreZipValue( directory, 0, 2 );
+		StoreZipValue( directory, 0, 2 );
+		StoreZipValue( directory, 0, 2 );
+		StoreZipValue( directory, 0, 4 );
+		StoreZipValue( directory, static_cast<std::uint32_t>( position ), 4 );
+		directory.append( entry.name.data(), entry.name.length() );
+
+		output.write( header.data(), header.size() );
+		if( isDeflated )
+		{
+			for( auto index = firstChunkIndex; index < chunkIndex; ++index )
+			{
+				output.write( chunks[index].compressed.data(), chunks[index].compressed.size() );
+				std::string().swap( chunks[index].compressed );
+			}
+		}
+		else
+		{
+			output.write( entry.contents.data(), entry.contents.length() );
+		}
+
+		position += header.size() + compressedSize;
+	}
+
+	if( position + directory.size() >= 0xffffffffu )
+	{
+		return false;
+	}
+
+	std::string end;
+	StoreZipValue( end, ZipEndOfDirectorySignature, 4 );
+	StoreZipValue( end, 0, 4 );
+	StoreZipValue( end, static_cast<std::uint32_t>( entries.size() ), 2 );
+	StoreZipValue( end, static_cast<std::uint32_t>( entries.size() ), 2 );
+	StoreZipValue( end, static_cast<std::uint32_t>( directory.size() ), 4 );
+	StoreZipValue( end, static_cast<std::uint32_t>( position ), 4 );
+	StoreZipValue( end, 0, 2 );
+	output.write( directory.data(), directory.size() );
+	output.write( end.data(), end.size() );
+	return !output.fail();
+}
+
+/*! Reads all files of a zip archive held in memory, e.g. a MappedFile, decompressing and verifying them concurrently on the pool (serially if it is
+nullptr). Directory entries are skipped. Only stored and deflated entries are supported, and no Zip64 archives.
+*/
+inline bool ReadZipArchive( std::string_view archive, ThreadPool* pool, std::vector<ZipArchiveEntry>& result )
+{
+	using namespace Detail;
+
+	struct Location
+	{
+		std::uint32_t method;
+		std::uint32_t crc;
+		std::uint32_t size;
+		std::string_view data;
+	};
+
+	result.clear();
+	auto const archiveSize = archive.length();
+	if( archiveSize < ZipEndOfDirectorySize )
+	{
+		return false;
+	}
+
+	char const* endOfDirectory = nullptr;
+	auto const searchStart = archiveSize > ZipEndOfDirectorySize + 0xffff ? archiveSize - ZipEndOfDirectorySize - 0xffff : 0;
+	for( auto position = archiveSize - ZipEndOfDirectorySize + 1; position-- > searchStart; )
+	{
+		if( LoadZipValue( archive.data() + position, 4 ) == ZipEndOfDirectorySignature )
+		{
+			endOfDirectory = archive.data() + position;
+			break;
+		}
+	}
+
+	if( endOfDirectory == nullptr )
+	{
+		return false;
+	}
+
+	auto const entryCount = LoadZipValue( endOfDirectory + 10, 2 );
+	auto const directorySize = LoadZipValue( endOfDirectory + 12, 4 );
+	std::size_t position = LoadZipValue( endOfDirectory + 16, 4 );
+	if( position > archiveSize || directorySize > archiveSize - position )
+	{
+		return false;
+	}
+
+	auto const directoryEnd = position + directorySize;
+	std::vector<Location> locations;
+	locations.reserve( entryCount );
+	result.reserve( entryCount );
+	for( std::uint32_t index = 0; index < entryCount; ++index )
+	{
+		if( directoryEnd - position < ZipDirectoryEntrySize || LoadZipValue( archive.data() + position, 4 ) != ZipDirectoryEntrySignature )
+		{
+			return false;
+		}
+
+		auto const* const entry = archive.data() + position;
+		auto const nameLength = LoadZipValue( entry + 28, 2 );
+		auto const entrySize = ZipDirectoryEntrySize + nameLength + LoadZipValue( entry + 30, 2 ) + LoadZipValue( entry + 32, 2 );
+		if( directoryEnd - position < entrySize )
+		{
+			return false;
+		}
+
+		position += entrySize;
+
+		Location location = { LoadZipValue( entry + 10, 2 ), LoadZipValue( entry + 16, 4 ), LoadZipValue( entry + 24, 4 ), std::string_view() };
+		auto const compressedSize = LoadZipValue( entry + 20, 4 );
+		std::size_t const localHeaderOffset = LoadZipValue( entry + 42, 4 );
+		if( localHeaderOffset > archiveSize || archiveSize - localHeaderOffset < ZipLocalHeaderSize
+			|| LoadZipValue( archive.data() + localHeaderOffset, 4 ) != ZipLocalHeaderSignature )
+		{
+			return false;
+		}
+
+		auto const* const localHeader = archive.data() + localHeaderOffset;
+		auto const dataOffset = localHeaderOffset + ZipLocalHeaderSize + LoadZipValue( localHeader + 26, 2 ) + LoadZipValue( localHeader + 28, 2 );
+		if( dataOffset > archiveSize || compressedSize > archiveSize - dataOffset
+			|| ( location.method != ZipMethodStored && location.method != ZipMethodDeflated ) )
+		{
+			return false;
+		}
+
+		// Sizes come from the archive and are allocated later, deflate can't expand data more than 1032 times so larger ones are corrupt
+		if( location.method == ZipMethodStored ? location.size != compressedSize
+			: static_cast<std::uint64_t>( location.size ) > static_cast<std::uint64_t>( compressedSize ) * MaxDeflateRatio + MaxDeflateRatio )
+		{
+			return false;
+		}
+
+		ZipArchiveEntry file;
+		file.name.assign( entry + ZipDirectoryEntrySize, nameLength );
+		if( !file.name.empty() && file.name[file.name.size() - 1] == '/' )
+		{
+			continue;
+		}
+
+		location.data = std::string_view( archive.data() + dataOffset, compressedSize );
+		result.push_back( std::move( file ) );
+		locations.push_back( location );
+	}
+
+	Crc32 const crc32;
+	return RunTaskGraph( pool, std::vector<std::vector<int>>( locations.size() ), [&]( int index )
+	{
+		auto& contents = result[index].contents;
+		auto const& location = locations[index];
+		if( location.method == ZipMethodStored )
+		{
+			contents.assign( location.data.data(), location.data.length() );
+		}
+		else
+		{
+			contents.resize( location.size );
+			auto size = contents.size();
+			if( Inflater::Inflate( location.data.data(), location.data.length(), contents.empty() ? nullptr : &contents[0], size ) != Inflater::Status::Complete
+				|| size != contents.size() )
+			{
+				return false;
+			}
+		}
+
+		return crc32.Update( 0, contents.data(), contents.size() ) == location.crc;
+	} );
+}
+
+}
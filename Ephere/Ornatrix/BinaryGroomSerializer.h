@@ -0,0 +1,810 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/MappedFile.h"
+#include "Ephere/Ornatrix/GroomInfoProbe.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+#include "Ephere/Ornatrix/Groom/DeferredParameterLoader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Binary groom format, optimized for loading speed of heavy grooms.
+
+The structure of the groom (nodes, connections and small parameter values) is serialized by another serializer, normally the default YAML one, and stored as a
+single block. Large arrays of plain data, such as surface positions and per-strand values, are taken out of the structure and stored as raw blocks (see
+SerializeGroom()), and so are the extra files which the structure serializer produces for heavy payloads like baked hair and guide changes. All blocks are
+stored uncompressed and aligned to BlockAlignment, so IGrooms::DeserializeGroomFromFile() memory maps the file and uses them in place instead of parsing text or unzipping archives.
+
+Layout, all integers are little endian:
+	Header: magic, format version, block count, offset and size of the block table, offset and size of the structure block
+	Block data, each block starting at a multiple of BlockAlignment
+	Block table: kind, encoding, offset, size and identification of each block
+The table follows the data so a file can be written in a single pass. The structure block is located by the header too, so GetGroomInfoFromContentBuffer()
+works with just the beginning of a file, see IGrooms::GetGroomInfoFromFile().
+
+Files loaded through DeserializeMappedFileLazily() stay mapped, and the arrays of a node are only copied into its parameters when the node is about to be
+applied by Groom::GraphEvaluator, see Groom::IDeferredParameterLoader. Grooms which are only inspected or partially evaluated never touch most of the file.
+Files loaded through IGrooms, which may pass the groom on to the library, are always loaded completely.
+
+The serializer is not part of the Ornatrix library, it needs to be registered to take part in the serializer lookups of IGrooms:
+	static BinaryGroomSerializer binarySerializer( *grooms.GetGroomSerializers()[0] );
+	IGrooms::RegisterGroomSerializer( binarySerializer, &BinaryGroomSerializer::DeserializeMappedFile );
+*/
+class BinaryGroomSerializer : public IGroomSerializer
+{
+public:
+
+	enum
+	{
+		FormatVersion = 1,
+		HeaderSize = 64,
+		BlockAlignment = 64,
+		DefaultMinimumArrayBlockSize = 4096
+	};
+
+	enum class BlockKind : std::uint32_t
+	{
+		Structure = 0,
+		ExtraFile = 1,
+		ParameterArray = 2
+	};
+
+	//! Only raw blocks are written currently. Readers reject encodings they don't know, so compressed blocks can be added later.
+	enum class BlockEncoding : std::uint32_t
+	{
+		Raw = 0
+	};
+
+	struct Block
+	{
+		BlockKind kind;
+
+		BlockEncoding encoding;
+
+		//! File name of ExtraFile blocks, node name of ParameterArray blocks
+		std::string name;
+
+		//! Identification of the parameter of ParameterArray blocks
+		int setIndex;
+		int parameterId;
+		int elementSize;
+
+		std::string_view data;
+	};
+
+	/*! @param structureSerializer Serializer used for everything except the large arrays, must outlive this object
+	@param minimumArrayBlockSize Arrays with fewer bytes stay in the structure
+	*/
+	explicit BinaryGroomSerializer( IGroomSerializer const& structureSerializer, int minimumArrayBlockSize = DefaultMinimumArrayBlockSize )
+		: structureSerializer_( &structureSerializer ),
+		minimumArrayBlockSize_( minimumArrayBlockSize )
+	{
+	}
+
+	static std::string_view Magic()
+	{
+		return std::string_view( "OXGBIN\x1a\n", 8 );
+	}
+
+	static char const* Extension()
+	{
+		return ".bin";
+	}
+
+	static char const* ExtensionZip()
+	{
+		return ".bin.zip";
+	}
+
+	EPHERE_NODISCARD StringView GroomFileFormatExtension() const override
+	{
+		return Extension();
+	}
+
+	EPHERE_NODISCARD StringView GroomZippedFormatExtension() const override
+	{
+		return ExtensionZip();
+	}
+
+	EPHERE_NODISCARD bool ContentsHasCorrectFormat( StringView contents ) const override
+	{
+		return StartsWith( std::string_view( contents.data(), contents.length() ), Magic() );
+	}
+
+	//! Also accepts the beginning of a file, as long as it contains the header of the structure
+	bool GetGroomInfoFromContentBuffer( StringView contents, GroomInfo& info ) const override
+	{
+		std::vector<Block> blocks;
+		if( !DecodeBlocks( std::string_view( contents.data(), contents.length() ), blocks ) )
+		{
+			std::string_view structure, header;
+			bool isComplete;
+			return DecodeStructurePrefix( std::string_view( contents.data(), contents.length() ), structure, isComplete )
+				&& GroomInfoProbe::GetHeader( structure, isComplete, header )
+				&& structureSerializer_->GetGroomInfoFromContentBuffer( header, info );
+		}
+
+		for( auto const& block : blocks )
+		{
+			if( block.kind == BlockKind::Structure )
+			{
+				return structureSerializer_->GetGroomInfoFromContentBuffer( block.data, info );
+			}
+		}
+
+		return false;
+	}
+
+	/*! Serializes a graph which can't be modified. This is the variant used by IGrooms::SerializeGroomToFile() and the other functions of the library.
+	The graph is left untouched: when it has large arrays, its structure is loaded into a private copy and the arrays of the copy are stored as raw blocks.
+	Saving then takes about twice as long as through the overload below, which moves the arrays out of a mutable graph instead.
+	*/
+	bool SerializeGroom( Groom::IGraph const& graph, GroomSerializeSettings const& settings, SerializedGroom& result ) const override
+	{
+		if( !Groom::LoadDeferredParameters( graph ) )
+		{
+			return false;
+		}
+
+		std::vector<DetachedArray> const noArrays;
+		if( !DetachedArrays::HasArrays( graph, minimumArrayBlockSize_ ) )
+		{
+			return SerializeStructure( graph, settings, noArrays, result );
+		}
+
+		SerializedGroom structure;
+		if( !structureSerializer_->SerializeGroom( graph, settings, structure ) )
+		{
+			return false;
+		}
+
+		// A graph with parameter types the structure serializer can't create without their factories keeps its arrays in the structure
+		auto const copy = structureSerializer_->DeserializeGroom( structure );
+		if( !copy )
+		{
+			return SerializeStructure( structure, noArrays, result );
+		}
+
+		DetachedArrays const detachedArrays( *copy, minimumArrayBlockSize_ );
+		return SerializeStructure( *copy, settings, detachedArrays.GetArrays(), result );
+	}
+
+	/*! Stores the large plain data arrays of the graph as raw blocks. The graph is not copied, the arrays are moved out of their parameters while the
+	structure is serialized and moved back afterwards, so the graph must not be evaluated, read or modified concurrently.
+	*/
+	bool SerializeGroom( Groom::IGraph& graph, GroomSerializeSettings const& settings, SerializedGroom& result ) const
+	{
+		if( !Groom::LoadDeferredParameters( graph ) )
+		{
+			return false;
+		}
+
+		DetachedArrays const detachedArrays( graph, minimumArrayBlockSize_ );
+		return SerializeStructure( graph, settings, detachedArrays.GetArrays(), result );
+	}
+
+	/*! The blocks are used in place, so mapping the file and passing a view of it through SerializedGroom::contentBuffer avoids reading it into memory.
+	The content only needs to stay valid until this function returns.
+	*/
+	EPHERE_NODISCARD UniquePtr<Groom::IGraph> DeserializeGroom(
+		SerializedGroom const& serialized,
+		double time = TimeUndefined,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories = Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>(),
+		StringView extraFilesBaseDirectory = "" ) const override
+	{
+		std::vector<Block> blocks;
+		if( !DecodeBlocks( serialized.contentBuffer, blocks ) )
+		{
+			return UniquePtr<Groom::IGraph>();
+		}
+
+		return DeserializeBlocks( blocks, time, factories, extraFilesBaseDirectory, std::shared_ptr<MappedFile>(), false );
+	}
+
+	/*! Memory maps the file and deserializes the groom from it. Matches IGrooms::FileDeserializerFunctionType.
+	@param serializer Must be a BinaryGroomSerializer
+	*/
+	static UniquePtr<Groom::IGraph> DeserializeMappedFile(
+		IGroomSerializer const& serializer,
+		std::string_view filePath,
+		double time,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories )
+	{
+		return DeserializeMappedFile( serializer, filePath, time, factories, false );
+	}
+
+	/*! Same as DeserializeMappedFile(), but the large arrays are only loaded when their node is applied by Groom::GraphEvaluator. The result is meant to be
+	evaluated through IGrooms::CreateEvaluator(), other uses need Groom::LoadDeferredParameters() first.
+	*/
+	static UniquePtr<Groom::IGraph> DeserializeMappedFileLazily(
+		IGroomSerializer const& serializer,
+		std::string_view filePath,
+		double time,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories )
+	{
+		return DeserializeMappedFile( serializer, filePath, time, factories, true );
+	}
+
+	static Parameters::String EncodeBlocks( std::vector<Block> const& blocks )
+	{
+		std::vector<std::uint64_t> offsets( blocks.size() );
+		std::uint64_t position = HeaderSize;
+		std::uint64_t tableSize = 0;
+		std::uint64_t structureOffset = 0, structureSize = 0;
+		for( std::size_t index = 0; index < blocks.size(); ++index )
+		{
+			position = AlignUp( position, BlockAlignment );
+			offsets[index] = position;
+			if( blocks[index].kind == BlockKind::Structure && structureOffset == 0 )
+			{
+				structureOffset = position;
+				structureSize = blocks[index].data.length();
+			}
+
+			position += blocks[index].data.length();
+			tableSize += AlignUp( TableEntrySize + blocks[index].name.length(), 8 );
+		}
+
+		auto const tableOffset = AlignUp( position, 8 );
+		Parameters::String result( static_cast<Parameters::String::size_type>( tableOffset + tableSize ), '\0' );
+		auto* const output = result.begin();
+
+		auto* header = output;
+		std::memcpy( header, Magic().data(), Magic().length() );
+		header = Store( header + Magic().length(), static_cast<std::uint32_t>( FormatVersion ) );
+		header = Store( header, static_cast<std::uint32_t>( blocks.size() ) );
+		header = Store( header, tableOffset );
+		header = Store( header, tableSize );
+		header = Store( header, structureOffset );
+		Store( header, structureSize );
+
+		auto* entry = output + tableOffset;
+		for( std::size_t index = 0; index < blocks.size(); ++index )
+		{
+			auto const& block = blocks[index];
+			if( !block.data.empty() )
+			{
+				std::memcpy( output + offsets[index], block.data.data(), block.data.length() );
+			}
+
+			auto* const entryStart = entry;
+			entry = Store( entry, static_cast<std::uint32_t>( block.kind ) );
+			entry = Store( entry, static_cast<std::uint32_t>( block.encoding ) );
+			entry = Store( entry, offsets[index] );
+			entry = Store( entry, static_cast<std::uint64_t>( block.data.length() ) );
+			entry = Store( entry, static_cast<std::int32_t>( block.setIndex ) );
+			entry = Store( entry, static_cast<std::int32_t>( block.parameterId ) );
+			entry = Store( entry, static_cast<std::int32_t>( block.elementSize ) );
+			entry = Store( entry, static_cast<std::uint32_t>( block.name.length() ) );
+			std::memcpy( entry, block.name.data(), block.name.length() );
+			entry = entryStart + AlignUp( TableEntrySize + block.name.length(), 8 );
+		}
+
+		return result;
+	}
+
+	//! The data of the decoded blocks points into contents. Returns false if the contents are not in this format or are truncated.
+	static bool DecodeBlocks( std::string_view contents, std::vector<Block>& result )
+	{
+		result.clear();
+		auto const contentSize = static_cast<std::uint64_t>( contents.length() );
+		if( contentSize < HeaderSize || !StartsWith( contents, Magic() ) )
+		{
+			return false;
+		}
+
+		auto const* header = contents.data() + Magic().length();
+		std::uint32_t version, blockCount;
+		std::uint64_t tableOffset, tableSize;
+		header = Load( header, version );
+		header = Load( header, blockCount );
+		header = Load( header, tableOffset );
+		Load( header, tableSize );
+		if( version == 0 || version > FormatVersion || tableOffset > contentSize || tableSize > contentSize - tableOffset )
+		{
+			return false;
+		}
+
+		// Every block takes at least one table entry, which bounds the block count before anything is allocated for it
+		if( blockCount > tableSize / TableEntrySize )
+		{
+			return false;
+		}
+
+		auto const* entry = contents.data() + tableOffset;
+		auto const* const tableEnd = entry + tableSize;
+		result.reserve( blockCount );
+		for( std::uint32_t index = 0; index < blockCount; ++index )
+		{
+			if( tableEnd - entry < TableEntrySize )
+			{
+				return false;
+			}
+
+			auto const* const entryStart = entry;
+			std::uint32_t kind, encoding, nameLength;
+			std::uint64_t offset, size;
+			std::int32_t setIndex, parameterId, elementSize;
+			entry = Load( entry, kind );
+			entry = Load( entry, encoding );
+			entry = Load( entry, offset );
+			entry = Load( entry, size );
+			entry = Load( entry, setIndex );
+			entry = Load( entry, parameterId );
+			entry = Load( entry, elementSize );
+			entry = Load( entry, nameLength );
+			if( static_cast<std::uint64_t>( tableEnd - entry ) < nameLength || offset > contentSize || size > contentSize - offset
+				|| encoding != static_cast<std::uint32_t>( BlockEncoding::Raw ) )
+			{
+				return false;
+			}
+
+			Block block;
+			block.kind = static_cast<BlockKind>( kind );
+			block.encoding = static_cast<BlockEncoding>( encoding );
+			block.name.assign( entry, nameLength );
+			block.setIndex = setIndex;
+			block.parameterId = parameterId;
+			block.elementSize = elementSize;
+			block.data = std::string_view( contents.data() + offset, static_cast<std::size_t>( size ) );
+			result.push_back( std::move( block ) );
+
+			entry = entryStart + std::min<std::uint64_t>( AlignUp( TableEntrySize + nameLength, 8 ), tableEnd - entryStart );
+		}
+
+		return true;
+	}
+
+	/*! Finds the structure block using only the file header, for reading the beginning of files
+	@param isComplete Set to true if contents hold the whole structure block
+	*/
+	static bool DecodeStructurePrefix( std::string_view contents, std::string_view& structure, bool& isComplete )
+	{
+		auto const contentSize = static_cast<std::uint64_t>( contents.length() );
+		if( contentSize < HeaderSize || !StartsWith( contents, Magic() ) )
+		{
+			return false;
+		}
+
+		std::uint32_t version;
+		std::uint64_t structureOffset, structureSize;
+		auto const* header = Load( contents.data() + Magic().length(), version );
+		header = Load( header + 4 + 8 + 8, structureOffset );
+		Load( header, structureSize );
+		if( version == 0 || version > FormatVersion || structureOffset < HeaderSize || structureOffset > contentSize )
+		{
+			return false;
+		}
+
+		isComplete = structureSize <= contentSize - structureOffset;
+		structure = std::string_view( contents.data() + structureOffset, static_cast<std::size_t>( std::min( structureSize, contentSize - structureOffset ) ) );
+		return true;
+	}
+
+	//! Element types whose values can be stored as raw bytes. They are the types with bitwise IType serialization.
+	static bool IsPlainDataType( Parameters::IType const& type )
+	{
+		return type.IsEnum()
+			|| type.Is<bool>()
+			|| type.Is<int>()
+			|| type.Is<std::int64_t>()
+			|| type.Is<float>()
+			|| type.Is<Vector3>()
+			|| type.Is<Xform3>()
+			|| type.Is<Geometry::SurfacePosition>();
+	}
+
+private:
+
+	enum
+	{
+		// kind, encoding, offset, size, set index, parameter id, element size, name length
+		TableEntrySize = 4 + 4 + 8 + 8 + 4 + 4 + 4 + 4
+	};
+
+	// Arrays of a mapped file which are copied into their parameters when their node is applied
+	class DeferredArrays : public Groom::IDeferredParameterLoader
+	{
+	public:
+
+		explicit DeferredArrays( std::shared_ptr<MappedFile> file )
+			: file_( std::move( file ) )
+		{
+		}
+
+		void Add( Groom::INode const& node, Block block )
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			pending_[&node].push_back( std::move( block ) );
+		}
+
+		EPHERE_NODISCARD bool IsEmpty() const
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			return pending_.empty();
+		}
+
+		bool LoadNode( Groom::INode& node ) override
+		{
+			std::vector<Block> blocks;
+			{
+				std::lock_guard<std::mutex> lock( mutex_ );
+				auto const found = pending_.find( &node );
+				if( found == pending_.end() )
+				{
+					return true;
+				}
+
+				blocks.swap( found->second );
+				pending_.erase( found );
+			}
+
+			// The node was replaced by another one at the same address since the graph was loaded
+			if( !IsSameNode( node, blocks ) )
+			{
+				return true;
+			}
+
+			auto result = true;
+			for( auto const& block : blocks )
+			{
+				result = RestoreArray( node, block ) && result;
+			}
+
+			return result;
+		}
+
+		EPHERE_NODISCARD bool HasDeferredValues( Groom::INode const& node ) const override
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			auto const found = pending_.find( &node );
+			return found != pending_.end() && IsSameNode( node, found->second );
+		}
+
+	private:
+
+		// Blocks hold the name of their node, names are unique within a graph
+		static bool IsSameNode( Groom::INode const& node, std::vector<Block> const& blocks )
+		{
+			auto const name = node.GetName();
+			return !blocks.empty() && blocks.front().name == std::string_view( name.data(), name.length() );
+		}
+
+		// Keeps the memory the blocks point to mapped
+		std::shared_ptr<MappedFile> file_;
+
+		mutable std::mutex mutex_;
+
+		std::map<Groom::INode const*, std::vector<Block>> pending_;
+	};
+
+	struct DetachedArray
+	{
+		Groom::INode* node;
+		int setIndex;
+		Parameters::IParameter* parameter;
+		Parameters::IArrayType const* type;
+		std::shared_ptr<void> value;
+	};
+
+	// Takes the large plain data arrays out of the parameters of a graph and puts them back on destruction
+	class DetachedArrays
+	{
+	public:
+
+		DetachedArrays( Groom::IGraph& graph, int minimumByteCount )
+		{
+			auto const nodes = graph.GetNodes();
+			for( auto nodeIndex = 0; nodeIndex < static_cast<int>( nodes.size() ); ++nodeIndex )
+			{
+				auto& node = *nodes[nodeIndex];
+				auto& op = node.GetOperator();
+				for( auto setIndex = 0; setIndex < op.GetParameterSetCount(); ++setIndex )
+				{
+					auto& parameterSet = op.GetParameterSet( setIndex );
+					for( auto parameterIndex = 0; parameterIndex < parameterSet.GetParameterCount(); ++parameterIndex )
+					{
+						Detach( node, setIndex, *parameterSet.GetParameterByIndex( parameterIndex ), minimumByteCount );
+					}
+				}
+			}
+		}
+
+		//! Returns true if the graph has arrays which would be detached, without changing it
+		static bool HasArrays( Groom::IGraph const& graph, int minimumByteCount )
+		{
+			auto const nodes = graph.GetNodes();
+			for( auto nodeIndex = 0; nodeIndex < static_cast<int>( nodes.size() ); ++nodeIndex )
+			{
+				auto const& op = nodes[nodeIndex]->GetOperator();
+				for( auto setIndex = 0; setIndex < op.GetParameterSetCount(); ++setIndex )
+				{
+					auto const& parameterSet = op.GetParameterSet( setIndex );
+					for( auto parameterIndex = 0; parameterIndex < parameterSet.GetParameterCount(); ++parameterIndex )
+					{
+						if( IsDetachable( *nodes[nodeIndex], setIndex, *parameterSet.GetParameterByIndex( parameterIndex ), minimumByteCount ) )
+						{
+							return true;
+						}
+					}
+				}
+			}
+
+			return false;
+		}
+
+		~DetachedArrays()
+		{
+			for( auto const& detached : arrays_ )
+			{
+				detached.parameter->MoveValueImpl( detached.type->GetTypeId(), detached.value.get() );
+			}
+		}
+
+		EPHERE_NODISCARD std::vector<DetachedArray> const& GetArrays() const
+		{
+			return arrays_;
+		}
+
+	private:
+
+		DetachedArrays( DetachedArrays const& );
+
+		DetachedArrays& operator=( DetachedArrays const& );
+
+		static bool IsDetachable( Groom::INode const& node, int setIndex, Parameters::IParameter const& parameter, int minimumByteCount )
+		{
+			auto const& descriptor = parameter.GetDescriptor();
+			auto const& type = descriptor.GetType();
+			if( !type.IsArray() || descriptor.GetIsTransient() || descriptor.GetDirection() == Parameters::Direction::Out
+				|| !IsPlainDataType( type.GetElementType() )
+				|| node.HasInputConnection( Groom::ParameterRef( node, descriptor.GetId(), setIndex ) ) )
+			{
+				return false;
+			}
+
+			auto const& elementType = type.GetElementType();
+			auto const values = parameter.GetValuesImpl( elementType.GetTypeId() );
+			return parameter.GetValueImpl( type.GetTypeId() ) != nullptr && values.stride == elementType.GetSize()
+				&& static_cast<std::int64_t>( values.count ) * values.stride >= minimumByteCount;
+		}
+
+		void Detach( Groom::INode& node, int setIndex, Parameters::IParameter& parameter, int minimumByteCount )
+		{
+			if( !IsDetachable( node, setIndex, parameter, minimumByteCount ) )
+			{
+				return;
+			}
+
+			auto const& type = parameter.GetDescriptor().GetType();
+			auto const* const value = parameter.GetValueImpl( type.GetTypeId() );
+
+			// Arrays holding their data by reference are shared rather than copied, the parameter is then emptied through its own interface
+			DetachedArray detached = { &node, setIndex, &parameter, &static_cast<Parameters::IArrayType const&>( type ), type.Construct() };
+			type.ShareValue( value, detached.value.get() );
+			auto const empty = type.Construct();
+			if( !parameter.MoveValueImpl( type.GetTypeId(), empty.get() ) )
+			{
+				return;
+			}
+
+			arrays_.push_back( std::move( detached ) );
+		}
+
+		std::vector<DetachedArray> arrays_;
+	};
+
+	static UniquePtr<Groom::IGraph> DeserializeMappedFile(
+		IGroomSerializer const& serializer,
+		std::string_view filePath,
+		double time,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories,
+		bool loadArraysLazily )
+	{
+		std::string const filePathString( filePath );
+		auto const file = std::make_shared<MappedFile>( filePathString );
+		std::vector<Block> blocks;
+		if( !file->IsOpen() || !DecodeBlocks( std::string_view( file->data(), file->size() ), blocks ) )
+		{
+			return UniquePtr<Groom::IGraph>();
+		}
+
+		auto const directoryLength = filePathString.find_last_of( "/\\" );
+		return static_cast<BinaryGroomSerializer const&>( serializer ).DeserializeBlocks(
+			blocks,
+			time,
+			factories,
+			directoryLength != std::string::npos ? StringView( filePath.data(), directoryLength ) : StringView(),
+			file,
+			loadArraysLazily );
+	}
+
+	bool SerializeStructure( Groom::IGraph const& graph, GroomSerializeSettings const& settings, std::vector<DetachedArray> const& detachedArrays, SerializedGroom& result ) const
+	{
+		SerializedGroom structure;
+		return structureSerializer_->SerializeGroom( graph, settings, structure ) && SerializeStructure( structure, detachedArrays, result );
+	}
+
+	static bool SerializeStructure( SerializedGroom const& structure, std::vector<DetachedArray> const& detachedArrays, SerializedGroom& result )
+	{
+		std::vector<Block> blocks;
+		blocks.push_back( MakeBlock( BlockKind::Structure, "", structure.contentBuffer ) );
+		for( auto index = 0; index < static_cast<int>( structure.extraFileNames.size() ); ++index )
+		{
+			blocks.push_back( MakeBlock( BlockKind::ExtraFile, structure.extraFileNames[index], structure.extraContentBuffers[index] ) );
+		}
+
+		for( auto const& detached : detachedArrays )
+		{
+			auto const values = detached.type->GetValues( detached.value.get() );
+			auto const elementSize = detached.type->GetElementType().GetSize();
+			auto block = MakeBlock(
+				BlockKind::ParameterArray,
+				std::string( detached.node->GetName() ),
+				std::string_view( static_cast<char const*>( values.data ), static_cast<std::size_t>( values.count ) * elementSize ) );
+			block.setIndex = detached.setIndex;
+			block.parameterId = static_cast<int>( detached.parameter->GetDescriptor().GetId() );
+			block.elementSize = elementSize;
+			blocks.push_back( block );
+		}
+
+		result.Clear();
+		result.contentBuffer = EncodeBlocks( blocks );
+		return true;
+	}
+
+	static Block MakeBlock( BlockKind kind, std::string name, std::string_view data )
+	{
+		Block result;
+		result.kind = kind;
+		result.encoding = BlockEncoding::Raw;
+		result.name = std::move( name );
+		result.setIndex = 0;
+		result.parameterId = 0;
+		result.elementSize = 0;
+		result.data = data;
+		return result;
+	}
+
+	UniquePtr<Groom::IGraph> DeserializeBlocks(
+		std::vector<Block> const& blocks,
+		double time,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories,
+		StringView extraFilesBaseDirectory,
+		std::shared_ptr<MappedFile> file,
+		bool loadArraysLazily ) const
+	{
+		SerializedGroom structure;
+		for( auto const& block : blocks )
+		{
+			if( block.kind == BlockKind::Structure )
+			{
+				structure.contentBuffer = Parameters::String::MakeView( block.data );
+			}
+			else if( block.kind == BlockKind::ExtraFile )
+			{
+				structure.extraFileNames.push_back( Parameters::String( block.name ) );
+				structure.extraContentBuffers.push_back( Parameters::String::MakeView( block.data ) );
+			}
+		}
+
+		auto result = structureSerializer_->DeserializeGroom( structure, time, factories, extraFilesBaseDirectory );
+		if( !result )
+		{
+			return result;
+		}
+
+		// Without a mapped file the content is only valid during this call, so the arrays need to be copied right away
+		auto const deferredArrays = loadArraysLazily && file != nullptr ? std::make_shared<DeferredArrays>( file ) : std::shared_ptr<DeferredArrays>();
+		for( auto const& block : blocks )
+		{
+			if( block.kind != BlockKind::ParameterArray )
+			{
+				continue;
+			}
+
+			// Nodes which don't exist anymore are skipped, the same as the structure serializer does with unknown values
+			auto* const node = result->FindNode( block.name );
+			if( node == nullptr )
+			{
+				continue;
+			}
+
+			if( deferredArrays != nullptr )
+			{
+				deferredArrays->Add( *node, block );
+			}
+			else if( !RestoreArray( *node, block ) )
+			{
+				return UniquePtr<Groom::IGraph>();
+			}
+		}
+
+		if( deferredArrays == nullptr || deferredArrays->IsEmpty() )
+		{
+			return result;
+		}
+
+		return Groom::AttachDeferredParameterLoader( std::move( result ), deferredArrays );
+	}
+
+	//! Returns false if the block doesn't match its parameter or the values couldn't be set. Parameters which don't exist anymore are skipped.
+	static bool RestoreArray( Groom::INode& node, Block const& block )
+	{
+		if( block.setIndex < 0 || block.setIndex >= node.GetOperator().GetParameterSetCount() )
+		{
+			return true;
+		}
+
+		auto* const parameter = node.GetOperator().GetParameterSet( block.setIndex ).GetParameterById( static_cast<Parameters::ParameterId>( block.parameterId ) );
+		if( parameter == nullptr )
+		{
+			return true;
+		}
+
+		auto const& type = parameter->GetDescriptor().GetType();
+		if( !type.IsArray() || !IsPlainDataType( type.GetElementType() ) || type.GetElementType().GetSize() != block.elementSize || block.elementSize <= 0
+			|| block.data.length() % block.elementSize != 0 || block.data.length() / block.elementSize > static_cast<std::size_t>( std::numeric_limits<int>::max() ) )
+		{
+			return false;
+		}
+
+		auto const count = static_cast<int>( block.data.length() / block.elementSize );
+		parameter->Resize( count );
+		if( count == 0 )
+		{
+			return true;
+		}
+
+		// Blocks are aligned within the content, but an in-memory content buffer itself may not be
+		void const* source = block.data.data();
+		std::vector<std::uint64_t> alignedCopy;
+		if( reinterpret_cast<std::uintptr_t>( source ) % sizeof( std::uint64_t ) != 0 )
+		{
+			alignedCopy.resize( ( block.data.length() + sizeof( std::uint64_t ) - 1 ) / sizeof( std::uint64_t ) );
+			std::memcpy( alignedCopy.data(), source, block.data.length() );
+			source = alignedCopy.data();
+		}
+
+		return parameter->SetRangeImpl( type.GetElementType().GetTypeId(), std::make_pair( source, count ) );
+	}
+
+	static std::uint64_t AlignUp( std::uint64_t value, std::uint64_t alignment )
+	{
+		return ( value + alignment - 1 ) / alignment * alignment;
+	}
+
+	// The format is little endian, same as all supported platforms, so values are copied as they are
+	template <typename T>
+	static char* Store( char* output, T value )
+	{
+		std::memcpy( output, &value, sizeof( T ) );
+		return output + sizeof( T );
+	}
+
+	template <typename T>
+	static char const* Load( char const* input, T& value )
+	{
+		std::memcpy( &value, input, sizeof( T ) );
+		return input + sizeof( T );
+	}
+
+	IGroomSerializer const* structureSerializer_;
+
+	int minimumArrayBlockSize_;
+};
+
+} }
@@ -0,0 +1,263 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/Geometry/Native/PointBvh.h"
+#include "Ephere/NativeTools/Span.h"
+#include "Ephere/NativeTools/ThreadPool.h"
+#include "Ephere/Ornatrix/StrandRandom.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Assignment of strands to clumps over several clumping levels, and scheduling of the attraction of strands to their clumps, as done by the Clump
+operator with sub-clumps.
+
+Every level has its own clump centers in the lookup space: root positions in object space, or texture coordinates (u, v, 0) when clumping in UV space.
+Centers are indexed with a PointBvh, and each strand gets the closest center of its level. When regions are used (ClumpParameters Region.RespectHairParts),
+only the Region.MaximumClosestRegionClumpCandidates closest centers are considered and the closest one in the region of the strand is taken.
+Assignment of all levels runs in parallel blocks of strands. Centers created at random (ClumpCreateMethodType::Random) can be picked with
+ChooseRandomCenterStrands(), which draws from the StrandRandom of each strand, so they don't depend on how the strands are split between threads.
+
+Attraction runs per level and per block of strands. Instead of finishing a level before starting the next one, a block starts the next level as soon as
+the strands it depends on are done with the previous one:
+	its own strands and the strands followed by its clumps (center strands) have been attracted by the previous level,
+	and no block still reads its strands as center strands of the previous level.
+This pipelines the levels and always gives the same result as processing the levels one after another.
+*/
+class ClumpAssignment
+{
+public:
+
+	typedef Geometry::PointBvh<3> Bvh;
+
+	enum
+	{
+		DefaultStrandsPerBlock = 4096
+	};
+
+	explicit ClumpAssignment( int strandCount, int strandsPerBlock = DefaultStrandsPerBlock )
+		: strandCount_( strandCount ),
+		strandsPerBlock_( std::max( strandsPerBlock, 1 ) )
+	{
+	}
+
+	/*! Adds a clumping level, finer levels come after coarser ones
+	@param centers Clump centers in the lookup space
+	@param centerStrandIndices For each clump, the strand it follows or -1 if it isn't one of the strands (e.g. external clump strands). Null if none are.
+	@param centerRegions Region of each clump center, or null to ignore regions
+	*/
+	void AddLevel( Span<Geometry::Vector3f const> centers, int const* centerStrandIndices = nullptr, int const* centerRegions = nullptr )
+	{
+		levels_.push_back( Level() );
+		auto& level = levels_.back();
+		level.centers.Build( centers.data(), centers.size() );
+		level.centerStrandIndices.assign( centers.size(), -1 );
+		if( centerStrandIndices != nullptr )
+		{
+			level.centerStrandIndices.assign( centerStrandIndices, centerStrandIndices + centers.size() );
+		}
+
+		if( centerRegions != nullptr )
+		{
+			level.centerRegions.assign( centerRegions, centerRegions + centers.size() );
+		}
+
+		level.clumps.assign( strandCount_, -1 );
+	}
+
+	EPHERE_NODISCARD int GetLevelCount() const
+	{
+		return static_cast<int>( levels_.size() );
+	}
+
+	EPHERE_NODISCARD int GetStrandCount() const
+	{
+		return strandCount_;
+	}
+
+	EPHERE_NODISCARD int GetBlockCount() const
+	{
+		return ( strandCount_ + strandsPerBlock_ - 1 ) / strandsPerBlock_;
+	}
+
+	/*! Assigns every strand to a clump of every level
+	@param pool Pool to run on, or null to run on the calling thread
+	@param strandRoots Root of every strand in the lookup space
+	@param strandRegions Region of every strand, or null to ignore regions
+	@param maximumCandidates Number of closest clumps searched for one in the region of the strand, strands without one are not clumped
+	*/
+	bool Assign( ThreadPool* pool, Span<Geometry::Vector3f const> strandRoots, int const* strandRegions = nullptr, int maximumCandidates = 1 )
+	{
+		if( strandRoots.size() != strandCount_ )
+		{
+			return false;
+		}
+
+		auto const blockCount = GetBlockCount();
+		return RunTaskGraph( pool, std::vector<std::vector<int>>( levels_.size() * blockCount ), [&]( int task )
+		{
+			auto& level = levels_[task / blockCount];
+			auto const useRegions = strandRegions != nullptr && !level.centerRegions.empty();
+			auto const candidateCount = useRegions ? std::max( maximumCandidates, 1 ) : 1;
+			std::vector<int> candidates( candidateCount );
+			auto const firstStrand = task % blockCount * strandsPerBlock_;
+			auto const lastStrand = std::min( firstStrand + strandsPerBlock_, strandCount_ );
+			for( auto strand = firstStrand; strand < lastStrand; ++strand )
+			{
+				auto const foundCount = level.centers.FindNearest( strandRoots[strand], candidateCount, candidates.data() );
+				auto clump = -1;
+				for( auto index = 0; index < foundCount && clump < 0; ++index )
+				{
+					if( !useRegions || level.centerRegions[candidates[index]] == strandRegions[strand] )
+					{
+						clump = candidates[index];
+					}
+				}
+
+				level.clumps[strand] = clump;
+			}
+
+			return true;
+		} );
+	}
+
+	/*! Picks the strands followed by randomly created clumps. Every strand draws a key from its own random numbers and the clumpCount strands with the
+	smallest keys are picked, so the picked strands don't depend on the pool, and stay picked when other strands are removed.
+	@param pool Pool to run on, or null to run on the calling thread
+	@param strandIds Id of every strand
+	@return Indices of the picked strands in increasing order, clumpCount of them or all strands if there are fewer
+	*/
+	static std::vector<int> ChooseRandomCenterStrands( ThreadPool* pool, Span<StrandId const> strandIds, int clumpCount, int seed,
+		int strandsPerBlock = DefaultStrandsPerBlock )
+	{
+		auto const strandCount = strandIds.size();
+		strandsPerBlock = std::max( strandsPerBlock, 1 );
+		auto const stream = StrandRandom::GetStream( "ClumpCenters" );
+		std::vector<std::uint32_t> keys( strandCount );
+		RunTaskGraph( pool, std::vector<std::vector<int>>( ( strandCount + strandsPerBlock - 1 ) / strandsPerBlock ), [&]( int block )
+		{
+			auto const lastStrand = std::min( ( block + 1 ) * strandsPerBlock, strandCount );
+			for( auto strand = block * strandsPerBlock; strand < lastStrand; ++strand )
+			{
+				keys[strand] = StrandRandom( seed, strandIds[strand], stream ).NextUnsigned();
+			}
+
+			return true;
+		} );
+
+		std::vector<int> result( strandCount );
+		for( auto strand = 0; strand < strandCount; ++strand )
+		{
+			result[strand] = strand;
+		}
+
+		// Equal keys are ordered by strand id rather than index, so that removing other strands doesn't change which one is picked
+		auto const pickedCount = std::min( std::max( clumpCount, 0 ), strandCount );
+		std::nth_element( result.begin(), result.begin() + pickedCount, result.end(), [&]( int left, int right )
+		{
+			return keys[left] != keys[right] ? keys[left] < keys[right] : strandIds[left] < strandIds[right];
+		} );
+
+		result.resize( pickedCount );
+		std::sort( result.begin(), result.end() );
+		return result;
+	}
+
+	//! Clump of every strand at a level, -1 for strands which are not clumped
+	EPHERE_NODISCARD Span<int const> GetClumps( int level ) const
+	{
+		return Span<int const>( levels_[level].clumps.data(), strandCount_ );
+	}
+
+	/*! Attracts the strands to their clumps, level by level, pipelined as described above
+	@param function Called as bool( int level, int firstStrand, int count ) for every block of strands and level. It may read the strands followed by the
+	clumps of the level and modify the strands of the block, except for the ones which are followed by clumps of the level. Returning false stops the
+	following levels of the block.
+	*/
+	template <class TFunction>
+	bool Attract( ThreadPool* pool, TFunction function ) const
+	{
+		auto const blockCount = GetBlockCount();
+		auto const levelCount = GetLevelCount();
+
+		// Blocks whose strands are followed by the clumps of each block, and the other way around, per level
+		std::vector<std::vector<int>> centerBlocks( levelCount * blockCount );
+		std::vector<std::vector<int>> readerBlocks( levelCount * blockCount );
+		for( auto level = 0; level < levelCount; ++level )
+		{
+			auto const& levelData = levels_[level];
+			for( auto strand = 0; strand < strandCount_; ++strand )
+			{
+				auto const clump = levelData.clumps[strand];
+				auto const centerStrand = clump >= 0 ? levelData.centerStrandIndices[clump] : -1;
+				if( centerStrand >= 0 && centerStrand / strandsPerBlock_ != strand / strandsPerBlock_ )
+				{
+					centerBlocks[level * blockCount + strand / strandsPerBlock_].push_back( centerStrand / strandsPerBlock_ );
+				}
+			}
+
+			for( auto block = 0; block < blockCount; ++block )
+			{
+				auto& blocks = centerBlocks[level * blockCount + block];
+				std::sort( blocks.begin(), blocks.end() );
+				blocks.erase( std::unique( blocks.begin(), blocks.end() ), blocks.end() );
+				for( auto const centerBlock : blocks )
+				{
+					readerBlocks[level * blockCount + centerBlock].push_back( block );
+				}
+			}
+		}
+
+		std::vector<std::vector<int>> predecessors( levelCount * blockCount );
+		for( auto level = 1; level < levelCount; ++level )
+		{
+			auto const previousLevelTask = ( level - 1 ) * blockCount;
+			for( auto block = 0; block < blockCount; ++block )
+			{
+				auto& blockPredecessors = predecessors[level * blockCount + block];
+				blockPredecessors.push_back( previousLevelTask + block );
+
+				// The strands followed by the clumps of this level need to be done with the previous level
+				for( auto const centerBlock : centerBlocks[level * blockCount + block] )
+				{
+					blockPredecessors.push_back( previousLevelTask + centerBlock );
+				}
+
+				// Blocks reading strands of this block as centers of the previous level need to finish before they are modified again
+				for( auto const readerBlock : readerBlocks[previousLevelTask + block] )
+				{
+					blockPredecessors.push_back( previousLevelTask + readerBlock );
+				}
+
+				std::sort( blockPredecessors.begin(), blockPredecessors.end() );
+				blockPredecessors.erase( std::unique( blockPredecessors.begin(), blockPredecessors.end() ), blockPredecessors.end() );
+			}
+		}
+
+		return RunTaskGraph( pool, predecessors, [&]( int task )
+		{
+			auto const firstStrand = task % blockCount * strandsPerBlock_;
+			return function( task / blockCount, firstStrand, std::min( strandsPerBlock_, strandCount_ - firstStrand ) );
+		} );
+	}
+
+private:
+
+	struct Level
+	{
+		Bvh centers;
+		std::vector<int> centerStrandIndices;
+		std::vector<int> centerRegions;
+		std::vector<int> clumps;
+	};
+
+	int strandCount_;
+	int strandsPerBlock_;
+	std::vector<Level> levels_;
+};
+
+} }
@@ -0,0 +1,137 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDefault
+#pragma once
+
+#include "Ephere/Ornatrix/Groom/IGraph.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace Ephere { namespace Ornatrix { namespace Groom
+{
+
+/*! Loads parameter values which a serializer left out while deserializing a graph, to be loaded on first use (see BinaryGroomSerializer).
+
+GraphEvaluator loads the deferred values of each node right before applying it, so nodes which are never applied (disabled nodes, unused branches) never
+load them. The functions of IGrooms implemented in the SDK load all deferred values before they pass a graph on to the library. Functions implemented in the
+library, like IGrooms::EvaluateGroom(), and code reading the parameters directly need LoadDeferredParameters() to be called first.
+*/
+struct IDeferredParameterLoader
+{
+	virtual ~IDeferredParameterLoader()
+	{
+	}
+
+	//! Loads the deferred values of a single node, does nothing if it has none. Returns false if some of the values couldn't be loaded. Thread-safe.
+	virtual bool LoadNode( INode& node ) = 0;
+
+	EPHERE_NODISCARD virtual bool HasDeferredValues( INode const& node ) const = 0;
+};
+
+namespace Detail
+{
+
+// Loaders are only registered by AttachDeferredParameterLoader(), which removes them when the graph is deleted, so an address is never reused while registered
+struct DeferredParameterLoaders
+{
+	std::mutex mutex;
+	std::map<IGraph const*, std::shared_ptr<IDeferredParameterLoader>> loaders;
+
+	static DeferredParameterLoaders& GetInstance()
+	{
+		static DeferredParameterLoaders instance;
+		return instance;
+	}
+
+	void Set( IGraph const& graph, std::shared_ptr<IDeferredParameterLoader> loader )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+		if( loader != nullptr )
+		{
+			loaders[&graph] = std::move( loader );
+		}
+		else
+		{
+			loaders.erase( &graph );
+		}
+	}
+};
+
+}
+
+inline std::shared_ptr<IDeferredParameterLoader> FindDeferredParameterLoader( IGraph const& graph )
+{
+	auto& instance = Detail::DeferredParameterLoaders::GetInstance();
+	std::lock_guard<std::mutex> lock( instance.mutex );
+	auto const found = instance.loaders.find( &graph );
+	return found != instance.loaders.end() ? found->second : std::shared_ptr<IDeferredParameterLoader>();
+}
+
+//! Loads the deferred values of a node of the graph, or of all nodes if node is nullptr. Returns true if the graph has no deferred values.
+inline bool LoadDeferredParameters( IGraph const& graph, INode* node = nullptr )
+{
+	auto const loader = FindDeferredParameterLoader( graph );
+	if( loader == nullptr )
+	{
+		return true;
+	}
+
+	if( node != nullptr )
+	{
+		return loader->LoadNode( *node );
+	}
+
+	auto result = true;
+	auto const nodes = graph.GetNodes();
+	for( auto index = 0; index < static_cast<int>( nodes.size() ); ++index )
+	{
+		result = loader->LoadNode( *nodes[index] ) && result;
+	}
+
+	return result;
+}
+
+/*! Associates a loader with a deserialized graph, and wraps the graph so that the loader is removed when the graph is deleted.
+The loader may keep the source of the deferred values (e.g. a mapped file) alive, and graph addresses get reused.
+*/
+inline UniquePtr<IGraph> AttachDeferredParameterLoader( UniquePtr<IGraph> graph, std::shared_ptr<IDeferredParameterLoader> loader )
+{
+	struct Owner : Ephere_OwnerContainer
+	{
+		explicit Owner( Ephere_OwnerContainer* graphOwner )
+			: graphOwner( graphOwner )
+		{
+			Deleter = Release;
+		}
+
+		static void Release( void const* pointer, Ephere_OwnerContainer* owner )
+		{
+			auto* const self = static_cast<Owner*>( owner );
+			if( pointer != nullptr )
+			{
+				Detail::DeferredParameterLoaders::GetInstance().Set( *static_cast<IGraph const*>( pointer ), std::shared_ptr<IDeferredParameterLoader>() );
+				if( self->graphOwner != nullptr )
+				{
+					self->graphOwner->Deleter( pointer, self->graphOwner );
+				}
+			}
+
+			delete self;
+		}
+
+		Ephere_OwnerContainer* graphOwner;
+	};
+
+	if( !graph || loader == nullptr )
+	{
+		return graph;
+	}
+
+	Detail::DeferredParameterLoaders::GetInstance().Set( *graph, std::move( loader ) );
+	auto* const owner = new Owner( graph.ReleaseOwnership() );
+	return UniquePtr<IGraph>( graph.release(), owner );
+}
+
+} } }
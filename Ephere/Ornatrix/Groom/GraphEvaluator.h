@@ -0,0 +1,833 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDefault
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/Stopwatch.h"
+#include "Ephere/NativeTools/ThreadPool.h"
+#include "Ephere/Ornatrix/Groom/DeferredParameterLoader.h"
+#include "Ephere/Ornatrix/Groom/GroomProfile.h"
+#include "Ephere/Ornatrix/Groom/HairPool.h"
+#include "Ephere/Ornatrix/Groom/IGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace Ephere { namespace Ornatrix { namespace Groom
+{
+
+/*! Evaluates the nodes of a groom graph as a task graph.
+
+Each node becomes a task whose predecessors are the nodes wired into its inputs, so independent branches of the graph (e.g. guides and a separate
+distribution mesh or several generators feeding a merge) are applied concurrently on EvaluationContextExtension::workerCount threads.
+Values are propagated along the connections right before a node is applied: In parameters share the source value, InOut parameters receive a copy since
+the operator modifies them in place, and array targets with several sources are filled element by element. Disabled nodes share their input instead of
+copying it.
+
+The evaluator is meant to persist between evaluations of the same graph. Node outputs stay in the node parameters, and a repeated Evaluate() only applies
+nodes which are dirty (INode::IsDirty), failed, were never evaluated or weren't reached by a cancelled evaluation, together with all nodes downstream
+of them. GetExecutedNodeIndices() reports
+which nodes were applied by the last evaluation.
+
+The evaluator caches the graph structure. Call Rebuild() after adding, removing or reconnecting nodes.
+*/
+class GraphEvaluator
+{
+public:
+
+	explicit GraphEvaluator( IGraph& graph )
+		: graph_( &graph ),
+		processedNodeCount_( 0 ),
+		isCancelled_( false ),
+		status_( ApplyResult::Succeeded ),
+		poolThreadCount_( 0 )
+	{
+		Rebuild();
+	}
+
+	virtual ~GraphEvaluator()
+	{
+	}
+
+	//! Re-reads the nodes and connections of the graph
+	void Rebuild()
+	{
+		auto const nodes = graph_->GetNodes();
+		nodes_.assign( nodes.begin(), nodes.end() );
+
+		nodeIndices_.clear();
+		for( auto index = 0; index < static_cast<int>( nodes_.size() ); ++index )
+		{
+			nodeIndices_[nodes_[index]] = index;
+		}
+
+		isCached_.assign( nodes_.size(), 0 );
+		isExecuted_.assign( nodes_.size(), 0 );
+		executedNodeIndices_.clear();
+
+		predecessors_.assign( nodes_.size(), std::vector<int>() );
+		for( auto index = 0; index < static_cast<int>( nodes_.size() ); ++index )
+		{
+			auto& predecessors = predecessors_[index];
+			for( auto const& connection : nodes_[index]->GetInputConnections() )
+			{
+				for( auto const& source : connection.GetSources() )
+				{
+					auto const sourceIndex = GetNodeIndex( source.ToResolved( *graph_ ).node.Get() );
+					if( sourceIndex >= 0 && sourceIndex != index && std::find( predecessors.begin(), predecessors.end(), sourceIndex ) == predecessors.end() )
+					{
+						predecessors.push_back( sourceIndex );
+					}
+				}
+			}
+		}
+
+		// Kahn's algorithm, nodes which are part of a cycle are left out since they are never applied
+		topologicalOrder_.clear();
+		std::vector<int> remainingPredecessorCounts( nodes_.size() );
+		std::vector<std::vector<int>> successors( nodes_.size() );
+		for( auto index = 0; index < static_cast<int>( nodes_.size() ); ++index )
+		{
+			remainingPredecessorCounts[index] = static_cast<int>( predecessors_[index].size() );
+			for( auto const predecessorIndex : predecessors_[index] )
+			{
+				successors[predecessorIndex].push_back( index );
+			}
+
+			if( predecessors_[index].empty() )
+			{
+				topologicalOrder_.push_back( index );
+			}
+		}
+
+		for( auto position = 0; position < static_cast<int>( topologicalOrder_.size() ); ++position )
+		{
+			for( auto const successorIndex : successors[topologicalOrder_[position]] )
+			{
+				if( --remainingPredecessorCounts[successorIndex] == 0 )
+				{
+					topologicalOrder_.push_back( successorIndex );
+				}
+			}
+		}
+	}
+
+	EPHERE_NODISCARD IGraph& GetGraph() const
+	{
+		return *graph_;
+	}
+
+	EPHERE_NODISCARD int GetNodeCount() const
+	{
+		return static_cast<int>( nodes_.size() );
+	}
+
+	EPHERE_NODISCARD INode& GetNode( int nodeIndex ) const
+	{
+		return *nodes_[nodeIndex];
+	}
+
+	//! Returns -1 if the node is not part of the evaluated graph
+	EPHERE_NODISCARD int GetNodeIndex( INode const* node ) const
+	{
+		auto const iterator = nodeIndices_.find( node );
+		return iterator != nodeIndices_.end() ? iterator->second : -1;
+	}
+
+	//! Indices of the nodes connected to the inputs of the node
+	EPHERE_NODISCARD Span<int const> GetPredecessors( int nodeIndex ) const
+	{
+		return Span<int const>( predecessors_[nodeIndex] );
+	}
+
+	/*! Applies all nodes of the graph which are out of date.
+	If the context has a cancellation token, no further nodes are started once it is cancelled. Nodes which didn't complete stay out of date.
+	@return false if any of the nodes failed to apply or the evaluation was cancelled, see GetStatus(). The nodes depending on a failed node are not applied.
+	*/
+	bool Evaluate( EvaluationContext& context )
+	{
+		std::fill( isExecuted_.begin(), isExecuted_.end(), 0 );
+		processedNodeCount_ = 0;
+		isCancelled_ = false;
+		deferredLoader_ = FindDeferredParameterLoader( *graph_ );
+		MarkOutOfDateNodes();
+		auto* pool = GetThreadPool( context.GetWorkerCount() );
+		auto* const profiler = context.GetProfiler();
+		auto const result = RunTaskGraph( pool, predecessors_, [this, &context, pool, profiler]( int nodeIndex )
+		{
+			if( context.IsCancelled() )
+			{
+				isCancelled_ = true;
+				return false;
+			}
+
+			if( !IsOutOfDate( nodeIndex ) )
+			{
+				ReportNodeProcessed( context );
+				return true;
+			}
+
+			isExecuted_[nodeIndex] = 1;
+
+			// Operators report their own progress, which is mapped into the progress of the whole graph
+			NodeProgress nodeProgress = { this, &context };
+			ExtendedEvaluationContext nodeContext( context );
+			nodeContext.extension.progressFunction = nodeContext.extension.progressFunction != nullptr ? &NodeProgress::Report : nullptr;
+			nodeContext.extension.progressUserData = &nodeProgress;
+
+			auto const startTime = profiler != nullptr ? Stopwatch::GetTimestamp() : 0.0;
+			auto const startCpuTime = profiler != nullptr ? GetThreadCpuTime() : 0.0;
+			auto const applyResult = EvaluateNode( nodeIndex, nodeContext );
+			auto const succeeded = applyResult == ApplyResult::Succeeded;
+			if( profiler != nullptr )
+			{
+				NodeProfile profile = { nodes_[nodeIndex], pool != nullptr ? pool->GetCurrentWorkerIndex() : -1, startTime,
+					Stopwatch::GetTimestamp() - startTime, GetThreadCpuTime() - startCpuTime, -1, -1, 0, succeeded };
+				if( auto const* hair = FindOutputHair( *nodes_[nodeIndex] ) )
+				{
+					profile.outputStrandCount = ( *hair )->GetStrandCount();
+					profile.outputVertexCount = ( *hair )->GetVertexCount();
+					profile.outputByteCount = static_cast<std::int64_t>( profile.outputVertexCount ) * sizeof( Vector3 )
+						+ static_cast<std::int64_t>( profile.outputStrandCount ) * ( sizeof( StrandTopology ) + sizeof( StrandId ) );
+				}
+
+				profiler->OnNodeEvaluated( profile );
+			}
+
+			if( applyResult == ApplyResult::Cancelled )
+			{
+				isCancelled_ = true;
+			}
+
+			if( !succeeded )
+			{
+				return false;
+			}
+
+			isCached_[nodeIndex] = 1;
+			ReportNodeProcessed( context );
+			return true;
+		} );
+
+		executedNodeIndices_.clear();
+		for( auto index = 0; index < static_cast<int>( isExecuted_.size() ); ++index )
+		{
+			if( isExecuted_[index] != 0 )
+			{
+				executedNodeIndices_.push_back( index );
+			}
+		}
+
+		status_ = isCancelled_ ? ApplyResult::Cancelled : result ? ApplyResult::Succeeded : ApplyResult::Failed;
+		return result;
+	}
+
+	//! Result of the last Evaluate() call
+	EPHERE_NODISCARD ApplyResult GetStatus() const
+	{
+		return status_;
+	}
+
+	//! Indices of the nodes which were applied (or attempted to be applied) by the last Evaluate() call, in ascending order
+	EPHERE_NODISCARD Span<int const> GetExecutedNodeIndices() const
+	{
+		return Span<int const>( executedNodeIndices_ );
+	}
+
+	EPHERE_NODISCARD bool WasExecuted( INode const& node ) const
+	{
+		auto const nodeIndex = GetNodeIndex( &node );
+		return nodeIndex >= 0 && isExecuted_[nodeIndex] != 0;
+	}
+
+	//! Forces the node and all nodes depending on it to be applied by the next evaluation
+	void Invalidate( INode const& node )
+	{
+		auto const nodeIndex = GetNodeIndex( &node );
+		if( nodeIndex >= 0 )
+		{
+			isCached_[nodeIndex] = 0;
+		}
+	}
+
+	//! Returns true if the node is downstream of the current time node, which means it needs to be re-applied for every evaluated frame
+	EPHERE_NODISCARD bool IsTimeDependent( int nodeIndex ) const
+	{
+		auto const timeNodeIndex = GetNodeIndex( graph_->FindNode( CurrentTimeNodeName() ) );
+		if( timeNodeIndex < 0 )
+		{
+			return false;
+		}
+
+		std::vector<char> isVisited( nodes_.size(), 0 );
+		std::vector<int> pending( 1, nodeIndex );
+		while( !pending.empty() )
+		{
+			auto const index = pending.back();
+			pending.pop_back();
+			if( index == timeNodeIndex )
+			{
+				return true;
+			}
+
+			for( auto const predecessorIndex : predecessors_[index] )
+			{
+				if( isVisited[predecessorIndex] == 0 )
+				{
+					isVisited[predecessorIndex] = 1;
+					pending.push_back( predecessorIndex );
+				}
+			}
+		}
+
+		return false;
+	}
+
+	//! Forces all nodes to be applied by the next evaluation
+	void InvalidateAll()
+	{
+		std::fill( isCached_.begin(), isCached_.end(), 0 );
+	}
+
+	/*! Returns the hair output of the last node whose hair is not consumed by another node, which is the result of a typical groom.
+	Only valid after Evaluate().
+	*/
+	EPHERE_NODISCARD HairParameter const* GetResultHair() const
+	{
+		for( auto index = static_cast<int>( nodes_.size() ) - 1; index >= 0; --index )
+		{
+			if( auto const* result = FindOutputHair( *nodes_[index], true ) )
+			{
+				return result;
+			}
+		}
+
+		return nullptr;
+	}
+
+	//! Returns the first non-empty hair Out or InOut parameter of the node
+	static HairParameter const* FindOutputHair( INode& node, bool unconnectedOnly = false )
+	{
+		for( auto const& parameter : node.GetOperator().EnumerateParameters() )
+		{
+			auto const direction = parameter.descriptor->GetDirection();
+			if( ( direction == Parameters::Direction::Out || direction == Parameters::Direction::InOut )
+				&& parameter.descriptor->IsOfType<HairParameter>()
+				&& ( !unconnectedOnly || !node.HasOutputConnection( ParameterRef( node, parameter ) ) ) )
+			{
+				auto const* result = static_cast<HairParameter const*>( parameter->GetValueImpl( Parameters::GetTypeId<HairParameter>() ) );
+				if( result != nullptr && !result->IsEmpty() )
+				{
+					return result;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+protected:
+
+	//! Copies the values of all input connections of the node into its parameters
+	bool PropagateInputs( int nodeIndex ) const
+	{
+		auto& node = *nodes_[nodeIndex];
+		for( auto const& connection : node.GetInputConnections() )
+		{
+			auto target = connection.GetTarget();
+			if( target.node.IsEmpty() )
+			{
+				target.node = node;
+			}
+
+			auto* targetParameter = target.ToResolved( *graph_ ).Get();
+			if( targetParameter == nullptr )
+			{
+				return false;
+			}
+
+			auto const& targetDescriptor = targetParameter->GetDescriptor();
+			auto const sources = connection.GetSources();
+			auto const* singleSourceParameter = sources.size() == 1 ? sources[0].ToResolved( *graph_ ).Get() : nullptr;
+			if( singleSourceParameter != nullptr && singleSourceParameter->GetDescriptor().GetIsArray() == targetDescriptor.GetIsArray() )
+			{
+				auto const* value = singleSourceParameter->GetValueImpl( targetDescriptor.GetTypeId() );
+				if( value == nullptr )
+				{
+					return false;
+				}
+
+				auto const isCopied = targetDescriptor.GetDirection() == Parameters::Direction::InOut && node.IsEnabled()
+					? targetParameter->CopyValueImpl( targetDescriptor.GetTypeId(), value )
+					// A disabled node passes its input through unchanged, so it doesn't need a copy of it
+					: targetParameter->ShareValueImpl( targetDescriptor.GetTypeId(), value ) || targetParameter->SetValueImpl( targetDescriptor.GetTypeId(), value );
+				if( !isCopied )
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			// Several sources (or a scalar source) wired into an array
+			auto const elementTypeId = targetDescriptor.GetType().GetElementType().GetTypeId();
+			std::vector<Parameters::ArrayView> values;
+			values.reserve( sources.size() );
+			auto totalCount = 0;
+			for( auto const& source : sources )
+			{
+				auto const* sourceParameter = source.ToResolved( *graph_ ).Get();
+				if( sourceParameter == nullptr )
+				{
+					return false;
+				}
+
+				values.push_back( sourceParameter->GetValuesImpl( elementTypeId ) );
+				if( values.back().stride <= 0 && values.back().count > 0 )
+				{
+					return false;
+				}
+
+				totalCount += values.back().count;
+			}
+
+			targetParameter->Resize( totalCount );
+			auto destinationIndex = 0;
+			for( auto const& view : values )
+			{
+				if( view.count > 0 && !targetParameter->SetRangeImpl( elementTypeId, std::make_pair( view.data, view.count ), destinationIndex ) )
+				{
+					return false;
+				}
+
+				destinationIndex += view.count;
+			}
+		}
+
+		return true;
+	}
+
+	/*! Marks the dirty nodes and all nodes downstream of out of date nodes as out of date, before any node is applied.
+	A node stays out of date until it is applied successfully, so when an evaluation stops early (is cancelled or fails) the nodes downstream of the nodes
+	it did apply are still re-applied by the next one.
+	*/
+	void MarkOutOfDateNodes()
+	{
+		for( auto const nodeIndex : topologicalOrder_ )
+		{
+			auto isOutOfDate = isCached_[nodeIndex] == 0 || nodes_[nodeIndex]->IsDirty();
+			for( auto predecessorIndex = predecessors_[nodeIndex].begin(); !isOutOfDate && predecessorIndex != predecessors_[nodeIndex].end(); ++predecessorIndex )
+			{
+				isOutOfDate = isCached_[*predecessorIndex] == 0;
+			}
+
+			if( isOutOfDate )
+			{
+				isCached_[nodeIndex] = 0;
+			}
+		}
+	}
+
+	EPHERE_NODISCARD bool IsOutOfDate( int nodeIndex ) const
+	{
+		return isCached_[nodeIndex] == 0;
+	}
+
+	virtual ApplyResult EvaluateNode( int nodeIndex, EvaluationContext& context )
+	{
+		auto& node = *nodes_[nodeIndex];
+		if( !PropagateInputs( nodeIndex ) )
+		{
+			return ApplyResult::Failed;
+		}
+
+		if( node.IsEnabled() )
+		{
+			// Values which were deserialized lazily are loaded only once a node is actually applied
+			if( deferredLoader_ != nullptr && !deferredLoader_->LoadNode( node ) )
+			{
+				return ApplyResult::Failed;
+			}
+
+			auto result = ApplyResult::Succeeded;
+			auto* const hairAllocator = context.GetHairAllocator();
+			if( hairAllocator != nullptr )
+			{
+				// Give the previous output back to the allocator, so it can be reused by this or a later node
+				ReleaseOutputHair( node );
+
+				// Operators implemented in the library only know the factory function, route it to the allocator of the context.
+				// The allocator and the original factory are kept per thread, so evaluators running at the same time don't see each other's.
+				auto& currentScope = GetCurrentHairAllocationScope();
+				auto* const previousScope = currentScope;
+				auto const previousFactoryFunction = context.hairFactoryFunction;
+				HairAllocationScope scope = { hairAllocator, previousFactoryFunction != &CreateHairFromCurrentAllocator ? previousFactoryFunction
+					: previousScope != nullptr ? previousScope->factoryFunction : nullptr };
+				currentScope = &scope;
+				GetActiveHairFactoryFunctions().Add( scope.factoryFunction );
+				context.hairFactoryFunction = &CreateHairFromCurrentAllocator;
+
+				result = node.GetOperator().ApplyWithResult( context );
+
+				context.hairFactoryFunction = previousFactoryFunction;
+				GetActiveHairFactoryFunctions().Remove( scope.factoryFunction );
+				currentScope = previousScope;
+			}
+			else
+			{
+				result = node.GetOperator().ApplyWithResult( context );
+			}
+
+			if( result != ApplyResult::Succeeded )
+			{
+				return result;
+			}
+		}
+
+		node.SetDirty( false, false );
+		return ApplyResult::Succeeded;
+	}
+
+	//! Empties the Out hair parameters of the node, releasing the hair unless it is still shared with a downstream node
+	static void ReleaseOutputHair( INode const& node )
+	{
+		for( auto const& parameter : node.GetOperator().EnumerateParameters() )
+		{
+			if( parameter.descriptor->GetDirection() == Parameters::Direction::Out && parameter.descriptor->IsOfType<HairParameter>() )
+			{
+				HairParameter const emptyHair;
+				parameter->SetValueImpl( Parameters::GetTypeId<HairParameter>(), &emptyHair );
+			}
+		}
+	}
+
+	struct HairAllocationScope
+	{
+		IHairAllocator* allocator;
+
+		//! Factory function of the context which was routed to the allocator
+		EvaluationContext::HairFactoryFunctionType factoryFunction;
+	};
+
+	//! Factory functions of the contexts currently routed to an allocator by any evaluator
+	class ActiveHairFactoryFunctions
+	{
+	public:
+
+		void Add( EvaluationContext::HairFactoryFunctionType factoryFunction )
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			factoryFunctions_.push_back( factoryFunction );
+		}
+
+		void Remove( EvaluationContext::HairFactoryFunctionType factoryFunction )
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			factoryFunctions_.erase( std::find( factoryFunctions_.begin(), factoryFunctions_.end(), factoryFunction ) );
+		}
+
+		//! Returns the factory function if all active evaluations use the same one, nullptr otherwise
+		EvaluationContext::HairFactoryFunctionType FindUnique() const
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			if( factoryFunctions_.empty()
+				|| std::find_if( factoryFunctions_.begin(), factoryFunctions_.end(), [this]( EvaluationContext::HairFactoryFunctionType factoryFunction )
+				{
+					return factoryFunction != factoryFunctions_.front();
+				} ) != factoryFunctions_.end() )
+			{
+				return nullptr;
+			}
+
+			return factoryFunctions_.front();
+		}
+
+	private:
+
+		mutable std::mutex mutex_;
+
+		std::vector<EvaluationContext::HairFactoryFunctionType> factoryFunctions_;
+	};
+
+	static HairAllocationScope*& GetCurrentHairAllocationScope()
+	{
+		static EPHERE_THREAD_LOCAL HairAllocationScope* result = nullptr;
+		return result;
+	}
+
+	static ActiveHairFactoryFunctions& GetActiveHairFactoryFunctions()
+	{
+		static ActiveHairFactoryFunctions result;
+		return result;
+	}
+
+	static UniquePtr<IHair> CreateHairFromCurrentAllocator( bool initAsGuides )
+	{
+		if( auto const* scope = GetCurrentHairAllocationScope() )
+		{
+			return scope->allocator->CreateHair( initAsGuides );
+		}
+
+		// Hair created off the thread applying the node (e.g. by an operator splitting its work) can't see the allocator. It comes from the original factory
+		// function, as long as it is the same for all evaluations running right now.
+		auto const factoryFunction = GetActiveHairFactoryFunctions().FindUnique();
+		return factoryFunction != nullptr ? factoryFunction( initAsGuides ) : UniquePtr<IHair>();
+	}
+
+	struct NodeProgress
+	{
+		GraphEvaluator const* evaluator;
+		EvaluationContext const* context;
+
+		static void Report( void* userData, float progress )
+		{
+			auto const& self = *static_cast<NodeProgress const*>( userData );
+			self.context->ReportProgress( ( static_cast<float>( self.evaluator->processedNodeCount_ ) + std::min( std::max( progress, 0.0f ), 1.0f ) )
+				/ static_cast<float>( self.evaluator->nodes_.size() ) );
+		}
+	};
+
+	void ReportNodeProcessed( EvaluationContext const& context )
+	{
+		auto const processedNodeCount = ++processedNodeCount_;
+		context.ReportProgress( static_cast<float>( processedNodeCount ) / static_cast<float>( nodes_.size() ) );
+	}
+
+	ThreadPool* GetThreadPool( int workerCount )
+	{
+		if( workerCount <= 0 )
+		{
+			workerCount = ThreadPool::GetHardwareThreadCount();
+		}
+
+		if( workerCount == 1 )
+		{
+			return nullptr;
+		}
+
+		if( pool_ == nullptr || poolThreadCount_ != workerCount )
+		{
+			pool_.reset();
+			pool_.reset( new ThreadPool( workerCount ) );
+			poolThreadCount_ = workerCount;
+		}
+
+		return pool_.get();
+	}
+
+	IGraph* graph_;
+
+	std::vector<INode*> nodes_;
+
+	std::unordered_map<INode const*, int> nodeIndices_;
+
+	std::vector<std::vector<int>> predecessors_;
+
+	std::vector<int> topologicalOrder_;
+
+	// Flags are stored as char since tasks running in parallel write to different elements, which std::vector<bool> doesn't allow
+	std::vector<char> isCached_;
+
+	std::vector<char> isExecuted_;
+
+	std::vector<int> executedNodeIndices_;
+
+	std::atomic<int> processedNodeCount_;
+
+	std::atomic<bool> isCancelled_;
+
+	ApplyResult status_;
+
+	std::unique_ptr<ThreadPool> pool_;
+
+	std::shared_ptr<IDeferredParameterLoader> deferredLoader_;
+
+	int poolThreadCount_;
+
+private:
+
+	GraphEvaluator( GraphEvaluator const& );
+
+	GraphEvaluator& operator=( GraphEvaluator const& );
+};
+
+
+/*! Sets the value of the current time node of the graph and marks it dirty, so the next evaluation re-applies all time dependent nodes.
+@return false if the graph has no current time node
+*/
+inline bool SetCurrentTime( IGraph const& graph, double time )
+{
+	auto* timeNode = graph.FindNode( CurrentTimeNodeName() );
+	if( timeNode == nullptr || timeNode->GetOperator().GetParameterSetCount() == 0 )
+	{
+		return false;
+	}
+
+	auto* timeParameter = timeNode->GetOperator().GetParameterSet( 0 ).GetParameterByIndex( 0 );
+	if( timeParameter == nullptr )
+	{
+		return false;
+	}
+
+	auto const isSet = timeParameter->IsCompatibleWith<float>()
+		? timeParameter->SetValue( static_cast<float>( time ) )
+		: timeParameter->IsCompatibleWith<Real>() && timeParameter->SetValue( static_cast<Real>( time ) );
+	if( isSet )
+	{
+		timeNode->SetDirty( true, false );
+	}
+
+	return isSet;
+}
+
+/*! Copies the values of the parameters stored in the target graph (inputs which are not transient or connected) which differ in the source graph, e.g. a
+graph deserialized from the same file at another time. Nodes are matched by name and the nodes whose values changed are marked dirty.
+@return false if some of the values couldn't be copied
+*/
+inline bool CopyChangedParameterValues( IGraph const& source, IGraph& target )
+{
+	// Deferred values of the target would later overwrite the copied ones
+	auto result = LoadDeferredParameters( source ) && LoadDeferredParameters( target );
+	for( auto* targetNode : target.GetNodes() )
+	{
+		auto const* sourceNode = source.FindNode( targetNode->GetName() );
+		if( sourceNode == nullptr )
+		{
+			continue;
+		}
+
+		auto& targetOperator = targetNode->GetOperator();
+		auto const& sourceOperator = sourceNode->GetOperator();
+		auto isChanged = false;
+		for( auto setIndex = 0; setIndex < std::min( targetOperator.GetParameterSetCount(), sourceOperator.GetParameterSetCount() ); ++setIndex )
+		{
+			auto& targetSet = targetOperator.GetParameterSet( setIndex );
+			auto const& sourceSet = sourceOperator.GetParameterSet( setIndex );
+			for( auto parameterIndex = 0; parameterIndex < targetSet.GetParameterCount(); ++parameterIndex )
+			{
+				auto& targetParameter = *targetSet.GetParameterByIndex( parameterIndex );
+				auto const& descriptor = targetParameter.GetDescriptor();
+				auto const* sourceParameter = sourceSet.GetParameterById( descriptor.GetId() );
+				if( sourceParameter == nullptr || descriptor.GetIsTransient() || descriptor.GetDirection() == Parameters::Direction::Out
+					|| targetNode->HasInputConnection( ParameterRef( *targetNode, descriptor.GetId(), setIndex ) ) )
+				{
+					continue;
+				}
+
+				auto const& type = descriptor.GetType();
+				auto const* sourceValue = sourceParameter->GetValueImpl( type.GetTypeId() );
+				auto const* targetValue = targetParameter.GetValueImpl( type.GetTypeId() );
+				if( sourceValue == nullptr || targetValue == nullptr || type.AreEqual( sourceValue, targetValue ) )
+				{
+					continue;
+				}
+
+				result = targetParameter.CopyValueImpl( type.GetTypeId(), sourceValue ) && result;
+				isChanged = true;
+			}
+		}
+
+		if( isChanged )
+		{
+			targetNode->SetDirty( true, false );
+		}
+	}
+
+	return result;
+}
+
+/*! Sets the animated parameters of a graph to their values at a time, marking the nodes whose values changed dirty, see IGrooms::CreateParameterTimeFunction().
+Returns false if the values couldn't be set. The parallel EvaluateFrames() calls it concurrently for different graphs.
+*/
+typedef std::function<bool( IGraph&, double time )> ParameterTimeFunctionType;
+
+/*! Called by EvaluateFrames() after each frame was evaluated, with the index of the frame in the time list and the evaluator holding the results.
+Returning false stops the evaluation of further frames.
+*/
+typedef std::function<bool( int frameIndex, double time, GraphEvaluator const& )> FrameCallbackType;
+
+/*! Evaluates the graph at each of the specified times.
+Nodes which don't depend on the current time node (e.g. the distribution mesh, GuidesFromMesh or RootGenerator feeding an animated stack) are applied only
+once, for the first frame. Every following frame only re-applies the nodes downstream of the current time node and of the nodes whose parameters changed.
+The graph only holds the parameter values of the time it was deserialized at. Grooms with animated parameters need setParameterTime to set the values of
+each frame (see IGrooms::CreateParameterTimeFunction()), without it only the current time node changes between frames.
+@return false if the evaluation of any frame failed, the parameters of a frame couldn't be set or the callback stopped it
+*/
+inline bool EvaluateFrames( IGraph& graph, Span<double const> times, FrameCallbackType const& callback, EvaluationContext* context = nullptr,
+	ParameterTimeFunctionType const& setParameterTime = ParameterTimeFunctionType() )
+{
+	EvaluationContext defaultContext = {};
+	auto& evaluationContext = context != nullptr ? *context : defaultContext;
+
+	GraphEvaluator evaluator( graph );
+	for( auto frameIndex = 0; frameIndex < static_cast<int>( times.size() ); ++frameIndex )
+	{
+		SetCurrentTime( graph, times[frameIndex] );
+		if( setParameterTime && !setParameterTime( graph, times[frameIndex] ) )
+		{
+			return false;
+		}
+
+		if( !evaluator.Evaluate( evaluationContext ) || !callback( frameIndex, times[frameIndex], evaluator ) )
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*! Evaluates frames in parallel using several independent instances of the same graph, e.g. deserialized from the same file multiple times.
+The time list is split into contiguous ranges, one per graph, and every graph evaluates its range as EvaluateFrames() does, so the time independent
+nodes are applied once per graph. The callback and setParameterTime are called concurrently from different threads, but never concurrently for the same
+graph.
+*/
+inline bool EvaluateFrames( Span<IGraph* const> graphs, Span<double const> times, FrameCallbackType const& callback, EvaluationContext* context = nullptr,
+	ParameterTimeFunctionType const& setParameterTime = ParameterTimeFunctionType() )
+{
+	auto const graphCount = std::min( static_cast<int>( graphs.size() ), static_cast<int>( times.size() ) );
+	if( graphCount <= 1 )
+	{
+		return graphs.size() == 0 ? times.size() == 0 : EvaluateFrames( *graphs[0], times, callback, context, setParameterTime );
+	}
+
+	// The frames are already running in parallel, don't oversubscribe by also running the nodes of each frame in parallel
+	EvaluationContext const defaultContext = {};
+	ExtendedEvaluationContext frameContext( context != nullptr ? *context : defaultContext );
+	frameContext.extension.workerCount = 1;
+
+	std::atomic<bool> isStopped( false );
+	auto const frameCount = static_cast<int>( times.size() );
+	std::vector<std::thread> threads;
+	threads.reserve( graphCount );
+	for( auto graphIndex = 0; graphIndex < graphCount; ++graphIndex )
+	{
+		threads.push_back( std::thread( [&, graphIndex]
+		{
+			auto const firstFrame = frameCount * graphIndex / graphCount;
+			auto const endFrame = frameCount * ( graphIndex + 1 ) / graphCount;
+			auto localContext = frameContext;
+			auto const succeeded = EvaluateFrames( *graphs[graphIndex], times.subspan( firstFrame, endFrame - firstFrame ), [&]( int frameIndex, double time, GraphEvaluator const& evaluator )
+			{
+				return !isStopped && callback( firstFrame + frameIndex, time, evaluator );
+			}, &localContext, setParameterTime );
+
+			if( !succeeded )
+			{
+				isStopped = true;
+			}
+		} ) );
+	}
+
+	for( auto& thread : threads )
+	{
+		thread.join();
+	}
+
+	return !isStopped;
+}
+
+} } }
@@ -0,0 +1,204 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDefault
+#pragma once
+
+#include "Ephere/Ornatrix/Groom/IGraph.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix { namespace Groom
+{
+
+//! Measurements of a single node application
+struct NodeProfile
+{
+	INode const* node;
+
+	//! Index of the worker thread which applied the node, -1 if it was applied on the thread calling the evaluation
+	int threadIndex;
+
+	//! Seconds since an unspecified epoch, only meaningful in comparison with the start times of other nodes
+	double startTime;
+
+	double wallTime;
+
+	//! CPU time of the applying thread. Doesn't include the time of threads the operator may have spawned itself.
+	double cpuTime;
+
+	//! Counts of the hair produced by the node, -1 if the node has no hair output
+	int outputStrandCount;
+	int outputVertexCount;
+
+	/*! Approximate size of the main per-strand and per-vertex arrays of the output hair.
+	The SDK has no access to the allocator used by the operators, so this is an estimate of the memory held by the output rather than the peak allocation.
+	*/
+	std::int64_t outputByteCount;
+
+	bool succeeded;
+};
+
+//! Receives node measurements during graph evaluation. Set through EvaluationContextExtension::profiler, may be called concurrently from several threads.
+struct IEvaluationProfiler
+{
+	virtual ~IEvaluationProfiler()
+	{
+	}
+
+	virtual void OnNodeEvaluated( NodeProfile const& ) = 0;
+};
+
+//! Collects the node measurements of one or more evaluations and summarizes them
+class GroomProfile : public IEvaluationProfiler
+{
+public:
+
+	struct Entry
+	{
+		std::string nodeName;
+		NodeProfile profile;
+	};
+
+	void OnNodeEvaluated( NodeProfile const& profile ) override
+	{
+		Entry entry = { profile.node != nullptr ? std::string( profile.node->GetName() ) : std::string(), profile };
+		std::lock_guard<std::mutex> lock( mutex_ );
+		entries_.push_back( std::move( entry ) );
+	}
+
+	void Clear()
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		entries_.clear();
+	}
+
+	//! Entries in the order in which the nodes finished
+	EPHERE_NODISCARD std::vector<Entry> GetEntries() const
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		return entries_;
+	}
+
+	//! Wall time totals per node name, slowest first
+	EPHERE_NODISCARD std::vector<std::pair<std::string, double>> GetWallTimeByNode() const
+	{
+		std::vector<std::pair<std::string, double>> result;
+		for( auto const& entry : GetEntries() )
+		{
+			auto iterator = std::find_if( result.begin(), result.end(), [&entry]( std::pair<std::string, double> const& item )
+			{
+				return item.first == entry.nodeName;
+			} );
+
+			if( iterator == result.end() )
+			{
+				result.push_back( std::make_pair( entry.nodeName, 0.0 ) );
+				iterator = result.end() - 1;
+			}
+
+			iterator->second += entry.profile.wallTime;
+		}
+
+		std::stable_sort( result.begin(), result.end(), []( std::pair<std::string, double> const& left, std::pair<std::string, double> const& right )
+		{
+			return left.second > right.second;
+		} );
+
+		return result;
+	}
+
+	//! Human readable table of the per-node wall time totals
+	EPHERE_NODISCARD std::string ToString() const
+	{
+		std::ostringstream stream;
+		for( auto const& item : GetWallTimeByNode() )
+		{
+			stream << item.first << ": " << item.second * 1000.0 << " ms\n";
+		}
+
+		return stream.str();
+	}
+
+	//! Trace Event Format JSON which can be loaded into chrome://tracing or Perfetto
+	EPHERE_NODISCARD std::string ToChromeTraceJson() const
+	{
+		auto const entries = GetEntries();
+		auto startTime = 0.0;
+		if( !entries.empty() )
+		{
+			startTime = std::min_element( entries.begin(), entries.end(), []( Entry const& left, Entry const& right )
+			{
+				return left.profile.startTime < right.profile.startTime;
+			} )->profile.startTime;
+		}
+
+		std::ostringstream stream;
+		stream.precision( 15 );
+		stream << "{\"traceEvents\":[";
+		for( auto index = 0; index < static_cast<int>( entries.size() ); ++index )
+		{
+			auto const& profile = entries[index].profile;
+			stream << ( index > 0 ? ",\n" : "\n" )
+				<< "{\"name\":\"" << EscapeJson( entries[index].nodeName ) << "\",\"cat\":\"node\",\"ph\":\"X\",\"pid\":1"
+				<< ",\"tid\":" << profile.threadIndex + 1
+				<< ",\"ts\":" << ( profile.startTime - startTime ) * 1e6
+				<< ",\"dur\":" << profile.wallTime * 1e6
+				<< ",\"args\":{\"cpuTimeMs\":" << profile.cpuTime * 1000.0
+				<< ",\"strandCount\":" << profile.outputStrandCount
+				<< ",\"vertexCount\":" << profile.outputVertexCount
+				<< ",\"outputBytes\":" << profile.outputByteCount
+				<< ",\"succeeded\":" << ( profile.succeeded ? "true" : "false" ) << "}}";
+		}
+
+		stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return stream.str();
+	}
+
+private:
+
+	static std::string EscapeJson( std::string const& text )
+	{
+		std::string result;
+		result.reserve( text.size() );
+		for( auto const character : text )
+		{
+			switch( character )
+			{
+				case '"':
+					result += "\\\"";
+					break;
+				case '\\':
+					result += "\\\\";
+					break;
+				case '\n':
+					result += "\\n";
+					break;
+				default:
+					if( static_cast<unsigned char>( character ) < 0x20 )
+					{
+						static char const hexDigits[] = "0123456789abcdef";
+						result += "\\u00";
+						result += hexDigits[( character >> 4 ) & 0xf];
+						result += hexDigits[character & 0xf];
+					}
+					else
+					{
+						result += character;
+					}
+			}
+		}
+
+		return result;
+	}
+
+	mutable std::mutex mutex_;
+
+	std::vector<Entry> entries_;
+};
+
+} } }
@@ -0,0 +1,184 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDefault
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/Ornatrix/Groom/IOperator.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix { namespace Groom
+{
+
+/*! Hair allocator which recycles hair objects instead of deleting them.
+
+Hair returned by CreateHair() goes back to the pool when its last owner releases it. The next CreateHair() call reuses it after calling IHair::Clear(), which
+resets the element counts but keeps the memory of the internal arrays, so repeated evaluations of a large groom don't reallocate (and page fault) all
+vertex data every time. Guides and hair are pooled separately.
+
+Hair still in use when the pool is destroyed is deleted normally when it is released.
+*/
+class HairPool : public IHairAllocator
+{
+public:
+
+	typedef std::function<UniquePtr<IHair>( bool initAsGuides )> FactoryFunctionType;
+
+	/*! @param factory Creates new hair objects when the pool is empty, e.g. a lambda calling ILibrary::CreateHair()
+	@param maxFreeCount Maximum number of unused objects kept by the pool for each of guides and hair
+	*/
+	explicit HairPool( FactoryFunctionType factory, int maxFreeCount = 64 )
+		: state_( std::make_shared<State>() )
+	{
+		state_->factory = std::move( factory );
+		state_->maxFreeCount = maxFreeCount;
+		state_->isClosed = false;
+		state_->createdCount = 0;
+	}
+
+	~HairPool()
+	{
+		std::vector<Slot*> freeSlots;
+		{
+			std::lock_guard<std::mutex> lock( state_->mutex );
+			state_->isClosed = true;
+			for( auto& slots : state_->freeSlots )
+			{
+				freeSlots.insert( freeSlots.end(), slots.begin(), slots.end() );
+				slots.clear();
+			}
+		}
+
+		for( auto* slot : freeSlots )
+		{
+			delete slot;
+		}
+	}
+
+	UniquePtr<IHair> CreateHair( bool initAsGuides ) override
+	{
+		Slot* slot = nullptr;
+		{
+			std::lock_guard<std::mutex> lock( state_->mutex );
+			auto& slots = state_->freeSlots[initAsGuides ? 1 : 0];
+			if( !slots.empty() )
+			{
+				slot = slots.back();
+				slots.pop_back();
+			}
+		}
+
+		if( slot != nullptr )
+		{
+			slot->hair->Clear();
+		}
+		else
+		{
+			auto hair = state_->factory( initAsGuides );
+			if( !hair )
+			{
+				return UniquePtr<IHair>();
+			}
+
+			slot = new Slot( state_, std::move( hair ), initAsGuides );
+
+			std::lock_guard<std::mutex> lock( state_->mutex );
+			++state_->createdCount;
+		}
+
+		return UniquePtr<IHair>( slot->hair.get(), slot );
+	}
+
+	//! Number of hair objects created by the factory so far, the rest of the CreateHair() calls were served from the pool
+	EPHERE_NODISCARD int GetCreatedCount() const
+	{
+		std::lock_guard<std::mutex> lock( state_->mutex );
+		return state_->createdCount;
+	}
+
+	//! Number of unused hair objects currently held by the pool
+	EPHERE_NODISCARD int GetFreeCount() const
+	{
+		std::lock_guard<std::mutex> lock( state_->mutex );
+		return static_cast<int>( state_->freeSlots[0].size() + state_->freeSlots[1].size() );
+	}
+
+	//! Deletes all unused hair objects held by the pool
+	void Trim()
+	{
+		std::vector<Slot*> freeSlots;
+		{
+			std::lock_guard<std::mutex> lock( state_->mutex );
+			for( auto& slots : state_->freeSlots )
+			{
+				freeSlots.insert( freeSlots.end(), slots.begin(), slots.end() );
+				slots.clear();
+			}
+		}
+
+		for( auto* slot : freeSlots )
+		{
+			delete slot;
+		}
+	}
+
+private:
+
+	struct Slot;
+
+	// Shared with the handed out hair objects, so they can be released after the pool was destroyed
+	struct State
+	{
+		std::mutex mutex;
+		FactoryFunctionType factory;
+		std::vector<Slot*> freeSlots[2];
+		int maxFreeCount;
+		int createdCount;
+		bool isClosed;
+	};
+
+	// Owner of a pooled hair object. Releasing a UniquePtr created with it as the owner returns the slot to the pool.
+	struct Slot : Ephere_OwnerContainer
+	{
+		Slot( std::shared_ptr<State> state, UniquePtr<IHair> hair, bool isGuides )
+			: state( std::move( state ) ),
+			hair( std::move( hair ) ),
+			isGuides( isGuides )
+		{
+			Deleter = Release;
+		}
+
+		static void Release( void const*, Ephere_OwnerContainer* owner )
+		{
+			auto* slot = static_cast<Slot*>( owner );
+			auto const state = slot->state;
+			{
+				std::lock_guard<std::mutex> lock( state->mutex );
+				auto& slots = state->freeSlots[slot->isGuides ? 1 : 0];
+				if( !state->isClosed && static_cast<int>( slots.size() ) < state->maxFreeCount )
+				{
+					slots.push_back( slot );
+					return;
+				}
+			}
+
+			delete slot;
+		}
+
+		std::shared_ptr<State> state;
+		UniquePtr<IHair> hair;
+		bool isGuides;
+	};
+
+	HairPool( HairPool const& );
+
+	HairPool& operator=( HairPool const& );
+
+	std::shared_ptr<State> state_;
+};
+
+} } }
@@ -11,6 +11,12 @@
 #include "Ephere/NativeTools/StlExtensions.h"
 #include "Ephere/Ornatrix/IHair.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
 namespace Ephere
 {
 namespace Ornatrix
@@ -19,6 +25,7 @@ namespace Groom
 {
 
 struct IOperator;
+struct IEvaluationProfiler;
 
 typedef UniquePtr<IOperator>( *OperatorFactory )( );
 
@@ -98,11 +105,379 @@ OperatorDescriptor MakeDescriptor( Parameters::String name, Parameters::ISetDesc
 }
 
 
+//! Set from any thread to request a running evaluation to stop
+class CancellationToken
+{
+public:
+
+	CancellationToken()
+		: isCancelled_( false )
+	{
+	}
+
+	void Cancel()
+	{
+		isCancelled_ = true;
+	}
+
+	void Reset()
+	{
+		isCancelled_ = false;
+	}
+
+	EPHERE_NODISCARD bool IsCancelled() const
+	{
+		return isCancelled_;
+	}
+
+private:
+
+	CancellationToken( CancellationToken const& );
+
+	CancellationToken& operator=( CancellationToken const& );
+
+	std::atomic<bool> isCancelled_;
+};
+
+//! Source of hair objects for operator outputs, set through EvaluationContextExtension::hairAllocator. Must be thread-safe.
+struct IHairAllocator
+{
+	virtual ~IHairAllocator()
+	{
+	}
+
+	//! Returns an empty hair object. Destroying the returned pointer may give the object back to the allocator instead of deleting it.
+	virtual UniquePtr<IHair> CreateHair( bool initAsGuides ) = 0;
+};
+
+enum class ApplyResult
+{
+	Succeeded,
+	Failed,
+	Cancelled,
+};
+
+//! Receives the progress of an evaluation in the [0, 1] range
+typedef void( *ProgressFunctionType )( void* userData, float progress );
+
+/*! Evaluation state which isn't part of EvaluationContext.
+
+EvaluationContext is passed between the library and the operators, so it keeps the layout the library was built with. Everything added since lives here and
+is attached to a context with ExtendedEvaluationContext. A context created by the library has no extension, and EvaluationContext then gives the defaults.
+*/
+struct EvaluationContextExtension
+{
+	//! sizeof( EvaluationContextExtension ) of the SDK which created it, members added by later versions are only read if they fit
+	int size;
+
+	//! Number of threads used to evaluate independent nodes of a graph concurrently. 0 uses all hardware threads, 1 evaluates the nodes serially.
+	int workerCount;
+
+	//! Optional, receives the measurements of every applied node when the graph is evaluated by a GraphEvaluator
+	IEvaluationProfiler* profiler;
+
+	//! Optional, long running operators poll it between batches of strands and return early when it is cancelled
+	CancellationToken const* cancellationToken;
+
+	//! Optional, called from the evaluating threads
+	ProgressFunctionType progressFunction;
+
+	void* progressUserData;
+
+	//! Optional, when set it is used instead of hairFactoryFunction to create output hair (e.g. a HairPool reusing the outputs of previous evaluations)
+	IHairAllocator* hairAllocator;
+};
+
+struct EvaluationContext;
+
+namespace Detail
+{
+
+/* Extensions of the live ExtendedEvaluationContext objects, by the address of their context.
+Registering and unregistering a context takes a lock, but finding an extension doesn't: operators look it up every time they poll for cancellation or report
+progress. A slot's extension is written before its context is published, and the slot of a context can't be reused while the context is alive.
+*/
+class EvaluationContextExtensions
+{
+public:
+
+	static EvaluationContextExtensions& GetInstance()
+	{
+		static EvaluationContextExtensions result;
+		return result;
+	}
+
+	void Add( EvaluationContext const* context, EvaluationContextExtension const* extension )
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		for( auto index = 0; index < SlotCount; ++index )
+		{
+			auto& slot = slots_[index];
+			if( slot.context.load( std::memory_order_relaxed ) == nullptr )
+			{
+				slot.extension.store( extension, std::memory_order_relaxed );
+				slot.context.store( context, std::memory_order_release );
+				if( usedSlotCount_.load( std::memory_order_relaxed ) <= index )
+				{
+					usedSlotCount_.store( index + 1, std::memory_order_release );
+				}
+
+				return;
+			}
+		}
+
+		overflowEntries_.push_back( std::make_pair( context, extension ) );
+		overflowCount_.store( static_cast<int>( overflowEntries_.size() ), std::memory_order_release );
+	}
+
+	void Remove( EvaluationContext const* context )
+	{
+		std::lock_guard<std::mutex> lock( mutex_ );
+		auto const usedSlotCount = usedSlotCount_.load( std::memory_order_relaxed );
+		for( auto index = 0; index < usedSlotCount; ++index )
+		{
+			if( slots_[index].context.load( std::memory_order_relaxed ) == context )
+			{
+				slots_[index].context.store( nullptr, std::memory_order_release );
+				return;
+			}
+		}
+
+		for( auto entry = overflowEntries_.begin(); entry != overflowEntries_.end(); ++entry )
+		{
+			if( entry->first == context )
+			{
+				overflowEntries_.erase( entry );
+				break;
+			}
+		}
+
+		overflowCount_.store( static_cast<int>( overflowEntries_.size() ), std::memory_order_release );
+	}
+
+	EvaluationContextExtension const* Find( EvaluationContext const* context ) const
+	{
+		auto const usedSlotCount = usedSlotCount_.load( std::memory_order_acquire );
+		for( auto index = 0; index < usedSlotCount; ++index )
+		{
+			if( slots_[index].context.load( std::memory_order_acquire ) == context )
+			{
+				return slots_[index].extension.load( std::memory_order_relaxed );
+			}
+		}
+
+		// Only more than SlotCount contexts alive at once end up here
+		if( overflowCount_.load( std::memory_order_acquire ) == 0 )
+		{
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lock( mutex_ );
+		for( auto const& entry : overflowEntries_ )
+		{
+			if( entry.first == context )
+			{
+				return entry.second;
+			}
+		}
+
+		return nullptr;
+	}
+
+private:
+
+	enum
+	{
+		SlotCount = 256
+	};
+
+	struct Slot
+	{
+		std::atomic<EvaluationContext const*> context;
+		std::atomic<EvaluationContextExtension const*> extension;
+	};
+
+	EvaluationContextExtensions()
+		: usedSlotCount_( 0 ),
+		overflowCount_( 0 )
+	{
+		for( auto& slot : slots_ )
+		{
+			slot.context.store( nullptr, std::memory_order_relaxed );
+			slot.extension.store( nullptr, std::memory_order_relaxed );
+		}
+	}
+
+	mutable std::mutex mutex_;
+
+	Slot slots_[SlotCount];
+
+	// Slots past this one have never been used
+	std::atomic<int> usedSlotCount_;
+
+	std::vector<std::pair<EvaluationContext const*, EvaluationContextExtension const*>> overflowEntries_;
+
+	std::atomic<int> overflowCount_;
+};
+
+}
+
 struct EvaluationContext
 {
 	typedef UniquePtr<IHair>( *HairFactoryFunctionType )( bool initAsGuides );
 
+	typedef Groom::ProgressFunctionType ProgressFunctionType;
+
+	// Members are shared with the library, don't add any. New state goes into EvaluationContextExtension.
 	HairFactoryFunctionType hairFactoryFunction;
+
+	/*! Extension attached by an ExtendedEvaluationContext, nullptr for plain contexts such as the ones created by the library.
+	The extension belongs to the address of the context: a plain EvaluationContext copied from an ExtendedEvaluationContext doesn't have it, copy into an
+	ExtendedEvaluationContext to keep it.
+	*/
+	EPHERE_NODISCARD EvaluationContextExtension const* GetExtension() const
+	{
+		return Detail::EvaluationContextExtensions::GetInstance().Find( this );
+	}
+
+	EPHERE_NODISCARD int GetWorkerCount() const
+	{
+		return GetExtensionMember( GetExtension(), &EvaluationContextExtension::workerCount, 0 );
+	}
+
+	EPHERE_NODISCARD IEvaluationProfiler* GetProfiler() const
+	{
+		return GetExtensionMember<IEvaluationProfiler*>( GetExtension(), &EvaluationContextExtension::profiler, nullptr );
+	}
+
+	EPHERE_NODISCARD CancellationToken const* GetCancellationToken() const
+	{
+		return GetExtensionMember<CancellationToken const*>( GetExtension(), &EvaluationContextExtension::cancellationToken, nullptr );
+	}
+
+	EPHERE_NODISCARD IHairAllocator* GetHairAllocator() const
+	{
+		return GetExtensionMember<IHairAllocator*>( GetExtension(), &EvaluationContextExtension::hairAllocator, nullptr );
+	}
+
+	//! Creates an empty hair object for an operator output through the allocator or the factory function of the context
+	EPHERE_NODISCARD UniquePtr<IHair> CreateHair( bool initAsGuides ) const
+	{
+		auto* const hairAllocator = GetHairAllocator();
+		return hairAllocator != nullptr ? hairAllocator->CreateHair( initAsGuides )
+			: hairFactoryFunction != nullptr ? hairFactoryFunction( initAsGuides )
+			: UniquePtr<IHair>();
+	}
+
+	EPHERE_NODISCARD bool IsCancelled() const
+	{
+		return IsCancelled( GetExtension() );
+	}
+
+	void ReportProgress( float progress ) const
+	{
+		ReportProgress( GetExtension(), progress );
+	}
+
+	/*! Calls function( firstStrandIndex, strandCount ) for consecutive batches of strands, checking for cancellation and reporting progress in between.
+	The extension is looked up once, the batches only poll its cancellation token.
+	@return false if the evaluation was cancelled or the function returned false
+	*/
+	template <class TFunction>
+	bool ForEachStrandBatch( int strandCount, TFunction function, int batchSize = 4096 ) const
+	{
+		auto const* extension = GetExtension();
+		for( auto firstStrandIndex = 0; firstStrandIndex < strandCount; firstStrandIndex += batchSize )
+		{
+			if( IsCancelled( extension ) || !function( firstStrandIndex, std::min( batchSize, strandCount - firstStrandIndex ) ) )
+			{
+				return false;
+			}
+
+			ReportProgress( extension, static_cast<float>( std::min( firstStrandIndex + batchSize, strandCount ) ) / static_cast<float>( strandCount ) );
+		}
+
+		return !IsCancelled( extension );
+	}
+
+private:
+
+	template <typename T>
+	static T GetExtensionMember( EvaluationContextExtension const* extension, T EvaluationContextExtension::* member, T defaultValue )
+	{
+		if( extension == nullptr )
+		{
+			return defaultValue;
+		}
+
+		auto const memberEnd = reinterpret_cast<char const*>( &( extension->*member ) + 1 ) - reinterpret_cast<char const*>( extension );
+		return extension->size >= memberEnd ? extension->*member : defaultValue;
+	}
+
+	static bool IsCancelled( EvaluationContextExtension const* extension )
+	{
+		auto const* cancellationToken = GetExtensionMember<CancellationToken const*>( extension, &EvaluationContextExtension::cancellationToken, nullptr );
+		return cancellationToken != nullptr && cancellationToken->IsCancelled();
+	}
+
+	static void ReportProgress( EvaluationContextExtension const* extension, float progress )
+	{
+		auto const progressFunction = GetExtensionMember<ProgressFunctionType>( extension, &EvaluationContextExtension::progressFunction, nullptr );
+		if( progressFunction != nullptr )
+		{
+			progressFunction( GetExtensionMember<void*>( extension, &EvaluationContextExtension::progressUserData, nullptr ), progress );
+		}
+	}
+};
+
+/*! Context with an extension, see EvaluationContextExtension.
+The context registers its address while it exists, so that the extension is found from the EvaluationContext reference the library passes to operators.
+*/
+struct ExtendedEvaluationContext : EvaluationContext
+{
+	EvaluationContextExtension extension;
+
+	ExtendedEvaluationContext()
+	{
+		hairFactoryFunction = nullptr;
+		EvaluationContextExtension const defaultExtension = { sizeof( EvaluationContextExtension ), 0, nullptr, nullptr, nullptr, nullptr, nullptr };
+		extension = defaultExtension;
+		Detail::EvaluationContextExtensions::GetInstance().Add( this, &extension );
+	}
+
+	//! Copies the factory function and, if there is one, the extension of the context
+	explicit ExtendedEvaluationContext( EvaluationContext const& other )
+	{
+		hairFactoryFunction = other.hairFactoryFunction;
+		EvaluationContextExtension const defaultExtension = { sizeof( EvaluationContextExtension ), 0, nullptr, nullptr, nullptr, nullptr, nullptr };
+		extension = defaultExtension;
+		if( auto const* otherExtension = other.GetExtension() )
+		{
+			std::memcpy( &extension, otherExtension, std::min<std::size_t>( std::max( otherExtension->size, 0 ), sizeof( extension ) ) );
+			extension.size = sizeof( EvaluationContextExtension );
+		}
+
+		Detail::EvaluationContextExtensions::GetInstance().Add( this, &extension );
+	}
+
+	ExtendedEvaluationContext( ExtendedEvaluationContext const& other )
+		: EvaluationContext( other ),
+		extension( other.extension )
+	{
+		Detail::EvaluationContextExtensions::GetInstance().Add( this, &extension );
+	}
+
+	ExtendedEvaluationContext& operator=( ExtendedEvaluationContext const& other )
+	{
+		hairFactoryFunction = other.hairFactoryFunction;
+		extension = other.extension;
+		return *this;
+	}
+
+	~ExtendedEvaluationContext()
+	{
+		Detail::EvaluationContextExtensions::GetInstance().Remove( this );
+	}
 };
 
 
@@ -145,6 +520,17 @@ struct IOperator
 		return Apply( context );
 	}
 
+	//! Distinguishes an operator that stopped because the context's cancellation token was set from one that failed
+	ApplyResult ApplyWithResult( EvaluationContext& context )
+	{
+		if( context.IsCancelled() )
+		{
+			return ApplyResult::Cancelled;
+		}
+
+		return Apply( context ) ? ApplyResult::Succeeded : context.IsCancelled() ? ApplyResult::Cancelled : ApplyResult::Failed;
+	}
+
 
 	EPHERE_NODISCARD Iterable<ParameterSetIterator<true>> EnumerateParameterSets() const;
 
@@ -0,0 +1,186 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/NativeTools/MappedFile.h"
+#include "Ephere/NativeTools/ZipArchive.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Concurrent reading and writing of zipped groom files.
+
+IGrooms leaves zip archives to the library, which compresses and decompresses their files one after another. The functions here do it in the SDK instead:
+the groom and its extra files are split into chunks which are compressed, or decompressed and verified, on a caller-provided thread pool. The archives are
+regular zip files which the library reads as well. USD archives have their own layout, they are always left to the library, as are files of serializers
+which aren't registered.
+*/
+namespace GroomArchive
+{
+
+struct Settings
+{
+	explicit Settings( int compressionLevel = Deflater::DefaultLevel, ThreadPool* pool = nullptr )
+		: compressionLevel( compressionLevel )
+		, pool( pool )
+	{
+	}
+
+	//! Deflate level of written archives, from 0 (store, fastest) to 9 (smallest)
+	int compressionLevel;
+
+	//! Pool running the compression and decompression tasks, nullptr runs them on the calling thread. Usually shared by all calls.
+	ThreadPool* pool;
+};
+
+//! Serializer of a groom file with either its zipped or unzipped extension, the passed one if it matches. Returns nullptr for USD files.
+EPHERE_NODISCARD inline IGroomSerializer* FindSerializer( IGrooms const& grooms, std::string_view filePath, IGroomSerializer* serializer = nullptr )
+{
+	if( IUsdSerializer::HasUsdExtension( filePath ) )
+	{
+		return nullptr;
+	}
+
+	if( serializer != nullptr )
+	{
+		return serializer->HasGroomExtension( filePath ) ? serializer : nullptr;
+	}
+
+	auto serializers = grooms.GetAllGroomSerializers();
+	for( auto index = 0; index < static_cast<int>( serializers.size() ); ++index )
+	{
+		if( serializers[index]->HasGroomExtension( filePath ) )
+		{
+			return serializers[index];
+		}
+	}
+
+	return nullptr;
+}
+
+/*! Same as IGrooms::SerializeGroomToFile(), but zip archives are written here. A file with the zipped extension is always an archive. A file with the
+unzipped extension becomes one only if the groom has extra files and GroomSerializeSettings::createZipArchiveIfNeeded is set, it is then written with the
+zipped extension instead. Returns the path of the written file, or an empty string on failure.
+*/
+inline Parameters::String SerializeGroomToFile(
+	IGrooms const& grooms,
+	Groom::IGraph const& graph,
+	std::string_view filePath,
+	GroomSerializeSettings const& groomSettings = GroomSerializeSettings(),
+	Settings const& settings = Settings(),
+	IGroomSerializer* serializer = nullptr )
+{
+	auto* const archiveSerializer = FindSerializer( grooms, filePath, serializer );
+	if( archiveSerializer == nullptr )
+	{
+		return grooms.SerializeGroomToFile( graph, filePath, groomSettings, serializer );
+	}
+
+	SerializedGroom serialized;
+	if( filePath.empty() || !Groom::LoadDeferredParameters( graph ) || !archiveSerializer->SerializeGroom( graph, groomSettings, serialized ) )
+	{
+		return "";
+	}
+
+	auto const hasExtraFiles = !groomSettings.ignoreExtraFiles && !serialized.extraFileNames.empty();
+	auto const fileExtension = archiveSerializer->GroomFileFormatExtension();
+	auto const zippedExtension = archiveSerializer->GroomZippedFormatExtension();
+	std::string outputFilePath( filePath );
+	if( !archiveSerializer->HasGroomExtension( filePath, zippedExtension ) )
+	{
+		if( !hasExtraFiles )
+		{
+			std::ofstream file( outputFilePath.c_str(), std::ios::binary );
+			file.write( serialized.contentBuffer.data(), serialized.contentBuffer.size() );
+			return file.flush() ? Parameters::String( outputFilePath ) : "";
+		}
+
+		// Extra files which aren't zipped are written by the library, next to the groom file
+		if( !groomSettings.createZipArchiveIfNeeded )
+		{
+			return grooms.SerializeGroomToFile( graph, filePath, groomSettings, archiveSerializer );
+		}
+
+		outputFilePath.resize( outputFilePath.size() - fileExtension.length() );
+		outputFilePath.append( zippedExtension.data(), zippedExtension.length() );
+	}
+
+	// The groom is stored in the archive under the file name with the unzipped extension, e.g. Groom.oxg.yaml in Groom.oxg.zip
+	auto const nameStart = outputFilePath.find_last_of( "/\\" ) + 1;
+	auto const groomName = outputFilePath.substr( nameStart, outputFilePath.size() - nameStart - zippedExtension.length() )
+		+ std::string( fileExtension.data(), fileExtension.length() );
+
+	std::vector<ZipArchiveEntryView> entries( 1 );
+	entries[0].name = groomName;
+	entries[0].contents = serialized.contentBuffer;
+	for( auto index = 0; hasExtraFiles && index < static_cast<int>( serialized.extraFileNames.size() ); ++index )
+	{
+		ZipArchiveEntryView const entry = { serialized.extraFileNames[index], serialized.extraContentBuffers[index] };
+		entries.push_back( entry );
+	}
+
+	std::ofstream file( outputFilePath.c_str(), std::ios::binary );
+	return file && WriteZipArchive( entries, settings.compressionLevel, settings.pool, file ) ? Parameters::String( outputFilePath ) : "";
+}
+
+/*! Same as IGrooms::DeserializeGroomFromFile(), but zip archives are read here. Files which aren't archives, and archives which can't be read by
+ReadZipArchive() or have no groom in them, are passed on to IGrooms::DeserializeGroomFromFile(). The time sample sidecar of an archive is applied as well.
+*/
+EPHERE_NODISCARD inline UniquePtr<Groom::IGraph> DeserializeGroomFromFile(
+	IGrooms const& grooms,
+	std::string_view filePath,
+	double time = TimeUndefined,
+	Settings const& settings = Settings(),
+	IGroomSerializer* serializer = nullptr,
+	Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories = Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>() )
+{
+	auto* const archiveSerializer = FindSerializer( grooms, filePath, serializer );
+	if( archiveSerializer == nullptr || !archiveSerializer->HasGroomExtension( filePath, archiveSerializer->GroomZippedFormatExtension() ) )
+	{
+		return grooms.DeserializeGroomFromFile( filePath, time, serializer, factories );
+	}
+
+	std::string const filePathString( filePath );
+	MappedFile file;
+	std::vector<ZipArchiveEntry> files;
+	if( !file.Open( filePathString ) || !ReadZipArchive( std::string_view( file.data(), file.size() ), settings.pool, files ) )
+	{
+		return grooms.DeserializeGroomFromFile( filePath, time, serializer, factories );
+	}
+
+	SerializedGroom serialized;
+	auto hasGroom = false;
+	for( auto const& archived : files )
+	{
+		auto const name = std::string_view( archived.name.data(), archived.name.size() );
+		// Views of the decompressed files, which outlive the deserialization
+		auto contents = Parameters::String::MakeView( std::string_view( archived.contents.data(), archived.contents.size() ) );
+		if( !hasGroom && archiveSerializer->HasGroomExtension( name, archiveSerializer->GroomFileFormatExtension() ) )
+		{
+			serialized.contentBuffer = std::move( contents );
+			hasGroom = true;
+		}
+		else
+		{
+			serialized.AddOrUpdateExtraFile( Parameters::String::MakeView( name ), std::move( contents ) );
+		}
+	}
+
+	if( !hasGroom )
+	{
+		return grooms.DeserializeGroomFromFile( filePath, time, serializer, factories );
+	}
+
+	auto const directoryLength = filePathString.find_last_of( "/\\" );
+	return IGrooms::ApplyTimeSampleSidecar( archiveSerializer->DeserializeGroom( serialized, time, factories,
+		directoryLength != std::string::npos ? StringView( filePath.data(), directoryLength ) : StringView() ), filePath, time );
+}
+
+}
+
+} }
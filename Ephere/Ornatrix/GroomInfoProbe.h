@@ -0,0 +1,266 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/NativeTools/Inflate.h"
+#include "Ephere/NativeTools/StringToolsBase.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Reading of groom file headers, used by IGrooms::GetGroomInfoFromFile() to get the version and time samples of a groom without loading all of it.
+
+The groom formats store this information before the nodes: YAML grooms start with the version and time samples, USD layers with their metadata. Only the
+beginning of the file is read, and for zip archives the central directory at the end of the file is used to find the groom entry, whose beginning is then
+read (and decompressed if needed) by itself.
+*/
+namespace GroomInfoProbe
+{
+
+enum
+{
+	//! Number of bytes read from the beginning of a groom, enough for the header of grooms with thousands of time samples
+	DefaultPrefixSize = 64 * 1024
+};
+
+namespace Detail
+{
+
+inline std::uint32_t LoadUInt( char const* data, int size )
+{
+	std::uint32_t result = 0;
+	for( auto index = size - 1; index >= 0; --index )
+	{
+		result = result << 8 | static_cast<unsigned char>( data[index] );
+	}
+
+	return result;
+}
+
+inline bool ReadAt( std::ifstream& file, std::uint64_t offset, std::size_t size, std::string& result )
+{
+	result.resize( size );
+	file.clear();
+	file.seekg( static_cast<std::streamoff>( offset ) );
+	file.read( &result[0], static_cast<std::streamsize>( size ) );
+	result.resize( static_cast<std::size_t>( file.gcount() ) );
+	return file.good() || file.eof();
+}
+
+inline char const* Find( std::string_view contents, std::string_view pattern )
+{
+	auto const* end = contents.data() + contents.length();
+	auto const* const found = std::search( contents.data(), end, pattern.data(), pattern.data() + pattern.length() );
+	return found != end ? found : nullptr;
+}
+
+}
+
+/*! Finds the first entry of a zip archive accepted by isGroomEntry and reads up to maxSize bytes from its beginning
+@param isComplete Set to true if the whole entry was read
+@return False if the file is not a zip archive, no entry was accepted or the entry uses a compression method other than deflate
+*/
+inline bool ReadZipEntryPrefix( std::ifstream& file, std::function<bool( std::string_view )> const& isGroomEntry, std::size_t maxSize, std::string& result,
+	bool& isComplete )
+{
+	enum
+	{
+		EndOfDirectorySize = 22,
+		DirectoryEntrySize = 46,
+		LocalHeaderSize = 30,
+		MaxCommentSize = 0xffff
+	};
+
+	file.clear();
+	file.seekg( 0, std::ios::end );
+	auto const fileSize = static_cast<std::uint64_t>( file.tellg() );
+	if( fileSize < EndOfDirectorySize )
+	{
+		return false;
+	}
+
+	// The end of central directory record is followed only by an optional comment
+	auto const tailSize = std::min<std::uint64_t>( fileSize, EndOfDirectorySize + MaxCommentSize );
+	std::string tail;
+	if( !Detail::ReadAt( file, fileSize - tailSize, static_cast<std::size_t>( tailSize ), tail ) || tail.size() != tailSize )
+	{
+		return false;
+	}
+
+	char const* endOfDirectory = nullptr;
+	for( auto position = static_cast<std::ptrdiff_t>( tail.size() ) - EndOfDirectorySize; position >= 0; --position )
+	{
+		if( Detail::LoadUInt( tail.data() + position, 4 ) == 0x06054b50 )
+		{
+			endOfDirectory = tail.data() + position;
+			break;
+		}
+	}
+
+	if( endOfDirectory == nullptr )
+	{
+		return false;
+	}
+
+	// Zip64 archives store 0xffffffff here and the real values elsewhere, they are not supported
+	auto const entryCount = Detail::LoadUInt( endOfDirectory + 10, 2 );
+	auto const directorySize = Detail::LoadUInt( endOfDirectory + 12, 4 );
+	auto const directoryOffset = Detail::LoadUInt( endOfDirectory + 16, 4 );
+	std::string directory;
+	if( static_cast<std::uint64_t>( directoryOffset ) + directorySize > fileSize
+		|| !Detail::ReadAt( file, directoryOffset, directorySize, directory ) || directory.size() != directorySize )
+	{
+		return false;
+	}
+
+	std::size_t position = 0;
+	for( std::uint32_t index = 0; index < entryCount; ++index )
+	{
+		if( directory.size() - position < DirectoryEntrySize || Detail::LoadUInt( directory.data() + position, 4 ) != 0x02014b50 )
+		{
+			return false;
+		}
+
+		auto const* const entry = directory.data() + position;
+		auto const nameLength = Detail::LoadUInt( entry + 28, 2 );
+		auto const entrySize = DirectoryEntrySize + nameLength + Detail::LoadUInt( entry + 30, 2 ) + Detail::LoadUInt( entry + 32, 2 );
+		if( directory.size() - position < entrySize )
+		{
+			return false;
+		}
+
+		position += entrySize;
+		if( !isGroomEntry( std::string_view( entry + DirectoryEntrySize, nameLength ) ) )
+		{
+			continue;
+		}
+
+		auto const method = Detail::LoadUInt( entry + 10, 2 );
+		auto const compressedSize = Detail::LoadUInt( entry + 20, 4 );
+		auto const uncompressedSize = Detail::LoadUInt( entry + 24, 4 );
+		auto const localHeaderOffset = Detail::LoadUInt( entry + 42, 4 );
+
+		// The name and extra field lengths of the local header may differ from the ones in the central directory
+		std::string localHeader;
+		if( !Detail::ReadAt( file, localHeaderOffset, LocalHeaderSize, localHeader ) || localHeader.size() != LocalHeaderSize
+			|| Detail::LoadUInt( localHeader.data(), 4 ) != 0x04034b50 )
+		{
+			return false;
+		}
+
+		auto const dataOffset = static_cast<std::uint64_t>( localHeaderOffset ) + LocalHeaderSize + Detail::LoadUInt( localHeader.data() + 26, 2 )
+			+ Detail::LoadUInt( localHeader.data() + 28, 2 );
+		if( method == 0 )
+		{
+			auto const size = std::min<std::uint64_t>( compressedSize, maxSize );
+			isComplete = size == compressedSize;
+			return Detail::ReadAt( file, dataOffset, static_cast<std::size_t>( size ), result ) && result.size() == size;
+		}
+
+		if( method != 8 )
+		{
+			return false;
+		}
+
+		// Deflate rarely expands text by more than a small factor, so twice the prefix size of input is enough for a prefix-sized output in practice.
+		// If it isn't, the result is simply shorter.
+		std::string compressed;
+		auto const readSize = std::min<std::uint64_t>( compressedSize, 2 * static_cast<std::uint64_t>( maxSize ) + 1024 );
+		if( !Detail::ReadAt( file, dataOffset, static_cast<std::size_t>( readSize ), compressed ) )
+		{
+			return false;
+		}
+
+		result.resize( std::min<std::size_t>( maxSize, uncompressedSize ) );
+		auto decodedSize = result.size();
+		auto const status = Inflater::Inflate( compressed.data(), compressed.size(), result.empty() ? nullptr : &result[0], decodedSize );
+		result.resize( decodedSize );
+		isComplete = status == Inflater::Status::Complete;
+		return status != Inflater::Status::Invalid;
+	}
+
+	return false;
+}
+
+/*! Reads up to maxSize bytes from the beginning of a groom file. For zip archives the beginning of the first entry accepted by isGroomEntry is read instead.
+@param isComplete Set to true if the whole groom was read
+*/
+inline bool ReadGroomPrefix( std::string const& filePath, std::function<bool( std::string_view )> const& isGroomEntry, std::size_t maxSize, std::string& result,
+	bool& isComplete )
+{
+	std::ifstream file( filePath.c_str(), std::ios::binary );
+	if( !file )
+	{
+		return false;
+	}
+
+	if( !Detail::ReadAt( file, 0, maxSize, result ) )
+	{
+		return false;
+	}
+
+	isComplete = result.size() < maxSize;
+	if( StartsWith( std::string_view( result.data(), result.size() ), std::string_view( "PK\x03\x04", 4 ) ) )
+	{
+		return ReadZipEntryPrefix( file, isGroomEntry, maxSize, result, isComplete );
+	}
+
+	return true;
+}
+
+/*! Cuts the beginning of a groom down to the part which describes the groom itself, so that it can be parsed quickly and without the nodes being cut off
+in the middle. Contents which are neither YAML nor USD text are returned unchanged.
+@param isComplete True if contents hold the whole groom, otherwise the beginning must contain the end of the header
+@return False if the end of the header wasn't found in an incomplete groom
+*/
+inline bool GetHeader( std::string_view contents, bool isComplete, std::string_view& header )
+{
+	header = contents;
+	if( isComplete )
+	{
+		return true;
+	}
+
+	char const* end = nullptr;
+	if( StartsWith( contents, "%YAML" ) )
+	{
+		// The nodes follow the version and time samples
+		end = Detail::Find( contents, "\nnodes:" );
+	}
+	else if( StartsWith( contents, "#usda " ) )
+	{
+		// The layer metadata is followed by the prims
+		char const* const primSpecifiers[] = { "\ndef ", "\nover ", "\nclass " };
+		for( auto const* specifier : primSpecifiers )
+		{
+			auto const* const found = Detail::Find( contents, specifier );
+			if( found != nullptr && ( end == nullptr || found < end ) )
+			{
+				end = found;
+			}
+		}
+	}
+	else
+	{
+		return true;
+	}
+
+	if( end == nullptr )
+	{
+		return false;
+	}
+
+	header = std::string_view( contents.data(), static_cast<std::size_t>( end - contents.data() + 1 ) );
+	return true;
+}
+
+}
+
+} }
@@ -0,0 +1,775 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/Ornatrix/Groom/DeferredParameterLoader.h"
+#include "Ephere/Ornatrix/Groom/IGraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Append-only storage of the animated parameter values of a groom, for baking many time samples.
+
+Saving a time sample with IGrooms::SerializeGroomToFile() reads and rewrites the whole groom file, so baking N frames into one file costs quadratic I/O.
+Instead, the groom is saved once, and a Writer appends each further time sample to a sidecar file next to it (see GetSidecarPath()). A time
+sample only holds the values of the parameters which differ from the saved groom, the time-invariant data is never written again. Samples are
+self-contained, so any of them can be applied without reading the others. IGrooms::DeserializeGroomFromFile() applies the sidecar of a groom file when
+given a time, and IGrooms::CreateParameterTimeFunction() treats a groom with a sidecar as animated.
+
+Sidecar layout, little-endian:
+	Magic
+	Records: time (double), value count (uint32), payload size (uint64), values
+	Value: node name length (uint32) and name, parameter set index, parameter id, type serialize id (int32), data size (uint64), data
+The data of a value is IType::ToString(), i.e. what IType::Write() writes, and is read back with IType::FromString().
+A record at the end of the file which was cut short, e.g. by a crash during baking, is ignored on reading.
+*/
+namespace GroomTimeSamples
+{
+
+inline std::string GetSidecarPath( std::string const& groomFilePath )
+{
+	return groomFilePath + ".samples";
+}
+
+inline std::string_view Magic()
+{
+	return std::string_view( "OXGSMP1\n", 8 );
+}
+
+namespace Detail
+{
+
+// Identifies a parameter of a graph by node name, parameter set index and parameter id
+typedef std::tuple<std::string, int, int> ParameterKey;
+
+// Serialize id of the type and data of parameter values
+typedef std::map<ParameterKey, std::pair<int, std::string>> ValueMap;
+
+inline std::uint64_t HashBytes( std::string const& bytes )
+{
+	// FNV-1a
+	std::uint64_t result = 14695981039346656037ULL;
+	for( auto const character : bytes )
+	{
+		result = ( result ^ static_cast<unsigned char>( character ) ) * 1099511628211ULL;
+	}
+
+	return result;
+}
+
+//! Calls function( key, parameter ) for all parameters whose values are stored by the groom itself: not transient, not outputs and not connected
+template <class TFunction>
+void ForEachStoredParameter( Groom::IGraph const& graph, TFunction function )
+{
+	auto const nodes = graph.GetNodes();
+	for( auto nodeIndex = 0; nodeIndex < static_cast<int>( nodes.size() ); ++nodeIndex )
+	{
+		auto& node = *nodes[nodeIndex];
+		auto& op = node.GetOperator();
+		std::string const nodeName( node.GetName() );
+		for( auto setIndex = 0; setIndex < op.GetParameterSetCount(); ++setIndex )
+		{
+			auto& parameterSet = op.GetParameterSet( setIndex );
+			for( auto parameterIndex = 0; parameterIndex < parameterSet.GetParameterCount(); ++parameterIndex )
+			{
+				auto& parameter = *parameterSet.GetParameterByIndex( parameterIndex );
+				auto const& descriptor = parameter.GetDescriptor();
+				if( descriptor.GetIsTransient() || descriptor.GetDirection() == Parameters::Direction::Out
+					|| node.HasInputConnection( Groom::ParameterRef( node, descriptor.GetId(), setIndex ) ) )
+				{
+					continue;
+				}
+
+				function( ParameterKey( nodeName, setIndex, static_cast<int>( descriptor.GetId() ) ), parameter );
+			}
+		}
+	}
+}
+
+// Returns an empty string if the type can't be written
+inline std::string WriteValue( Parameters::IParameter const& parameter )
+{
+	auto const& type = parameter.GetDescriptor().GetType();
+	auto const* const value = parameter.GetValueImpl( type.GetTypeId() );
+	return value != nullptr ? type.ToString( value ) : std::string();
+}
+
+inline bool ReadValue( Parameters::IParameter& parameter, std::string const& data, int serializeId )
+{
+	auto const& type = parameter.GetDescriptor().GetType();
+	if( type.GetSerializeId() != serializeId )
+	{
+		return false;
+	}
+
+	auto const value = type.FromString( data );
+	return value != nullptr && parameter.MoveValueImpl( type.GetTypeId(), value.get() );
+}
+
+template <typename T>
+void Interpolate( void* value, void const* nextValue, double weight )
+{
+	auto& result = *static_cast<T*>( value );
+	result = static_cast<T>( result + ( *static_cast<T const*>( nextValue ) - result ) * weight );
+}
+
+// Floating point values are interpolated linearly, others are taken from the first value. Returns nullptr if the data doesn't match the type.
+inline std::shared_ptr<void> ReadValue( Parameters::IType const& type, std::string const& data, int serializeId, std::string const& nextData,
+	int nextSerializeId, double weight )
+{
+	auto const isInterpolated = weight > 0 && data != nextData && ( type.Is<float>() || type.Is<double>() );
+	if( type.GetSerializeId() != serializeId || ( isInterpolated && type.GetSerializeId() != nextSerializeId ) )
+	{
+		return std::shared_ptr<void>();
+	}
+
+	auto const value = type.FromString( data );
+	if( !isInterpolated || value == nullptr )
+	{
+		return value;
+	}
+
+	auto const nextValue = type.FromString( nextData );
+	if( nextValue == nullptr )
+	{
+		return std::shared_ptr<void>();
+	}
+
+	if( type.Is<float>() )
+	{
+		Interpolate<float>( value.get(), nextValue.get(), weight );
+	}
+	else
+	{
+		Interpolate<double>( value.get(), nextValue.get(), weight );
+	}
+
+	return value;
+}
+
+inline bool ReadValue( Parameters::IParameter& parameter, std::string const& data, int serializeId, std::string const& nextData, int nextSerializeId,
+	double weight )
+{
+	auto const& type = parameter.GetDescriptor().GetType();
+	auto const value = ReadValue( type, data, serializeId, nextData, nextSerializeId, weight );
+	return value != nullptr && parameter.MoveValueImpl( type.GetTypeId(), value.get() );
+}
+
+template <int Size>
+struct UnsignedOfSize;
+
+template <>
+struct UnsignedOfSize<4>
+{
+	typedef std::uint32_t Type;
+};
+
+template <>
+struct UnsignedOfSize<8>
+{
+	typedef std::uint64_t Type;
+};
+
+template <typename T>
+void Append( std::string& output, T value )
+{
+	typename UnsignedOfSize<sizeof( T )>::Type bits;
+	std::memcpy( &bits, &value, sizeof( value ) );
+	for( auto index = 0; index < static_cast<int>( sizeof( value ) ); ++index, bits >>= 8 )
+	{
+		output += static_cast<char>( bits & 0xff );
+	}
+}
+
+template <typename T>
+T Load( char const* data )
+{
+	typename UnsignedOfSize<sizeof( T )>::Type bits = 0;
+	for( auto index = static_cast<int>( sizeof( T ) ); index-- > 0; )
+	{
+		bits = static_cast<decltype( bits )>( bits << 8 ) | static_cast<unsigned char>( data[index] );
+	}
+
+	T value;
+	std::memcpy( &value, &bits, sizeof( value ) );
+	return value;
+}
+
+template <typename T>
+bool Extract( std::string const& input, std::size_t& position, T& value )
+{
+	if( input.size() - position < sizeof( value ) )
+	{
+		return false;
+	}
+
+	value = Load<T>( input.data() + position );
+	position += sizeof( value );
+	return true;
+}
+
+}
+
+/*! Appends time samples of a groom to its sidecar file, see GroomTimeSamples.
+
+The writer compares the parameter values of each sample with the values of the saved groom, which it records on construction. The written data only grows
+with the animated values, and the sidecar is flushed after every sample.
+*/
+class Writer
+{
+public:
+
+	/*! @param savedGraph Graph with the values stored in the groom file, normally the graph which was just saved or loaded
+	@param sidecarFilePath Usually GetSidecarPath() of the groom file. An existing file is appended to unless truncate is true.
+	*/
+	Writer( Groom::IGraph const& savedGraph, std::string const& sidecarFilePath, bool truncate = false )
+	{
+		Detail::ForEachStoredParameter( savedGraph, [this]( Detail::ParameterKey const& key, Parameters::IParameter const& parameter )
+		{
+			auto const data = Detail::WriteValue( parameter );
+			if( !data.empty() )
+			{
+				savedValueHashes_[key] = std::make_pair( Detail::HashBytes( data ), data.size() );
+			}
+		} );
+
+		if( !truncate )
+		{
+			std::ifstream existing( sidecarFilePath.c_str(), std::ios::binary );
+			char magic[8];
+			truncate = !existing.read( magic, sizeof( magic ) ) || std::string_view( magic, sizeof( magic ) ) != Magic();
+		}
+
+		file_.open( sidecarFilePath.c_str(), std::ios::binary | ( truncate ? std::ios::trunc : std::ios::app ) );
+		if( truncate )
+		{
+			file_.write( Magic().data(), Magic().length() );
+		}
+	}
+
+	EPHERE_NODISCARD bool IsOpen() const
+	{
+		return file_.is_open() && !file_.fail();
+	}
+
+	/*! Appends the values of graph which differ from the saved groom as the sample at time. Writing a time again replaces its values when reading.
+	@param writtenValueCount Receives the number of written parameter values, if not nullptr
+	*/
+	bool AppendTimeSample( Groom::IGraph const& graph, double time, int* writtenValueCount = nullptr )
+	{
+		std::string payload;
+		std::uint32_t valueCount = 0;
+		Detail::ForEachStoredParameter( graph, [&]( Detail::ParameterKey const& key, Parameters::IParameter const& parameter )
+		{
+			auto const data = Detail::WriteValue( parameter );
+			if( data.empty() )
+			{
+				return;
+			}
+
+			auto const saved = savedValueHashes_.find( key );
+			if( saved != savedValueHashes_.end() && saved->second.second == data.size() && saved->second.first == Detail::HashBytes( data ) )
+			{
+				return;
+			}
+
+			auto const& nodeName = std::get<0>( key );
+			Detail::Append( payload, static_cast<std::uint32_t>( nodeName.size() ) );
+			payload += nodeName;
+			Detail::Append( payload, static_cast<std::int32_t>( std::get<1>( key ) ) );
+			Detail::Append( payload, static_cast<std::int32_t>( std::get<2>( key ) ) );
+			Detail::Append( payload, static_cast<std::int32_t>( parameter.GetDescriptor().GetType().GetSerializeId() ) );
+			Detail::Append( payload, static_cast<std::uint64_t>( data.size() ) );
+			payload += data;
+			++valueCount;
+		} );
+
+		std::string header;
+		Detail::Append( header, time );
+		Detail::Append( header, valueCount );
+		Detail::Append( header, static_cast<std::uint64_t>( payload.size() ) );
+		file_.write( header.data(), header.size() );
+		file_.write( payload.data(), payload.size() );
+		file_.flush();
+		if( writtenValueCount != nullptr )
+		{
+			*writtenValueCount = static_cast<int>( valueCount );
+		}
+
+		return IsOpen();
+	}
+
+private:
+
+	Writer( Writer const& );
+
+	Writer& operator=( Writer const& );
+
+	std::map<Detail::ParameterKey, std::pair<std::uint64_t, std::size_t>> savedValueHashes_;
+
+	std::ofstream file_;
+};
+
+/*! Applies time samples from a sidecar file to a graph loaded from the groom file.
+
+Opening only reads the record headers. Applying a time reads that one record, sets the values it holds and restores the saved values of parameters which
+an earlier Apply() call changed but the applied sample doesn't hold.
+*/
+class Reader
+{
+	friend class Samples;
+
+public:
+
+	Reader()
+	{
+	}
+
+	bool Open( std::string const& sidecarFilePath )
+	{
+		records_.clear();
+		savedValues_.clear();
+		file_.close();
+		file_.clear();
+		file_.open( sidecarFilePath.c_str(), std::ios::binary );
+		char magic[8];
+		if( !file_.read( magic, sizeof( magic ) ) || std::string_view( magic, sizeof( magic ) ) != Magic() )
+		{
+			return false;
+		}
+
+		file_.seekg( 0, std::ios::end );
+		auto const fileSize = static_cast<std::uint64_t>( file_.tellg() );
+		std::uint64_t position = sizeof( magic );
+		std::map<double, Record> latestRecords;
+		for( ;; )
+		{
+			Record record;
+			std::uint32_t valueCount;
+			char header[sizeof( double ) + sizeof( valueCount ) + sizeof( record.payloadSize )];
+			file_.seekg( static_cast<std::streamoff>( position ) );
+			if( fileSize - position < sizeof( header ) || !file_.read( header, sizeof( header ) ) )
+			{
+				break;
+			}
+
+			record.time = Detail::Load<double>( header );
+			record.payloadSize = Detail::Load<std::uint64_t>( header + sizeof( double ) + sizeof( valueCount ) );
+			record.payloadOffset = position + sizeof( header );
+			if( fileSize - record.payloadOffset < record.payloadSize )
+			{
+				break;
+			}
+
+			// A later record of the same time replaces the earlier one
+			latestRecords[record.time] = record;
+			position = record.payloadOffset + record.payloadSize;
+		}
+
+		file_.clear();
+		for( auto const& record : latestRecords )
+		{
+			records_.push_back( record.second );
+		}
+
+		return true;
+	}
+
+	//! Sorted times of the samples in the file
+	EPHERE_NODISCARD std::vector<double> GetTimes() const
+	{
+		std::vector<double> result;
+		for( auto const& record : records_ )
+		{
+			result.push_back( record.time );
+		}
+
+		return result;
+	}
+
+	/*! Sets the values of the samples around time. Floating point values are interpolated linearly between the two samples, other values are taken from
+	the sample before the time. Times before the first sample restore the saved values, times after the last one use the last sample.
+	The graph must be in the state loaded from the groom file before the first call and must not be modified by other code between calls.
+	Returns false if some of the values couldn't be applied, e.g. because the graph doesn't match the file.
+	*/
+	bool Apply( Groom::IGraph& graph, double time )
+	{
+		auto const next = std::upper_bound( records_.begin(), records_.end(), time, []( double value, Record const& record )
+		{
+			return value < record.time;
+		} );
+
+		Detail::ValueMap values;
+		Detail::ValueMap nextValues;
+		auto weight = 0.0;
+		if( next != records_.begin() )
+		{
+			auto const& previous = *( next - 1 );
+			if( !ReadRecord( previous, values ) )
+			{
+				return false;
+			}
+
+			if( next != records_.end() && time > previous.time )
+			{
+				weight = ( time - previous.time ) / ( next->time - previous.time );
+				if( !ReadRecord( *next, nextValues ) )
+				{
+					return false;
+				}
+			}
+		}
+
+		auto result = true;
+		Detail::ForEachStoredParameter( graph, [&]( Detail::ParameterKey const& key, Parameters::IParameter& parameter )
+		{
+			auto const value = values.find( key );
+			auto const nextValue = nextValues.find( key );
+			auto saved = savedValues_.find( key );
+			auto const serializeId = parameter.GetDescriptor().GetType().GetSerializeId();
+			if( value == values.end() && nextValue == nextValues.end() )
+			{
+				if( saved != savedValues_.end() )
+				{
+					result = Detail::ReadValue( parameter, saved->second, serializeId ) && result;
+					savedValues_.erase( saved );
+				}
+
+				return;
+			}
+
+			if( saved == savedValues_.end() )
+			{
+				saved = savedValues_.insert( std::make_pair( key, Detail::WriteValue( parameter ) ) ).first;
+			}
+
+			// A sample which doesn't hold a value has the saved one
+			auto const& data = value != values.end() ? value->second : std::make_pair( serializeId, saved->second );
+			auto const& nextData = nextValue != nextValues.end() ? nextValue->second : std::make_pair( serializeId, saved->second );
+			result = Detail::ReadValue( parameter, data.second, data.first, nextData.second, nextData.first, weight ) && result;
+			if( value != values.end() )
+			{
+				values.erase( value );
+			}
+
+			if( nextValue != nextValues.end() )
+			{
+				nextValues.erase( nextValue );
+			}
+		} );
+
+		return result && values.empty() && nextValues.empty();
+	}
+
+private:
+
+	struct Record
+	{
+		double time;
+		std::uint64_t payloadOffset;
+		std::uint64_t payloadSize;
+	};
+
+	bool ReadRecord( Record const& record, Detail::ValueMap& result )
+	{
+		std::string payload( static_cast<std::size_t>( record.payloadSize ), '\0' );
+		file_.clear();
+		file_.seekg( static_cast<std::streamoff>( record.payloadOffset ) );
+		if( !payload.empty() && !file_.read( &payload[0], payload.size() ) )
+		{
+			return false;
+		}
+
+		std::size_t position = 0;
+		while( position < payload.size() )
+		{
+			std::uint32_t nameLength;
+			std::int32_t setIndex, parameterId, serializeId;
+			std::uint64_t dataSize;
+			if( !Detail::Extract( payload, position, nameLength ) || payload.size() - position < nameLength )
+			{
+				return false;
+			}
+
+			std::string name( payload.data() + position, nameLength );
+			position += nameLength;
+			if( !Detail::Extract( payload, position, setIndex ) || !Detail::Extract( payload, position, parameterId )
+				|| !Detail::Extract( payload, position, serializeId ) || !Detail::Extract( payload, position, dataSize ) || payload.size() - position < dataSize )
+			{
+				return false;
+			}
+
+			auto& value = result[Detail::ParameterKey( std::move( name ), setIndex, parameterId )];
+			value.first = serializeId;
+			value.second.assign( payload.data() + position, static_cast<std::size_t>( dataSize ) );
+			position += static_cast<std::size_t>( dataSize );
+		}
+
+		return true;
+	}
+
+	Reader( Reader const& );
+
+	Reader& operator=( Reader const& );
+
+	std::vector<Record> records_;
+
+	// Values from the groom file of the parameters changed by Apply()
+	std::map<Detail::ParameterKey, std::string> savedValues_;
+
+	std::ifstream file_;
+};
+
+/*! Animated parameter values of a groom file, loaded once to set the values of many frames, see IGrooms::CreateParameterTimeFunction().
+
+Holds the values which change between the time samples of the groom file itself and the samples of its sidecar. Apply() doesn't change the samples and
+keeps no state of the graph, so it can be called concurrently for different graphs.
+*/
+class Samples
+{
+public:
+
+	Samples()
+	{
+	}
+
+	/*! Adds the values of the groom file at one of its time samples (see GroomInfo::timeSamples), i.e. of the graph deserialized at that time without its
+	sidecar. Samples need to be added in ascending time order. Only the values which differ from the first sample are kept for the later ones.
+	*/
+	void AddFileSample( Groom::IGraph const& graph, double time )
+	{
+		auto const isFirst = fileSamples_.empty();
+		fileSamples_.push_back( Sample() );
+		auto& sample = fileSamples_.back();
+		sample.time = time;
+		Detail::ForEachStoredParameter( graph, [&]( Detail::ParameterKey const& key, Parameters::IParameter const& parameter )
+		{
+			auto data = Detail::WriteValue( parameter );
+			if( data.empty() )
+			{
+				return;
+			}
+
+			auto const value = std::make_pair( parameter.GetDescriptor().GetType().GetSerializeId(), std::move( data ) );
+			if( isFirst )
+			{
+				firstFileValues_.insert( std::make_pair( key, value ) );
+				return;
+			}
+
+			auto const firstValue = firstFileValues_.find( key );
+			if( firstValue != firstFileValues_.end() && firstValue->second != value )
+			{
+				sample.values.insert( std::make_pair( key, value ) );
+				fileAnimatedKeys_.insert( key );
+			}
+		} );
+	}
+
+	/*! Reads the samples of a sidecar file (see GetSidecarPath()) into memory.
+	@param savedGraph Graph loaded from the groom file, holding the values of the parameters at the times the sidecar doesn't hold them
+	@return true if the sidecar was read or there is no sidecar
+	*/
+	bool ReadSidecar( std::string const& sidecarFilePath, Groom::IGraph const& savedGraph )
+	{
+		Reader reader;
+		if( !reader.Open( sidecarFilePath ) )
+		{
+			return true;
+		}
+
+		for( auto const& record : reader.records_ )
+		{
+			sidecarSamples_.push_back( Sample() );
+			sidecarSamples_.back().time = record.time;
+			if( !reader.ReadRecord( record, sidecarSamples_.back().values ) )
+			{
+				return false;
+			}
+
+			for( auto const& value : sidecarSamples_.back().values )
+			{
+				sidecarSavedValues_.insert( std::make_pair( value.first, std::make_pair( 0, std::string() ) ) );
+			}
+		}
+
+		Detail::ForEachStoredParameter( savedGraph, [this]( Detail::ParameterKey const& key, Parameters::IParameter const& parameter )
+		{
+			auto const savedValue = sidecarSavedValues_.find( key );
+			if( savedValue != sidecarSavedValues_.end() )
+			{
+				savedValue->second = std::make_pair( parameter.GetDescriptor().GetType().GetSerializeId(), Detail::WriteValue( parameter ) );
+			}
+		} );
+
+		return true;
+	}
+
+	//! False if no parameter values change over time
+	EPHERE_NODISCARD bool IsAnimated() const
+	{
+		return !fileAnimatedKeys_.empty() || !sidecarSamples_.empty();
+	}
+
+	/*! Sets the animated parameters of the graph to their values at time, and marks the nodes whose values changed dirty.
+	Floating point values are interpolated linearly between two samples, others are taken from the sample before the time. The file samples are clamped
+	to the first and the last one. The sidecar takes precedence and is applied like Reader::Apply() does.
+	Returns false if some of the values couldn't be set, e.g. because the graph doesn't match the file.
+	*/
+	bool Apply( Groom::IGraph& graph, double time ) const
+	{
+		Sample const* previousFileSample;
+		Sample const* nextFileSample;
+		auto const fileWeight = FindSamples( fileSamples_, time, previousFileSample, nextFileSample );
+		if( previousFileSample == nullptr && !fileSamples_.empty() )
+		{
+			previousFileSample = &fileSamples_.front();
+		}
+
+		Sample const* previousSidecarSample;
+		Sample const* nextSidecarSample;
+		auto const sidecarWeight = FindSamples( sidecarSamples_, time, previousSidecarSample, nextSidecarSample );
+
+		auto result = true;
+		std::set<std::string> changedNodeNames;
+		Detail::ForEachStoredParameter( graph, [&]( Detail::ParameterKey const& key, Parameters::IParameter& parameter )
+		{
+			auto const isFileAnimated = fileAnimatedKeys_.count( key ) != 0;
+			auto const sidecarSavedValue = sidecarSavedValues_.find( key );
+			if( !isFileAnimated && sidecarSavedValue == sidecarSavedValues_.end() )
+			{
+				return;
+			}
+
+			auto const& type = parameter.GetDescriptor().GetType();
+			std::shared_ptr<void> value;
+			if( isFileAnimated )
+			{
+				auto const& data = GetFileValue( *previousFileSample, key );
+				auto const& nextData = nextFileSample != nullptr ? GetFileValue( *nextFileSample, key ) : data;
+				value = Detail::ReadValue( type, data.second, data.first, nextData.second, nextData.first, fileWeight );
+			}
+			else
+			{
+				value = type.FromString( sidecarSavedValue->second.second );
+			}
+
+			if( value != nullptr && sidecarSavedValue != sidecarSavedValues_.end() && previousSidecarSample != nullptr )
+			{
+				// A sidecar sample which doesn't hold a value has the one of the groom file
+				auto const baseData = std::make_pair( type.GetSerializeId(), type.ToString( value.get() ) );
+				auto const& data = GetSidecarValue( *previousSidecarSample, key, baseData );
+				auto const& nextData = nextSidecarSample != nullptr ? GetSidecarValue( *nextSidecarSample, key, baseData ) : data;
+				value = Detail::ReadValue( type, data.second, data.first, nextData.second, nextData.first, sidecarWeight );
+			}
+
+			auto const* currentValue = parameter.GetValueImpl( type.GetTypeId() );
+			if( value == nullptr || currentValue == nullptr )
+			{
+				result = false;
+				return;
+			}
+
+			if( !type.AreEqual( currentValue, value.get() ) )
+			{
+				result = parameter.MoveValueImpl( type.GetTypeId(), value.get() ) && result;
+				changedNodeNames.insert( std::get<0>( key ) );
+			}
+		} );
+
+		for( auto const& nodeName : changedNodeNames )
+		{
+			if( auto* node = graph.FindNode( nodeName ) )
+			{
+				node->SetDirty( true, false );
+			}
+		}
+
+		return result;
+	}
+
+private:
+
+	struct Sample
+	{
+		double time;
+		Detail::ValueMap values;
+	};
+
+	// Finds the last sample at or before time and the first one after it, and returns the weight of the next one
+	static double FindSamples( std::vector<Sample> const& samples, double time, Sample const*& previous, Sample const*& next )
+	{
+		auto const nextSample = std::upper_bound( samples.begin(), samples.end(), time, []( double value, Sample const& sample )
+		{
+			return value < sample.time;
+		} );
+
+		previous = nextSample != samples.begin() ? &*( nextSample - 1 ) : nullptr;
+		next = nextSample != samples.end() ? &*nextSample : nullptr;
+		return previous != nullptr && next != nullptr && time > previous->time ? ( time - previous->time ) / ( next->time - previous->time ) : 0.0;
+	}
+
+	std::pair<int, std::string> const& GetFileValue( Sample const& sample, Detail::ParameterKey const& key ) const
+	{
+		auto const value = sample.values.find( key );
+		return value != sample.values.end() ? value->second : firstFileValues_.find( key )->second;
+	}
+
+	static std::pair<int, std::string> const& GetSidecarValue( Sample const& sample, Detail::ParameterKey const& key,
+		std::pair<int, std::string> const& baseValue )
+	{
+		auto const value = sample.values.find( key );
+		return value != sample.values.end() ? value->second : baseValue;
+	}
+
+	std::vector<Sample> fileSamples_;
+
+	// All values of the first file sample
+	Detail::ValueMap firstFileValues_;
+
+	// Parameters whose values differ between the file samples
+	std::set<Detail::ParameterKey> fileAnimatedKeys_;
+
+	std::vector<Sample> sidecarSamples_;
+
+	// Values from the groom file of the parameters held by any sidecar sample
+	Detail::ValueMap sidecarSavedValues_;
+};
+
+//! True if the groom file has a sidecar with time samples
+inline bool HasSidecar( std::string const& groomFilePath )
+{
+	Reader reader;
+	return reader.Open( GetSidecarPath( groomFilePath ) ) && !reader.GetTimes().empty();
+}
+
+/*! Applies the sidecar of a groom file at time to a graph which was just loaded from the file.
+Returns true if the groom has no sidecar or the time is undefined (NaN), the graph is left as it is then.
+*/
+inline bool ApplySidecar( Groom::IGraph& graph, std::string const& groomFilePath, double time )
+{
+	Reader reader;
+	if( std::isnan( time ) || !reader.Open( GetSidecarPath( groomFilePath ) ) )
+	{
+		return true;
+	}
+
+	return Groom::LoadDeferredParameters( graph ) && reader.Apply( graph, time );
+}
+
+}
+
+} }
@@ -2,6 +2,8 @@
 
 #pragma once
 
+#include <array>
+
 namespace Ephere { namespace Ornatrix
 {
 
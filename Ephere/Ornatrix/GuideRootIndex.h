@@ -0,0 +1,221 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/Geometry/Native/PointBvh.h"
+#include "Ephere/Ornatrix/GuideDependency.h"
+#include "Ephere/Ornatrix/IHair.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Spatial index of guide roots for finding the guides of generated strands, as HairFromGuides does for its NClosestGuides, Barycentric and Circle area
+methods and the guide proximity distance.
+
+The index is kept between evaluations and updated with Update(). It is only rebuilt when the guide topology (IHair::GetTopologyHash()) or the lookup space
+changes. When only the guide shapes change, the roots are read again and the hierarchy is refitted, which is linear in the guide count and keeps the
+queries exact. Roots are indexed in object space, or in the texture space of a channel when guides are interpolated in UV space
+(HairFromGuidesParameters::InterpolateGuidesInUvSpace), where positions are (u, v, 0). Guides without points have no root and are left out of the index.
+*/
+class GuideRootIndex
+{
+public:
+
+	typedef Geometry::PointBvh<3> Bvh;
+
+	GuideRootIndex()
+		: topologyHash_( 0 ),
+		useTextureSpace_( false ),
+		textureChannel_( 0 ),
+		isBuilt_( false )
+	{
+	}
+
+	/*! Makes the index match the current roots of the guides
+	@param useTextureSpace Index the texture coordinates of the roots in textureChannel instead of their positions
+	@return True if the hierarchy was rebuilt, false if it was refitted or the roots couldn't be read
+	*/
+	bool Update( IHair const& guides, bool useTextureSpace = false, int textureChannel = 0 )
+	{
+		std::vector<Bvh::Point> roots;
+		std::vector<int> guideIndices;
+		if( !GetRoots( guides, useTextureSpace, textureChannel, roots, guideIndices ) )
+		{
+			bvh_.Build( nullptr, 0 );
+			guideIndices_.clear();
+			isBuilt_ = false;
+			return false;
+		}
+
+		auto const topologyHash = guides.GetTopologyHash();
+		if( isBuilt_ && topologyHash == topologyHash_ && useTextureSpace == useTextureSpace_ && textureChannel == textureChannel_
+			&& bvh_.Refit( roots.data(), static_cast<int>( roots.size() ) ) )
+		{
+			return false;
+		}
+
+		bvh_.Build( roots.data(), static_cast<int>( roots.size() ) );
+		guideIndices_.swap( guideIndices );
+		topologyHash_ = topologyHash;
+		useTextureSpace_ = useTextureSpace;
+		textureChannel_ = textureChannel;
+		isBuilt_ = true;
+		return true;
+	}
+
+	//! The points of the hierarchy are the roots of the guides with points, see GetGuideIndex()
+	EPHERE_NODISCARD Bvh const& GetBvh() const
+	{
+		return bvh_;
+	}
+
+	//! Number of indexed guides, which excludes the guides without points
+	EPHERE_NODISCARD int GetGuideCount() const
+	{
+		return bvh_.GetPointCount();
+	}
+
+	//! Returns the index of the guide of a point of the hierarchy
+	EPHERE_NODISCARD int GetGuideIndex( int pointIndex ) const
+	{
+		return guideIndices_.empty() ? pointIndex : guideIndices_[pointIndex];
+	}
+
+	/*! Finds the MaxGuideInterpolationCount guides closest to a root, in the space the index was built in
+	@param maxDistance Guides further away are ignored, see HairFromGuidesParameters::GuideProximityDistance
+	@return Number of guides found, unused entries of the result get GuideDependency::InvalidRootIndex
+	*/
+	int FindClosestGuides( Bvh::Point const& root, GuideDependency& result, float maxDistance = std::numeric_limits<float>::max() ) const
+	{
+		int indices[MaxGuideInterpolationCount];
+		float squaredDistances[MaxGuideInterpolationCount];
+		auto const count = bvh_.FindNearest( root, MaxGuideInterpolationCount, indices, squaredDistances, maxDistance );
+		for( auto index = 0; index < MaxGuideInterpolationCount; ++index )
+		{
+			result.closestRootIndices[index] = index < count ? static_cast<unsigned>( GetGuideIndex( indices[index] ) )
+				: static_cast<unsigned>( GuideDependency::InvalidRootIndex );
+			result.closestRootDistances[index] = index < count ? std::sqrt( squaredDistances[index] ) : 0.0f;
+		}
+
+		return count;
+	}
+
+	//! Appends the indices of the guides whose roots are within radius, used by the Circle guide area method
+	void FindGuidesInRadius( Bvh::Point const& position, float radius, std::vector<int>& result ) const
+	{
+		auto const firstIndex = result.size();
+		bvh_.FindInRadius( position, radius, result );
+		for( auto index = firstIndex; index < result.size(); ++index )
+		{
+			result[index] = GetGuideIndex( result[index] );
+		}
+	}
+
+private:
+
+	GuideRootIndex( GuideRootIndex const& );
+
+	GuideRootIndex& operator=( GuideRootIndex const& );
+
+	// Reads the roots of the guides with points, guideIndices receives the guide of every root or stays empty if all guides have points
+	static bool GetRoots( IHair const& guides, bool useTextureSpace, int textureChannel, std::vector<Bvh::Point>& result, std::vector<int>& guideIndices )
+	{
+		auto const strandCount = guides.GetStrandCount();
+		result.resize( strandCount );
+		guideIndices.clear();
+		if( strandCount == 0 )
+		{
+			return true;
+		}
+
+		std::vector<int> pointCounts( strandCount );
+		if( !guides.GetStrandPointCounts( 0, strandCount, pointCounts.data() ) )
+		{
+			return false;
+		}
+
+		if( useTextureSpace )
+		{
+			if( textureChannel < 0 || textureChannel >= guides.GetTextureCoordinateChannelCount() )
+			{
+				return false;
+			}
+
+			// Texture coordinates have a third component which is not used for lookups
+			if( !guides.GetTextureCoordinates( textureChannel, 0, strandCount, result.data(), IHair::PerStrand ) )
+			{
+				return false;
+			}
+
+			for( auto& root : result )
+			{
+				root.z() = 0;
+			}
+		}
+		else
+		{
+			// Only the roots are read, through the root positions command or strand by strand if the library doesn't have it
+			std::vector<Vector3> rootPositions( strandCount );
+			auto const hasRootPositions = guides.GetRootPositions( 0, strandCount, rootPositions.data(), IHair::Object );
+			for( auto strand = 0; strand < strandCount; ++strand )
+			{
+				if( pointCounts[strand] <= 0 )
+				{
+					continue;
+				}
+
+				if( hasRootPositions )
+				{
+					auto const& root = rootPositions[strand];
+					result[strand] = Bvh::Point( static_cast<float>( root.x() ), static_cast<float>( root.y() ), static_cast<float>( root.z() ) );
+				}
+				else if( !guides.GetStrandPoints( strand, 0, 1, &result[strand], IHair::Object ) )
+				{
+					return false;
+				}
+			}
+		}
+
+		// Strands without points never match, leave them out
+		if( std::find_if( pointCounts.begin(), pointCounts.end(), []( int pointCount )
+		{
+			return pointCount <= 0;
+		} ) == pointCounts.end() )
+		{
+			return true;
+		}
+
+		auto rootCount = 0;
+		for( auto strand = 0; strand < strandCount; ++strand )
+		{
+			if( pointCounts[strand] > 0 )
+			{
+				result[rootCount++] = result[strand];
+				guideIndices.push_back( strand );
+			}
+		}
+
+		result.resize( rootCount );
+		return true;
+	}
+
+	Bvh bvh_;
+
+	// Guide of every point of bvh_, empty if all guides have points and the indices are the same
+	std::vector<int> guideIndices_;
+
+	std::uint64_t topologyHash_;
+	bool useTextureSpace_;
+	int textureChannel_;
+	bool isBuilt_;
+};
+
+} }
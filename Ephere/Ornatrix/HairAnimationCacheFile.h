@@ -0,0 +1,827 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/Deflate.h"
+#include "Ephere/NativeTools/Inflate.h"
+#include "Ephere/NativeTools/MappedFile.h"
+#include "Ephere/NativeTools/Span.h"
+#include "Ephere/Ornatrix/IHair.h"
+#include "Ephere/Ornatrix/StrandQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Chunked animation cache of hair vertices and widths, for the HairAnimationCache operator and hosts which play back baked hair.
+
+Every frame is split into blocks of strands which are compressed separately, and an index at the end of the file gives the location of each block
+of each frame. Evaluating the hair at a time only reads and decompresses the blocks of the two frames around it which hold the requested strands, so
+the cost of a lookup doesn't depend on the length of the animation. Decoded blocks are kept in a least recently used cache, scrubbing back and forth
+over a range of frames which fits into it doesn't touch the file again. The file is memory mapped, parts which are never read are never loaded.
+
+Progressive caches store the strands in the order of GetProgressiveOrder(), in which every prefix is spread evenly over the hair. A preview of a fraction
+of the strands (see BakedHairParameters::PreviewStrandFraction) then reads only the first blocks of each frame, and more strands can be read later
+without reading the preview ones again. Readers present the strands in stored order, GetOriginalStrandIndices() maps them back.
+
+File layout, little-endian:
+	Header: magic, strand count, strands per block, flags, frame count, index offset, vertex count
+	Blocks: deflated vertices (3 floats each) followed by widths, if the cache has them. In quantized caches, deflated StrandQuantization encoding.
+	Index: strand point counts, original strand indices of progressive caches, frame times, and per frame and block the offset, stored size and inflated
+	size of the block
+A block whose stored and inflated sizes are equal is not compressed. Quantized blocks take a little more than half the size before compression, see
+StrandQuantization for their precision.
+*/
+namespace HairAnimationCacheFile
+{
+
+enum
+{
+	DefaultStrandsPerBlock = 1024
+};
+
+namespace Detail
+{
+
+inline char const* Magic()
+{
+	return "OXHCACH1";
+}
+
+enum
+{
+	MagicSize = 8,
+	HasWidthsFlag = 1,
+	QuantizedFlag = 2,
+	ProgressiveFlag = 4
+};
+
+#pragma pack( push, 1 )
+struct Header
+{
+	char magic[MagicSize];
+	std::uint32_t strandCount;
+	std::uint32_t strandsPerBlock;
+	std::uint32_t flags;
+	std::uint32_t frameCount;
+	std::uint64_t indexOffset;
+	std::uint64_t vertexCount;
+};
+
+struct BlockLocation
+{
+	std::uint64_t offset;
+	std::uint32_t storedSize;
+	std::uint32_t decodedSize;
+};
+#pragma pack( pop )
+
+static_assert( sizeof( Geometry::Vector3f ) == 3 * sizeof( float ), "Vertices are stored as packed floats" );
+
+}
+
+/*! Order of strands in which every prefix is a stratified subset of all strands: the bit-reversed sequence of their indices. Strands are usually ordered
+by their position on the surface, so the first strands of this order are spread evenly over it.
+@return Original index of each strand in the new order
+*/
+inline std::vector<int> GetProgressiveOrder( int strandCount )
+{
+	auto bitCount = 0;
+	while( ( 1LL << bitCount ) < strandCount )
+	{
+		++bitCount;
+	}
+
+	std::vector<int> result;
+	result.reserve( strandCount );
+	for( std::int64_t index = 0; index < 1LL << bitCount; ++index )
+	{
+		std::int64_t reversed = 0;
+		for( auto bit = 0; bit < bitCount; ++bit )
+		{
+			reversed |= ( index >> bit & 1 ) << ( bitCount - 1 - bit );
+		}
+
+		if( reversed < strandCount )
+		{
+			result.push_back( static_cast<int>( reversed ) );
+		}
+	}
+
+	return result;
+}
+
+//! Writes a cache frame by frame. The topology is fixed when the writer is created.
+class Writer
+{
+public:
+
+	/*! @param quantize Store vertices and widths with 16-bit StrandQuantization instead of full precision
+	@param progressive Store the strands in progressive order, for reading previews with a fraction of the strands
+	*/
+	Writer( std::string const& filePath, std::vector<int> strandPointCounts, bool hasWidths, int strandsPerBlock = DefaultStrandsPerBlock,
+		int compressionLevel = Deflater::BestSpeed, bool quantize = false, bool progressive = false )
+		: file_( filePath.c_str(), std::ios::binary | std::ios::trunc ),
+		strandPointCounts_( std::move( strandPointCounts ) ),
+		hasWidths_( hasWidths ),
+		strandsPerBlock_( std::max( strandsPerBlock, 1 ) ),
+		compressionLevel_( compressionLevel ),
+		quantize_( quantize ),
+		vertexCount_( 0 )
+	{
+		for( auto pointCount : strandPointCounts_ )
+		{
+			vertexCount_ += pointCount;
+		}
+
+		if( progressive )
+		{
+			strandOrder_ = GetProgressiveOrder( static_cast<int>( strandPointCounts_.size() ) );
+			originalFirstVertices_.resize( strandPointCounts_.size() );
+			auto firstVertex = 0;
+			for( std::size_t strand = 0; strand < strandPointCounts_.size(); ++strand )
+			{
+				originalFirstVertices_[strand] = firstVertex;
+				firstVertex += strandPointCounts_[strand];
+			}
+
+			std::vector<int> storedPointCounts( strandOrder_.size() );
+			for( std::size_t strand = 0; strand < strandOrder_.size(); ++strand )
+			{
+				storedPointCounts[strand] = strandPointCounts_[strandOrder_[strand]];
+			}
+
+			strandPointCounts_.swap( storedPointCounts );
+		}
+
+		// The header is completed on Close()
+		Detail::Header header = {};
+		file_.write( reinterpret_cast<char const*>( &header ), sizeof( header ) );
+	}
+
+	~Writer()
+	{
+		Close();
+	}
+
+	EPHERE_NODISCARD bool IsOpen() const
+	{
+		return file_.is_open() && file_.good();
+	}
+
+	/*! Appends a frame, frames must be added in increasing order of time
+	@param vertices Vertices of all strands, in their original order
+	@param widths Ignored unless the cache has widths, then it must hold a width for every vertex
+	*/
+	bool AddFrame( double time, Span<Geometry::Vector3f const> vertices, Span<float const> widths = Span<float const>() )
+	{
+		if( !IsOpen() || static_cast<std::uint64_t>( vertices.size() ) != vertexCount_
+			|| ( hasWidths_ && static_cast<std::uint64_t>( widths.size() ) != vertexCount_ )
+			|| ( !times_.empty() && time <= times_.back() ) )
+		{
+			return false;
+		}
+
+		if( strandOrder_.empty() )
+		{
+			return WriteFrame( time, vertices, widths );
+		}
+
+		std::vector<Geometry::Vector3f> storedVertices;
+		std::vector<float> storedWidths;
+		storedVertices.reserve( vertices.size() );
+		storedWidths.reserve( hasWidths_ ? widths.size() : 0 );
+		for( std::size_t strand = 0; strand < strandOrder_.size(); ++strand )
+		{
+			auto const firstVertex = originalFirstVertices_[strandOrder_[strand]];
+			auto const endVertex = firstVertex + strandPointCounts_[strand];
+			storedVertices.insert( storedVertices.end(), vertices.data() + firstVertex, vertices.data() + endVertex );
+			if( hasWidths_ )
+			{
+				storedWidths.insert( storedWidths.end(), widths.data() + firstVertex, widths.data() + endVertex );
+			}
+		}
+
+		return WriteFrame( time, storedVertices, storedWidths );
+	}
+
+	//! Appends the current state of the hair as a frame, its topology must match the one the writer was created with
+	bool AddFrame( double time, IHair const& hair )
+	{
+		std::vector<Geometry::Vector3f> vertices( hair.GetVertexCount() );
+		if( !vertices.empty() && !hair.GetVertices( 0, static_cast<int>( vertices.size() ), vertices.data(), IHair::Object ) )
+		{
+			return false;
+		}
+
+		std::vector<float> widths;
+		if( hasWidths_ )
+		{
+			widths.resize( vertices.size(), 1.0f );
+			if( hair.HasWidths() && !widths.empty() )
+			{
+				hair.GetWidths( 0, static_cast<int>( widths.size() ), widths.data() );
+			}
+		}
+
+		return AddFrame( time, vertices, widths );
+	}
+
+	//! Writes the index, the cache can't be read before this is done
+	bool Close()
+	{
+		if( !file_.is_open() )
+		{
+			return false;
+		}
+
+		Detail::Header header = {};
+		std::memcpy( header.magic, Detail::Magic(), Detail::MagicSize );
+		header.strandCount = static_cast<std::uint32_t>( strandPointCounts_.size() );
+		header.strandsPerBlock = static_cast<std::uint32_t>( strandsPerBlock_ );
+		header.flags = ( hasWidths_ ? Detail::HasWidthsFlag : 0 ) | ( quantize_ ? Detail::QuantizedFlag : 0 )
+			| ( !strandOrder_.empty() ? Detail::ProgressiveFlag : 0 );
+		header.frameCount = static_cast<std::uint32_t>( times_.size() );
+		header.indexOffset = static_cast<std::uint64_t>( file_.tellp() );
+		header.vertexCount = vertexCount_;
+
+		std::vector<std::uint32_t> pointCounts( strandPointCounts_.begin(), strandPointCounts_.end() );
+		Write( pointCounts );
+		std::vector<std::uint32_t> const strandOrder( strandOrder_.begin(), strandOrder_.end() );
+		Write( strandOrder );
+		Write( times_ );
+		Write( blocks_ );
+
+		file_.seekp( 0 );
+		file_.write( reinterpret_cast<char const*>( &header ), sizeof( header ) );
+		auto const result = file_.good();
+		file_.close();
+		return result;
+	}
+
+private:
+
+	Writer( Writer const& );
+
+	Writer& operator=( Writer const& );
+
+	// Vertices and widths are in stored order
+	bool WriteFrame( double time, Span<Geometry::Vector3f const> vertices, Span<float const> widths )
+	{
+		std::vector<float> decoded;
+		std::string quantized, stored;
+		auto firstVertex = 0;
+		for( auto firstStrand = 0; firstStrand < static_cast<int>( strandPointCounts_.size() ); firstStrand += strandsPerBlock_ )
+		{
+			auto const lastStrand = std::min( firstStrand + strandsPerBlock_, static_cast<int>( strandPointCounts_.size() ) );
+			auto blockVertexCount = 0;
+			for( auto strand = firstStrand; strand < lastStrand; ++strand )
+			{
+				blockVertexCount += strandPointCounts_[strand];
+			}
+
+			if( quantize_ )
+			{
+				quantized.clear();
+				StrandQuantization::Encode(
+					Span<int const>( strandPointCounts_.data() + firstStrand, lastStrand - firstStrand ),
+					blockVertexCount > 0 ? &vertices[firstVertex] : nullptr,
+					hasWidths_ && blockVertexCount > 0 ? &widths[firstVertex] : nullptr,
+					quantized );
+			}
+			else if( blockVertexCount > 0 )
+			{
+				decoded.resize( blockVertexCount * ( hasWidths_ ? 4 : 3 ) );
+				std::memcpy( decoded.data(), &vertices[firstVertex], blockVertexCount * sizeof( Geometry::Vector3f ) );
+				if( hasWidths_ )
+				{
+					std::memcpy( decoded.data() + 3 * blockVertexCount, &widths[firstVertex], blockVertexCount * sizeof( float ) );
+				}
+			}
+			else
+			{
+				decoded.clear();
+			}
+
+			firstVertex += blockVertexCount;
+			auto const written = quantize_
+				? WriteBlock( quantized.data(), quantized.size(), stored )
+				: WriteBlock( reinterpret_cast<char const*>( decoded.data() ), decoded.size() * sizeof( float ), stored );
+			if( !written )
+			{
+				return false;
+			}
+		}
+
+		times_.push_back( time );
+		return true;
+	}
+
+	// The format is little endian, same as all supported platforms, so values are written as they are
+	template <typename T>
+	void Write( std::vector<T> const& values )
+	{
+		if( !values.empty() )
+		{
+			file_.write( reinterpret_cast<char const*>( values.data() ), static_cast<std::streamsize>( values.size() * sizeof( T ) ) );
+		}
+	}
+
+	bool WriteBlock( char const* data, std::size_t size, std::string& stored )
+	{
+		stored.clear();
+		Deflater::Compress( data, size, compressionLevel_, true, stored );
+		if( stored.size() >= size )
+		{
+			stored.assign( data, size );
+		}
+
+		Detail::BlockLocation location;
+		location.offset = static_cast<std::uint64_t>( file_.tellp() );
+		location.storedSize = static_cast<std::uint32_t>( stored.size() );
+		location.decodedSize = static_cast<std::uint32_t>( size );
+		blocks_.push_back( location );
+
+		file_.write( stored.data(), static_cast<std::streamsize>( stored.size() ) );
+		return file_.good();
+	}
+
+	std::ofstream file_;
+
+	std::vector<int> strandPointCounts_;
+	bool hasWidths_;
+	int strandsPerBlock_;
+	int compressionLevel_;
+	bool quantize_;
+	std::uint64_t vertexCount_;
+
+	std::vector<int> strandOrder_;
+	std::vector<int> originalFirstVertices_;
+
+	std::vector<double> times_;
+	std::vector<Detail::BlockLocation> blocks_;
+};
+
+/*! Random access to a cache written by Writer. Evaluation may be called from several threads at once.
+
+Hair at a time between two frames is interpolated linearly, before the first and after the last frame the nearest frame is used.
+*/
+class Reader
+{
+public:
+
+	enum
+	{
+		DefaultCacheSize = 256 * 1024 * 1024
+	};
+
+	explicit Reader( std::size_t cacheSize = DefaultCacheSize )
+		: strandsPerBlock_( 1 ),
+		hasWidths_( false ),
+		isQuantized_( false ),
+		cacheSize_( cacheSize ),
+		cachedSize_( 0 ),
+		decodeCount_( 0 )
+	{
+	}
+
+	bool Open( std::string const& filePath )
+	{
+		Close();
+		if( !file_.Open( filePath ) || file_.size() < sizeof( Detail::Header ) )
+		{
+			file_.Close();
+			return false;
+		}
+
+		Detail::Header header;
+		std::memcpy( &header, file_.data(), sizeof( header ) );
+		auto const blockCount = ( static_cast<std::uint64_t>( header.strandCount ) + header.strandsPerBlock - 1 ) / std::max<std::uint32_t>( header.strandsPerBlock, 1 );
+		auto const isProgressive = ( header.flags & Detail::ProgressiveFlag ) != 0;
+		if( std::memcmp( header.magic, Detail::Magic(), Detail::MagicSize ) != 0 || header.strandsPerBlock == 0 || header.frameCount == 0
+			|| header.indexOffset > file_.size() )
+		{
+			file_.Close();
+			return false;
+		}
+
+		// The counts come from the file, the size of the block locations is checked by division since frameCount * blockCount * 16 can overflow
+		auto const indexSize = static_cast<std::uint64_t>( file_.size() - header.indexOffset );
+		auto const listsSize = ( isProgressive ? 2 : 1 ) * static_cast<std::uint64_t>( header.strandCount ) * sizeof( std::uint32_t )
+			+ static_cast<std::uint64_t>( header.frameCount ) * sizeof( double );
+		if( indexSize < listsSize || ( indexSize - listsSize ) / sizeof( Detail::BlockLocation ) / header.frameCount < blockCount )
+		{
+			file_.Close();
+			return false;
+		}
+
+		auto const* position = file_.data() + header.indexOffset;
+		std::vector<std::uint32_t> pointCounts( header.strandCount );
+		Read( position, pointCounts );
+		strandPointCounts_.assign( pointCounts.begin(), pointCounts.end() );
+		if( isProgressive )
+		{
+			Read( position, pointCounts );
+			originalStrandIndices_.assign( pointCounts.begin(), pointCounts.end() );
+			if( std::any_of( pointCounts.begin(), pointCounts.end(), [&header]( std::uint32_t index ) { return index >= header.strandCount; } ) )
+			{
+				Close();
+				return false;
+			}
+		}
+
+		times_.resize( header.frameCount );
+		Read( position, times_ );
+		blocks_.resize( static_cast<std::size_t>( header.frameCount * blockCount ) );
+		Read( position, blocks_ );
+
+		strandsPerBlock_ = static_cast<int>( header.strandsPerBlock );
+		hasWidths_ = ( header.flags & Detail::HasWidthsFlag ) != 0;
+		isQuantized_ = ( header.flags & Detail::QuantizedFlag ) != 0;
+
+		firstStrandVertices_.resize( strandPointCounts_.size() + 1 );
+		firstStrandVertices_[0] = 0;
+		for( std::size_t strand = 0; strand < strandPointCounts_.size(); ++strand )
+		{
+			firstStrandVertices_[strand + 1] = firstStrandVertices_[strand] + strandPointCounts_[strand];
+		}
+
+		if( static_cast<std::uint64_t>( firstStrandVertices_.back() ) != header.vertexCount )
+		{
+			Close();
+			return false;
+		}
+
+		for( auto const& block : blocks_ )
+		{
+			if( block.offset > file_.size() || file_.size() - block.offset < block.storedSize )
+			{
+				Close();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Close()
+	{
+		file_.Close();
+		strandPointCounts_.clear();
+		originalStrandIndices_.clear();
+		firstStrandVertices_.clear();
+		times_.clear();
+		blocks_.clear();
+
+		std::lock_guard<std::mutex> lock( cacheMutex_ );
+		cache_.clear();
+		recentlyUsed_.clear();
+		cachedSize_ = 0;
+	}
+
+	EPHERE_NODISCARD bool IsOpen() const
+	{
+		return file_.IsOpen();
+	}
+
+	EPHERE_NODISCARD int GetStrandCount() const
+	{
+		return static_cast<int>( strandPointCounts_.size() );
+	}
+
+	EPHERE_NODISCARD int GetVertexCount() const
+	{
+		return firstStrandVertices_.empty() ? 0 : firstStrandVertices_.back();
+	}
+
+	EPHERE_NODISCARD std::vector<int> const& GetStrandPointCounts() const
+	{
+		return strandPointCounts_;
+	}
+
+	EPHERE_NODISCARD std::vector<double> const& GetTimes() const
+	{
+		return times_;
+	}
+
+	EPHERE_NODISCARD bool HasWidths() const
+	{
+		return hasWidths_;
+	}
+
+	EPHERE_NODISCARD bool IsQuantized() const
+	{
+		return isQuantized_;
+	}
+
+	EPHERE_NODISCARD bool IsProgressive() const
+	{
+		return !originalStrandIndices_.empty();
+	}
+
+	//! Original index of each stored strand of a progressive cache, empty for other caches whose strands keep their order
+	EPHERE_NODISCARD std::vector<int> const& GetOriginalStrandIndices() const
+	{
+		return originalStrandIndices_;
+	}
+
+	/*! Number of strands to read for a preview with a fraction of them. For progressive caches, strands [0, count) are spread evenly over the hair.
+	Increasing the fraction later only reads the strands which were not read yet.
+	*/
+	EPHERE_NODISCARD int GetPreviewStrandCount( float fraction ) const
+	{
+		auto const count = static_cast<int>( std::ceil( std::min( std::max( fraction, 0.0f ), 1.0f ) * GetStrandCount() ) );
+		return std::min( count, GetStrandCount() );
+	}
+
+	//! Number of blocks decompressed so far, blocks found in the cache are not counted
+	EPHERE_NODISCARD int GetDecodeCount() const
+	{
+		std::lock_guard<std::mutex> lock( cacheMutex_ );
+		return decodeCount_;
+	}
+
+	//! Finds the frames to interpolate between at a time, result = frame * ( 1 - weight ) + nextFrame * weight
+	void GetFrameInterval( double time, int& frame, int& nextFrame, float& weight ) const
+	{
+		auto const next = std::upper_bound( times_.begin(), times_.end(), time );
+		if( next == times_.begin() || next == times_.end() )
+		{
+			frame = nextFrame = next == times_.begin() ? 0 : static_cast<int>( times_.size() ) - 1;
+			weight = 0;
+			return;
+		}
+
+		nextFrame = static_cast<int>( next - times_.begin() );
+		frame = nextFrame - 1;
+		weight = static_cast<float>( ( time - times_[frame] ) / ( times_[nextFrame] - times_[frame] ) );
+	}
+
+	//! Gets the vertices of strands [firstStrand, firstStrand + strandCount) at a time, result must have room for all of their vertices
+	bool GetVertices( double time, int firstStrand, int strandCount, Geometry::Vector3f* result ) const
+	{
+		return Evaluate( time, firstStrand, strandCount, false, reinterpret_cast<float*>( result ) );
+	}
+
+	//! Gets the widths of the vertices of strands [firstStrand, firstStrand + strandCount) at a time
+	bool GetWidths( double time, int firstStrand, int strandCount, float* result ) const
+	{
+		return hasWidths_ && Evaluate( time, firstStrand, strandCount, true, result );
+	}
+
+	//! Sets the vertices and widths of hair with the same topology as the cache, in original strand order, to their state at a time
+	bool ApplyTo( double time, IHair& hair ) const
+	{
+		if( hair.GetVertexCount() != GetVertexCount() || hair.GetStrandCount() != GetStrandCount() )
+		{
+			return false;
+		}
+
+		std::vector<Geometry::Vector3f> vertices( GetVertexCount() );
+		if( !GetVertices( time, 0, GetStrandCount(), vertices.data() )
+			|| !hair.SetVertices( 0, static_cast<int>( vertices.size() ), RestoreOriginalOrder( vertices ).data(), IHair::Object ) )
+		{
+			return false;
+		}
+
+		if( hasWidths_ && hair.HasWidths() )
+		{
+			std::vector<float> widths( vertices.size() );
+			return GetWidths( time, 0, GetStrandCount(), widths.data() )
+				&& hair.SetWidths( 0, static_cast<int>( widths.size() ), RestoreOriginalOrder( widths ).data() );
+		}
+
+		return true;
+	}
+
+private:
+
+	typedef std::pair<int, int> BlockKey;
+
+	typedef std::shared_ptr<std::vector<float> const> DecodedBlock;
+
+	struct CacheEntry
+	{
+		DecodedBlock block;
+		std::list<BlockKey>::iterator recentlyUsed;
+	};
+
+	Reader( Reader const& );
+
+	Reader& operator=( Reader const& );
+
+	// Little endian like the writer, values are read as they are
+	template <typename T>
+	static void Read( char const*& position, std::vector<T>& values )
+	{
+		if( !values.empty() )
+		{
+			std::memcpy( values.data(), position, values.size() * sizeof( T ) );
+			position += values.size() * sizeof( T );
+		}
+	}
+
+	// Reorders per vertex values of all strands from stored to original order
+	template <typename T>
+	std::vector<T> RestoreOriginalOrder( std::vector<T> const& values ) const
+	{
+		if( originalStrandIndices_.empty() )
+		{
+			return values;
+		}
+
+		std::vector<int> originalFirstVertices( GetStrandCount() + 1, 0 );
+		for( auto strand = 0; strand < GetStrandCount(); ++strand )
+		{
+			originalFirstVertices[originalStrandIndices_[strand] + 1] = strandPointCounts_[strand];
+		}
+
+		for( auto strand = 0; strand < GetStrandCount(); ++strand )
+		{
+			originalFirstVertices[strand + 1] += originalFirstVertices[strand];
+		}
+
+		std::vector<T> result( values.size() );
+		for( auto strand = 0; strand < GetStrandCount(); ++strand )
+		{
+			std::copy( values.begin() + firstStrandVertices_[strand], values.begin() + firstStrandVertices_[strand + 1],
+				result.begin() + originalFirstVertices[originalStrandIndices_[strand]] );
+		}
+
+		return result;
+	}
+
+	int GetBlockCount() const
+	{
+		return ( GetStrandCount() + strandsPerBlock_ - 1 ) / strandsPerBlock_;
+	}
+
+	bool Evaluate( double time, int firstStrand, int strandCount, bool widths, float* result ) const
+	{
+		if( !IsOpen() || firstStrand < 0 || strandCount < 0 || firstStrand + strandCount > GetStrandCount() )
+		{
+			return false;
+		}
+
+		int frame, nextFrame;
+		float weight;
+		GetFrameInterval( time, frame, nextFrame, weight );
+
+		auto const components = widths ? 1 : 3;
+		auto const endStrand = firstStrand + strandCount;
+		for( auto block = firstStrand / strandsPerBlock_; block * strandsPerBlock_ < endStrand; ++block )
+		{
+			auto const blockFirstStrand = block * strandsPerBlock_;
+			auto const blockEndStrand = std::min( blockFirstStrand + strandsPerBlock_, GetStrandCount() );
+			auto const blockVertexCount = firstStrandVertices_[blockEndStrand] - firstStrandVertices_[blockFirstStrand];
+
+			auto const first = GetBlock( frame, block );
+			auto const next = weight > 0 ? GetBlock( nextFrame, block ) : first;
+			if( !first || !next )
+			{
+				return false;
+			}
+
+			// Part of the block which holds the requested strands
+			auto const copyFirstVertex = firstStrandVertices_[std::max( firstStrand, blockFirstStrand )];
+			auto const copyEndVertex = firstStrandVertices_[std::min( endStrand, blockEndStrand )];
+			auto const valueOffset = ( widths ? 3 * blockVertexCount : 0 ) + ( copyFirstVertex - firstStrandVertices_[blockFirstStrand] ) * components;
+			auto const valueCount = ( copyEndVertex - copyFirstVertex ) * components;
+			auto const* const firstValues = first->data() + valueOffset;
+			auto const* const nextValues = next->data() + valueOffset;
+			auto* const output = result + ( copyFirstVertex - firstStrandVertices_[firstStrand] ) * components;
+			if( first == next )
+			{
+				std::copy( firstValues, firstValues + valueCount, output );
+			}
+			else
+			{
+				for( auto index = 0; index < valueCount; ++index )
+				{
+					output[index] = firstValues[index] + ( nextValues[index] - firstValues[index] ) * weight;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	DecodedBlock GetBlock( int frame, int block ) const
+	{
+		auto const key = BlockKey( frame, block );
+		{
+			std::lock_guard<std::mutex> lock( cacheMutex_ );
+			auto const found = cache_.find( key );
+			if( found != cache_.end() )
+			{
+				recentlyUsed_.splice( recentlyUsed_.begin(), recentlyUsed_, found->second.recentlyUsed );
+				return found->second.block;
+			}
+		}
+
+		// Decompress without holding the lock, other threads may read other blocks meanwhile
+		auto const& location = blocks_[frame * GetBlockCount() + block];
+		auto const firstStrand = block * strandsPerBlock_;
+		auto const endStrand = std::min( firstStrand + strandsPerBlock_, GetStrandCount() );
+		auto const vertexCount = firstStrandVertices_[endStrand] - firstStrandVertices_[firstStrand];
+		std::shared_ptr<std::vector<float>> decoded( new std::vector<float>( vertexCount * ( hasWidths_ ? 4 : 3 ) ) );
+
+		// Quantized blocks are inflated into a separate buffer, the others directly into the result
+		std::vector<char> quantized( isQuantized_ ? location.decodedSize : 0 );
+		auto* const inflated = isQuantized_ ? quantized.data() : reinterpret_cast<char*>( decoded->data() );
+		if( !isQuantized_ && location.decodedSize != decoded->size() * sizeof( float ) )
+		{
+			return DecodedBlock();
+		}
+
+		auto const* const stored = file_.data() + location.offset;
+		if( location.storedSize == location.decodedSize )
+		{
+			if( location.decodedSize > 0 )
+			{
+				std::memcpy( inflated, stored, location.decodedSize );
+			}
+		}
+		else
+		{
+			std::size_t inflatedSize = location.decodedSize;
+			if( Inflater::Inflate( stored, location.storedSize, inflated, inflatedSize ) != Inflater::Status::Complete
+				|| inflatedSize != location.decodedSize )
+			{
+				return DecodedBlock();
+			}
+		}
+
+		if( isQuantized_ && !StrandQuantization::Decode(
+			Span<int const>( strandPointCounts_.data() + firstStrand, endStrand - firstStrand ),
+			quantized.data(),
+			quantized.size(),
+			hasWidths_,
+			reinterpret_cast<Geometry::Vector3f*>( decoded->data() ),
+			hasWidths_ ? decoded->data() + 3 * vertexCount : nullptr ) )
+		{
+			return DecodedBlock();
+		}
+
+		std::lock_guard<std::mutex> lock( cacheMutex_ );
+		++decodeCount_;
+		auto const found = cache_.find( key );
+		if( found != cache_.end() )
+		{
+			// Another thread decoded the same block meanwhile
+			return found->second.block;
+		}
+
+		recentlyUsed_.push_front( key );
+		CacheEntry& entry = cache_[key];
+		entry.block = decoded;
+		entry.recentlyUsed = recentlyUsed_.begin();
+		cachedSize_ += decoded->size() * sizeof( float );
+
+		// The block just added is kept even if it alone exceeds the cache size
+		while( cachedSize_ > cacheSize_ && recentlyUsed_.size() > 1 )
+		{
+			auto const evicted = cache_.find( recentlyUsed_.back() );
+			cachedSize_ -= evicted->second.block->size() * sizeof( float );
+			cache_.erase( evicted );
+			recentlyUsed_.pop_back();
+		}
+
+		return decoded;
+	}
+
+	MappedFile file_;
+
+	std::vector<int> strandPointCounts_;
+	std::vector<int> originalStrandIndices_;
+	std::vector<int> firstStrandVertices_;
+	std::vector<double> times_;
+	std::vector<Detail::BlockLocation> blocks_;
+	int strandsPerBlock_;
+	bool hasWidths_;
+	bool isQuantized_;
+
+	mutable std::mutex cacheMutex_;
+	mutable std::map<BlockKey, CacheEntry> cache_;
+	mutable std::list<BlockKey> recentlyUsed_;
+	std::size_t cacheSize_;
+	mutable std::size_t cachedSize_;
+	mutable int decodeCount_;
+};
+
+}
+
+} }
@@ -0,0 +1,331 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/NativeTools/ThreadPool.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+#include "Ephere/Ornatrix/UsdTimeSamples.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+//! Options of ExportHairPipelined() on top of IUsdSerializer::ExportHairOptions, which are passed to the library as they are
+struct PipelinedExportOptions
+{
+	//! Called when the exporter is done with the hair returned by the evaluator
+	typedef void( *HairReleaseFunctionType )( void* node, IHair* hair );
+
+	explicit PipelinedExportOptions( int concurrentFrameCount = 1, int pipelineDepth = 0, HairReleaseFunctionType releaseHair = nullptr,
+		bool removeRedundantTimeSamples = true )
+		: concurrentFrameCount( concurrentFrameCount ),
+		pipelineDepth( pipelineDepth ),
+		releaseHair( releaseHair ),
+		removeRedundantTimeSamples( removeRedundantTimeSamples )
+	{
+	}
+
+	EPHERE_NODISCARD bool IsPipelined() const
+	{
+		return pipelineDepth > 0 || concurrentFrameCount > 1;
+	}
+
+	//! Maximum number of frames evaluated at the same time. Values above 1 require an evaluator which can be called concurrently.
+	int concurrentFrameCount;
+
+	//! Number of frames evaluated ahead of the frame being written, 0 evaluates frames only when they are written
+	int pipelineDepth;
+
+	//! Required for pipelined frames, receives the hair of each frame once the exporter is done with it, see HairExportPipeline
+	HairReleaseFunctionType releaseHair;
+
+	//! Removes time samples which repeat the values around them from exported text layers, see UsdTimeSamples::RemoveRedundant()
+	bool removeRedundantTimeSamples;
+};
+
+/*! Evaluates the frames of IUsdSerializer::ExportHair() ahead of the exporter.
+
+ExportHair() asks the evaluator for one frame, writes it and only then asks for the next one, so evaluation and encoding never overlap. The pipeline is
+passed to ExportHair() in place of the node, together with an evaluator which hands out frames evaluated on worker threads: while frame N is written,
+up to PipelinedExportOptions::pipelineDepth following frames are evaluated, concurrentFrameCount of them at the same time.
+
+The host evaluator is called on a worker thread of the pipeline, while the exporter is still writing the previous frame on the calling thread. This is the
+case even with a concurrentFrameCount of 1, so the evaluator must not rely on running on the calling thread, and it must not modify the hair it returned
+for earlier frames: an evaluator which updates and returns the same hair object every frame would overwrite the frame being written. It must return
+a separate hair object for each frame instead, which stays valid until it is passed to PipelinedExportOptions::releaseHair. The pipeline therefore requires
+releaseHair. A frame is released when the exporter asks for the next one, or when the pipeline is destroyed. If the evaluator reports cancellation, no
+further frames are started.
+*/
+class HairExportPipeline
+{
+public:
+
+	typedef IUsdSerializer::ExportHairOptions ExportHairOptions;
+	typedef ExportHairOptions::EvaluateResult EvaluateResult;
+
+	//! pipelineOptions.releaseHair must be set, see above
+	HairExportPipeline( void* node, ExportHairOptions const& options, PipelinedExportOptions const& pipelineOptions )
+		: node_( node ),
+		options_( options ),
+		releaseHair_( pipelineOptions.releaseHair ),
+		lookAhead_( std::max( pipelineOptions.pipelineDepth, pipelineOptions.concurrentFrameCount - 1 ) ),
+		nextFrameToStart_( 0 ),
+		isCanceled_( false ),
+		pool_( new ThreadPool( std::max( pipelineOptions.concurrentFrameCount, 1 ) ) )
+	{
+		// Same frames as the exporter, which steps from the start time until it passes the end time
+		auto frameCount = 1;
+		if( options.timeStep > 0 && options.timeEnd > options.timeStart )
+		{
+			frameCount = static_cast<int>( std::floor( ( options.timeEnd - options.timeStart ) / options.timeStep + 1e-6 ) ) + 1;
+		}
+
+		frames_.resize( frameCount );
+		for( auto index = 0; index < frameCount; ++index )
+		{
+			frames_[index].time = options.timeStart + index * options.timeStep;
+		}
+	}
+
+	~HairExportPipeline()
+	{
+		std::vector<IHair*> unusedHair;
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+			isCanceled_ = true;
+			WaitForRunningFrames( lock );
+			for( auto& frame : frames_ )
+			{
+				if( frame.state == Frame::Evaluated || frame.state == Frame::HandedOut )
+				{
+					unusedHair.push_back( frame.result.hair );
+					frame.state = Frame::Released;
+				}
+			}
+		}
+
+		Release( unusedHair );
+		pool_.reset();
+	}
+
+	//! Options to pass to ExportHair() together with this pipeline as the node
+	ExportHairOptions GetExportOptions() const
+	{
+		auto result = options_;
+		result.evaluator = &HairExportPipeline::Evaluate;
+		return result;
+	}
+
+	static EvaluateResult Evaluate( void* pipeline, double const time, double const completedPercent )
+	{
+		return static_cast<HairExportPipeline*>( pipeline )->EvaluateFrame( time, completedPercent );
+	}
+
+private:
+
+	struct Frame
+	{
+		enum State
+		{
+			Waiting,
+			Running,
+			Evaluated,
+			HandedOut,
+			Released
+		};
+
+		Frame()
+			: time( 0 ),
+			state( Waiting )
+		{
+		}
+
+		double time;
+		State state;
+		EvaluateResult result;
+	};
+
+	HairExportPipeline( HairExportPipeline const& );
+
+	HairExportPipeline& operator=( HairExportPipeline const& );
+
+	EvaluateResult EvaluateFrame( double const time, double const completedPercent )
+	{
+		std::vector<IHair*> consumedHair;
+		EvaluateResult result;
+		{
+			std::unique_lock<std::mutex> lock( mutex_ );
+
+			// The exporter is done with the frames it got before
+			for( auto& frame : frames_ )
+			{
+				if( frame.state == Frame::HandedOut )
+				{
+					consumedHair.push_back( frame.result.hair );
+					frame.state = Frame::Released;
+				}
+			}
+
+			auto const index = FindFrame( time );
+			if( index < 0 )
+			{
+				// Not one of the expected frames, evaluate it directly once nothing else runs, since the evaluator may not be reentrant
+				WaitForRunningFrames( lock );
+				lock.unlock();
+				Release( consumedHair );
+				return options_.evaluator( node_, time, completedPercent );
+			}
+
+			StartFrames( index );
+
+			auto& frame = frames_[index];
+			while( frame.state == Frame::Running )
+			{
+				condition_.wait( lock );
+			}
+
+			if( frame.state == Frame::Evaluated )
+			{
+				frame.state = Frame::HandedOut;
+				result = frame.result;
+			}
+			else
+			{
+				// Evaluation was canceled before this frame was started
+				result.canceled = true;
+			}
+		}
+
+		Release( consumedHair );
+		return result;
+	}
+
+	int FindFrame( double const time ) const
+	{
+		auto const tolerance = options_.timeStep > 0 ? options_.timeStep / 2 : 1e-6;
+		auto const index = options_.timeStep > 0 ? static_cast<int>( std::floor( ( time - options_.timeStart ) / options_.timeStep + 0.5 ) ) : 0;
+		if( index < 0 || index >= static_cast<int>( frames_.size() ) || std::abs( frames_[index].time - time ) > tolerance )
+		{
+			return -1;
+		}
+
+		return index;
+	}
+
+	// Expects the mutex to be locked
+	void StartFrames( int const requestedIndex )
+	{
+		nextFrameToStart_ = std::max( nextFrameToStart_, requestedIndex );
+		auto const lastIndex = std::min( requestedIndex + lookAhead_, static_cast<int>( frames_.size() ) - 1 );
+		for( ; nextFrameToStart_ <= lastIndex && !isCanceled_; ++nextFrameToStart_ )
+		{
+			auto const index = nextFrameToStart_;
+			frames_[index].state = Frame::Running;
+			pool_->Submit( [this, index]
+			{
+				RunFrame( index );
+			} );
+		}
+	}
+
+	void RunFrame( int const index )
+	{
+		auto const completedPercent = 100.0 * index / frames_.size();
+		auto const result = options_.evaluator( node_, frames_[index].time, completedPercent );
+
+		{
+			std::lock_guard<std::mutex> lock( mutex_ );
+			frames_[index].result = result;
+			frames_[index].state = Frame::Evaluated;
+			if( result.canceled )
+			{
+				isCanceled_ = true;
+			}
+		}
+
+		condition_.notify_all();
+	}
+
+	void WaitForRunningFrames( std::unique_lock<std::mutex>& lock )
+	{
+		auto const isRunning = []( Frame const& frame )
+		{
+			return frame.state == Frame::Running;
+		};
+
+		while( std::any_of( frames_.begin(), frames_.end(), isRunning ) )
+		{
+			condition_.wait( lock );
+		}
+	}
+
+	void Release( std::vector<IHair*> const& hairs ) const
+	{
+		if( releaseHair_ == nullptr )
+		{
+			return;
+		}
+
+		for( auto* hair : hairs )
+		{
+			if( hair != nullptr )
+			{
+				releaseHair_( node_, hair );
+			}
+		}
+	}
+
+	void* node_;
+	ExportHairOptions options_;
+	PipelinedExportOptions::HairReleaseFunctionType releaseHair_;
+	int lookAhead_;
+
+	std::vector<Frame> frames_;
+	int nextFrameToStart_;
+	bool isCanceled_;
+
+	std::mutex mutex_;
+	std::condition_variable condition_;
+
+	std::unique_ptr<ThreadPool> pool_;
+};
+
+/*! Exports hair like IUsdSerializer::ExportHair(), evaluating frames ahead of the exporter with a HairExportPipeline if the pipeline options ask for
+concurrent or pipelined evaluation. Text layers are then stripped of redundant time samples if PipelinedExportOptions::removeRedundantTimeSamples is set.
+Returns false without exporting anything if frames are to be pipelined without PipelinedExportOptions::releaseHair.
+*/
+inline bool ExportHairPipelined( IUsdSerializer const& serializer, void* node, IUsdSerializer::ExportHairOptions const& options,
+	PipelinedExportOptions const& pipelineOptions, StringView filePath, StringView objectName = "" )
+{
+	bool result;
+	if( !pipelineOptions.IsPipelined() )
+	{
+		result = serializer.ExportHair( node, options, filePath, objectName );
+	}
+	else if( pipelineOptions.releaseHair == nullptr )
+	{
+		return false;
+	}
+	else
+	{
+		HairExportPipeline pipeline( node, options, pipelineOptions );
+		result = serializer.ExportHair( &pipeline, pipeline.GetExportOptions(), filePath, objectName );
+	}
+
+	if( result && pipelineOptions.removeRedundantTimeSamples && options.timeEnd > options.timeStart
+		&& EndsWith<CaseInsensitiveCharTraits<char>>( filePath, IUsdSerializer::ExtensionUsd() ) )
+	{
+		result = UsdTimeSamples::RemoveRedundantFromFile( std::string( filePath.data(), filePath.length() ) );
+	}
+
+	return result;
+}
+
+} }
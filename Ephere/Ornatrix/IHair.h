@@ -1375,6 +1375,57 @@ protected:
 	}
 };
 
+/** Read-only structure-of-arrays snapshot of the data which IHair3 exposes by reference: vertices, strand topologies, strand ids and strand transforms.
+
+All spans point directly into the storage of the hair object, nothing is copied. They stay valid only as long as the hair is not modified or destroyed.
+Attributes which are not present in the hair are returned as empty spans. Other attributes, like widths, rotations, dependencies and channels, are only
+available through the IHair1 getters, which copy them.
+*/
+struct HairView
+{
+	HairView()
+		: strandCount( 0 ),
+		vertexCount( 0 ),
+		globalStrandPointCount( 0 ),
+		coordinateSpace( IHair1::Strand )
+	{
+	}
+
+	int strandCount;
+	int vertexCount;
+
+	//! Used to find the vertices of each strand when strandTopologies is empty
+	int globalStrandPointCount;
+
+	IHair1::CoordinateSpace coordinateSpace;
+
+	Span<Vector3 const> vertices;
+	Span<StrandTopology const> strandTopologies;
+	Span<StrandId const> strandIds;
+	Span<Xform3 const> strandToObjectTransforms;
+
+
+	EPHERE_NODISCARD bool IsEmpty() const
+	{
+		return strandCount == 0;
+	}
+
+	EPHERE_NODISCARD int GetStrandFirstVertexIndex( int const strandIndex ) const
+	{
+		return !strandTopologies.empty() ? static_cast<int>( strandTopologies[strandIndex].startingVertexIndex ) : strandIndex * globalStrandPointCount;
+	}
+
+	EPHERE_NODISCARD int GetStrandPointCount( int const strandIndex ) const
+	{
+		return !strandTopologies.empty() ? static_cast<int>( strandTopologies[strandIndex].vertexCount ) : globalStrandPointCount;
+	}
+
+	EPHERE_NODISCARD Span<Vector3 const> GetStrandVertices( int const strandIndex ) const
+	{
+		return vertices.subspan( GetStrandFirstVertexIndex( strandIndex ), GetStrandPointCount( strandIndex ) );
+	}
+};
+
 class IHair3 : public IHair2
 {
 public:
@@ -1405,6 +1456,33 @@ public:
 	EPHERE_NODISCARD virtual std::vector<StrandId> const& ReadStrandIds() const = 0;
 	EPHERE_NODISCARD virtual Span<Xform3 const> ReadStrandToObjectTransforms() const = 0;
 
+	//! Gets a snapshot of the attributes returned by the Read*() functions without copying any of them. See HairView for the lifetime of the returned data.
+	EPHERE_NODISCARD HairView ReadView() const
+	{
+		HairView result;
+		result.strandCount = GetStrandCount();
+		result.vertexCount = GetVertexCount();
+		result.globalStrandPointCount = GetGlobalStrandPointCount();
+		result.coordinateSpace = GetCoordinateSpace();
+		result.vertices = ReadVertices();
+		if( HasStrandTopology() )
+		{
+			result.strandTopologies = ReadStrandTopologies();
+		}
+
+		if( HasStrandIds() )
+		{
+			result.strandIds = ReadStrandIds();
+		}
+
+		if( HasStrandToObjectTransforms() )
+		{
+			result.strandToObjectTransforms = ReadStrandToObjectTransforms();
+		}
+
+		return result;
+	}
+
 	EPHERE_NODISCARD virtual bool IsTransformationNeeded( IHair1::CoordinateSpace coordinateSpace ) const
 	{
 		if( GetCoordinateSpace() != coordinateSpace && HasStrandToObjectTransforms() )
@@ -0,0 +1,389 @@
+// Must compile with VC 2012 / GCC 4.8
+
+// ReSharper disable CppClangTidyModernizeUseEqualsDelete
+#pragma once
+
+#include "Ephere/Geometry/Native/MeshSurfacePosition.h"
+#include "Ephere/Ornatrix/GuideDependency.h"
+#include "Ephere/Ornatrix/IHair.h"
+#include "Ephere/Ornatrix/StrandInterpolation.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Hair generated from guides which stores only what is needed to generate each strand, instead of its vertices.
+
+This is the instanced form of HairFromGuidesParameters::UseInstancedStrands for consumers which process strands a range at a time, like render
+procedurals. Guide shapes are stored once, in the space of their roots and resampled to the point count of the hair. Each strand keeps the
+references to its guides with their weights (GuideDependency2), its root frame (strand to object transform) and optionally its strand id and surface
+position, which takes a few dozen bytes instead of the vertices of the strand. Vertices are generated on request for a range of strands, a batch at a
+time with StrandInterpolation, or for a single strand without a batch. Generating vertices doesn't modify the hair, so several threads can do it at the
+same time.
+*/
+class InstancedHair
+{
+public:
+
+	typedef StrandInterpolation::Method Method;
+
+	explicit InstancedHair( int pointCount, Method method = Method::Affine )
+		: pointCount_( std::max( pointCount, 1 ) ),
+		method_( method )
+	{
+	}
+
+	/*! Sets the guide shapes, removing all strands since their guide references may not be valid anymore
+	@param points pointCount points of every guide in the space of its root, the first point of each guide is its root
+	@param strandIds Strand id of every guide, as used in the GuideDependency2 of strands, or null to use the guide indices
+	*/
+	void SetGuides( int guideCount, int pointCount, Geometry::Vector3f const* points, StrandId const* strandIds = nullptr )
+	{
+		ClearStrands();
+		guideIndices_.clear();
+		guidePoints_.resize( guideCount * pointCount_ );
+		for( auto guide = 0; guide < guideCount; ++guide )
+		{
+			Resample( points + guide * pointCount, pointCount, &guidePoints_[guide * pointCount_] );
+			if( strandIds != nullptr )
+			{
+				guideIndices_[strandIds[guide]] = guide;
+			}
+		}
+	}
+
+	//! Sets the guide shapes from guide hair, see SetGuides()
+	bool SetGuides( IHair const& guides )
+	{
+		auto const guideCount = guides.GetStrandCount();
+		std::vector<int> pointCounts( guideCount );
+		if( !guides.GetStrandPointCounts( 0, guideCount, pointCounts.data() ) )
+		{
+			return false;
+		}
+
+		ClearStrands();
+		guideIndices_.clear();
+		guidePoints_.resize( guideCount * pointCount_ );
+		std::vector<Geometry::Vector3f> points;
+		for( auto guide = 0; guide < guideCount; ++guide )
+		{
+			points.resize( pointCounts[guide] );
+			if( !points.empty() && !guides.GetStrandPoints( guide, 0, pointCounts[guide], points.data(), IHair::Strand ) )
+			{
+				return false;
+			}
+
+			// Guides without strand transforms have their points in object space, which needs to be made relative to the root
+			for( auto index = static_cast<int>( points.size() ) - 1; index >= 0; --index )
+			{
+				points[index] -= points[0];
+			}
+
+			Resample( points.data(), pointCounts[guide], &guidePoints_[guide * pointCount_] );
+		}
+
+		if( guides.HasStrandIds() )
+		{
+			std::vector<StrandId> strandIds( guideCount );
+			if( !guides.GetStrandIds( 0, guideCount, strandIds.data() ) )
+			{
+				return false;
+			}
+
+			for( auto guide = 0; guide < guideCount; ++guide )
+			{
+				guideIndices_[strandIds[guide]] = guide;
+			}
+		}
+
+		return true;
+	}
+
+	/*! Adds a strand
+	@param guides Up to MaxGuideInterpolationCount guides of the strand, by strand id, with their weights
+	@param surfacePosition Position of the root on the distribution mesh, kept for consumers which need it, either given for all strands or none
+	@param strandId Id of the strand, either given for all strands or none
+	@return False if a guide is not known
+	*/
+	bool AddStrand( Geometry::Xform3f const& strandToObject, GuideDependency2 const* guides, int guideCount,
+		Geometry::MeshSurfacePosition const* surfacePosition = nullptr, StrandId const* strandId = nullptr )
+	{
+		Strand strand;
+		strand.strandToObject = strandToObject;
+		for( auto index = 0; index < MaxGuideInterpolationCount; ++index )
+		{
+			strand.guideIndices[index] = -1;
+			strand.weights[index] = 0;
+			if( index < guideCount )
+			{
+				strand.guideIndices[index] = GetGuideIndex( guides[index].strandId );
+				strand.weights[index] = guides[index].weight;
+				if( strand.guideIndices[index] < 0 )
+				{
+					return false;
+				}
+			}
+		}
+
+		strands_.push_back( strand );
+		if( surfacePosition != nullptr )
+		{
+			surfacePositions_.push_back( *surfacePosition );
+		}
+
+		if( strandId != nullptr )
+		{
+			strandIds_.push_back( *strandId );
+		}
+
+		return true;
+	}
+
+	void ClearStrands()
+	{
+		strands_.clear();
+		surfacePositions_.clear();
+		strandIds_.clear();
+	}
+
+	EPHERE_NODISCARD int GetStrandCount() const
+	{
+		return static_cast<int>( strands_.size() );
+	}
+
+	EPHERE_NODISCARD int GetGuideCount() const
+	{
+		return static_cast<int>( guidePoints_.size() ) / pointCount_;
+	}
+
+	//! Point count of every strand
+	EPHERE_NODISCARD int GetPointCount() const
+	{
+		return pointCount_;
+	}
+
+	EPHERE_NODISCARD int GetVertexCount() const
+	{
+		return GetStrandCount() * pointCount_;
+	}
+
+	EPHERE_NODISCARD Method GetMethod() const
+	{
+		return method_;
+	}
+
+	EPHERE_NODISCARD bool HasSurfacePositions() const
+	{
+		return !strands_.empty() && surfacePositions_.size() == strands_.size();
+	}
+
+	bool GetSurfacePositions( int firstStrandIndex, int count, Geometry::MeshSurfacePosition* result ) const
+	{
+		if( !HasSurfacePositions() || !IsValidRange( firstStrandIndex, count ) )
+		{
+			return false;
+		}
+
+		std::copy( surfacePositions_.begin() + firstStrandIndex, surfacePositions_.begin() + firstStrandIndex + count, result );
+		return true;
+	}
+
+	EPHERE_NODISCARD bool HasStrandIds() const
+	{
+		return !strands_.empty() && strandIds_.size() == strands_.size();
+	}
+
+	bool GetStrandIds( int firstStrandIndex, int count, StrandId* result ) const
+	{
+		if( !HasStrandIds() || !IsValidRange( firstStrandIndex, count ) )
+		{
+			return false;
+		}
+
+		std::copy( strandIds_.begin() + firstStrandIndex, strandIds_.begin() + firstStrandIndex + count, result );
+		return true;
+	}
+
+	bool GetStrandToObjectTransforms( int firstStrandIndex, int count, Geometry::Xform3f* result ) const
+	{
+		if( !IsValidRange( firstStrandIndex, count ) )
+		{
+			return false;
+		}
+
+		for( auto index = 0; index < count; ++index )
+		{
+			result[index] = strands_[firstStrandIndex + index].strandToObject;
+		}
+
+		return true;
+	}
+
+	//! Generates the object space vertices of a range of strands, GetPointCount() for each of them
+	bool GetVertices( int firstStrandIndex, int count, Geometry::Vector3f* result ) const
+	{
+		if( !IsValidRange( firstStrandIndex, count ) )
+		{
+			return false;
+		}
+
+		StrandInterpolation::Batch batch( pointCount_ );
+		Geometry::Vector3f const* guidePoints[MaxGuideInterpolationCount];
+		for( auto batchStart = 0; batchStart < count; batchStart += StrandInterpolation::Batch::LaneCount )
+		{
+			auto const batchCount = std::min( count - batchStart, static_cast<int>( StrandInterpolation::Batch::LaneCount ) );
+			batch.Clear();
+			for( auto lane = 0; lane < batchCount; ++lane )
+			{
+				auto const& strand = strands_[firstStrandIndex + batchStart + lane];
+				GetGuidePoints( strand, guidePoints );
+				batch.Add( strand.strandToObject, guidePoints, strand.weights );
+			}
+
+			StrandInterpolation::Interpolate( method_, batch );
+			for( auto lane = 0; lane < batchCount; ++lane )
+			{
+				batch.GetResult( lane, result + ( batchStart + lane ) * pointCount_ );
+			}
+		}
+
+		return true;
+	}
+
+	//! Generates object space points of one strand, like IHair::GetStrandPoints(). Doesn't allocate, and stops at the last requested point.
+	bool GetStrandPoints( int strandIndex, int firstPointIndex, int pointCount, Geometry::Vector3f* result ) const
+	{
+		if( !IsValidRange( strandIndex, 1 ) || firstPointIndex < 0 || pointCount < 0 || firstPointIndex + pointCount > pointCount_ )
+		{
+			return false;
+		}
+
+		auto const& strand = strands_[strandIndex];
+		Geometry::Vector3f const* guidePoints[MaxGuideInterpolationCount];
+		GetGuidePoints( strand, guidePoints );
+		StrandInterpolation::InterpolateStrand( method_, strand.strandToObject, guidePoints, strand.weights, firstPointIndex, pointCount, result );
+		return true;
+	}
+
+	/*! Generates all strands into regular hair for consumers which need an IHair, with their strand to object transforms, and their strand ids and
+	surface positions if the strands have them
+	@param strandsPerChunk Strands generated at a time, which limits the temporary memory used
+	*/
+	bool Expand( IHair& result, int strandsPerChunk = 4096 ) const
+	{
+		auto const strandCount = GetStrandCount();
+		result.SetStrandCount( strandCount );
+		result.SetGlobalStrandPointCount( pointCount_ );
+		result.SetVertexCount( GetVertexCount() );
+		result.SetUseStrandToObjectTransforms( true );
+		result.SetUseStrandIds( HasStrandIds() );
+		if( HasStrandIds() && !result.SetStrandIds( 0, strandCount, strandIds_.data() ) )
+		{
+			return false;
+		}
+
+		// Transforms are set before the vertices, which are converted to strand space with them
+		std::vector<Geometry::Xform3f> transforms;
+		std::vector<Geometry::Vector3f> vertices;
+		for( auto firstStrand = 0; firstStrand < strandCount; firstStrand += strandsPerChunk )
+		{
+			auto const count = std::min( strandsPerChunk, strandCount - firstStrand );
+			transforms.resize( count );
+			vertices.resize( count * pointCount_ );
+			if( !GetStrandToObjectTransforms( firstStrand, count, transforms.data() )
+				|| !result.SetStrandToObjectTransforms( firstStrand, count, transforms.data() )
+				|| !GetVertices( firstStrand, count, vertices.data() )
+				|| !result.SetVertices( firstStrand * pointCount_, count * pointCount_, vertices.data(), IHair::Object ) )
+			{
+				return false;
+			}
+		}
+
+		if( HasSurfacePositions() )
+		{
+			result.SetUseSurfaceDependency( true );
+			return result.SetSurfaceDependencies( 0, strandCount, surfacePositions_.data() );
+		}
+
+		return true;
+	}
+
+	//! Approximate memory used by the hair in bytes
+	EPHERE_NODISCARD std::size_t GetMemorySize() const
+	{
+		return sizeof( *this ) + strands_.capacity() * sizeof( Strand ) + surfacePositions_.capacity() * sizeof( Geometry::MeshSurfacePosition )
+			+ strandIds_.capacity() * sizeof( StrandId )
+			+ guidePoints_.capacity() * sizeof( Geometry::Vector3f ) + guideIndices_.size() * ( sizeof( StrandId ) + sizeof( int ) + 2 * sizeof( void* ) );
+	}
+
+private:
+
+	struct Strand
+	{
+		Geometry::Xform3f strandToObject;
+		int guideIndices[MaxGuideInterpolationCount];
+		float weights[MaxGuideInterpolationCount];
+	};
+
+	InstancedHair( InstancedHair const& );
+
+	InstancedHair& operator=( InstancedHair const& );
+
+	bool IsValidRange( int firstStrandIndex, int count ) const
+	{
+		return firstStrandIndex >= 0 && count >= 0 && firstStrandIndex + count <= GetStrandCount();
+	}
+
+	int GetGuideIndex( StrandId strandId ) const
+	{
+		if( guideIndices_.empty() )
+		{
+			return strandId < static_cast<unsigned>( GetGuideCount() ) ? static_cast<int>( strandId ) : -1;
+		}
+
+		auto const found = guideIndices_.find( strandId );
+		return found != guideIndices_.end() ? found->second : -1;
+	}
+
+	void GetGuidePoints( Strand const& strand, Geometry::Vector3f const** result ) const
+	{
+		for( auto index = 0; index < MaxGuideInterpolationCount; ++index )
+		{
+			result[index] = strand.guideIndices[index] >= 0 ? &guidePoints_[strand.guideIndices[index] * pointCount_] : nullptr;
+		}
+	}
+
+	// Resamples a polyline to pointCount_ points evenly spaced in point index
+	void Resample( Geometry::Vector3f const* points, int pointCount, Geometry::Vector3f* result ) const
+	{
+		for( auto index = 0; index < pointCount_; ++index )
+		{
+			if( pointCount <= 1 || pointCount_ == 1 )
+			{
+				result[index] = pointCount > 0 ? points[0] : Geometry::Vector3f( 0, 0, 0 );
+				continue;
+			}
+
+			auto const position = static_cast<float>( index ) * ( pointCount - 1 ) / ( pointCount_ - 1 );
+			auto const segment = std::min( static_cast<int>( position ), pointCount - 2 );
+			auto const fraction = position - segment;
+			result[index] = points[segment] * ( 1 - fraction ) + points[segment + 1] * fraction;
+		}
+	}
+
+	int pointCount_;
+	Method method_;
+
+	std::vector<Geometry::Vector3f> guidePoints_;
+	std::unordered_map<StrandId, int> guideIndices_;
+
+	std::vector<Strand> strands_;
+	std::vector<Geometry::MeshSurfacePosition> surfacePositions_;
+	std::vector<StrandId> strandIds_;
+};
+
+} }
@@ -10,7 +10,10 @@
 #include "Ephere/NativeTools/Log.h"
 #include "Ephere/NativeTools/SmartPointers.h"
 #include "Ephere/NativeTools/StringToolsBase.h"
+#include "Ephere/Ornatrix/GroomInfoProbe.h"
+#include "Ephere/Ornatrix/GroomTimeSamples.h"
 #include "Ephere/Ornatrix/PythonInterfaces.h"
+#include "Ephere/Ornatrix/Groom/GraphEvaluator.h"
 #include "Ephere/Ornatrix/Groom/IGraph.h"
 #include "Ephere/Ornatrix/Groom/IOperator.h"
 
@@ -168,10 +171,17 @@ struct IUsdSerializer : IGroomSerializer
 		return ".usdz";
 	}
 
+	//! Binary (crate) layers, ExportHair() writes them when given a file path with this extension
+	static char const* ExtensionUsdBinary()
+	{
+		return ".usdc";
+	}
+
 
 	static bool HasUsdExtension( std::string_view filePath )
 	{
 		return EndsWith<CaseInsensitiveCharTraits<char>>( filePath, ExtensionUsd() )
+			|| EndsWith<CaseInsensitiveCharTraits<char>>( filePath, ExtensionUsdBinary() )
 			|| EndsWith<CaseInsensitiveCharTraits<char>>( filePath, ExtensionUsdZip() );
 	}
 
@@ -289,7 +299,7 @@ struct IGrooms
 				&& EndsWith<CaseInsensitiveCharTraits<char>>( filePath.substr( 0, filePath.length() - ext.length() ), BaseFileExtension() );
 		};
 
-		auto serializers = GetGroomSerializers();
+		auto serializers = GetAllGroomSerializers();
 		for( auto index = 0; index < static_cast<int>( serializers.size() ); ++index )
 		{
 			if( !zippedOnly && hasExt( serializers[index]->GroomFileFormatExtension() )
@@ -313,8 +323,26 @@ struct IGrooms
 
 	EPHERE_NODISCARD virtual UniquePtr<Groom::IGraph> CreateGroom( Groom::CoordinateSystemProperties const& ) const = 0;
 
+	/*! Reads only the beginning of the file, or of the groom inside a zip archive, see GroomInfoProbe. Falls back to loading the whole file when the header
+	can't be read that way, e.g. for binary USD files.
+	*/
 	bool GetGroomInfoFromFile( std::string_view filePath, GroomInfo& info ) const
 	{
+		auto const isGroomEntry = [this]( std::string_view entryName )
+		{
+			return HasGroomExtension( entryName );
+		};
+
+		std::string prefix;
+		std::string_view header;
+		auto isComplete = false;
+		if( GroomInfoProbe::ReadGroomPrefix( std::string( filePath ), isGroomEntry, GroomInfoProbe::DefaultPrefixSize, prefix, isComplete )
+			&& GroomInfoProbe::GetHeader( std::string_view( prefix.data(), prefix.size() ), isComplete, header )
+			&& GetGroomInfoFromContentBuffer( header, info ) && info.IsValid() )
+		{
+			return true;
+		}
+
 		SerializedGroom serialized;
 		return LoadGroomFromFile( filePath, serialized ) && GetGroomInfoFromContentBuffer( serialized.contentBuffer, info );
 	}
@@ -340,9 +368,48 @@ struct IGrooms
 	// The first one is the default
 	EPHERE_NODISCARD virtual Parameters::Array<IGroomSerializer*> GetGroomSerializers() const = 0;
 
+	/*! Loads a groom file directly, e.g. by memory mapping it instead of reading it into a buffer. Called by DeserializeGroomFromFile() for unzipped files
+	of a registered serializer. */
+	typedef UniquePtr<Groom::IGraph>( *FileDeserializerFunctionType )(
+		IGroomSerializer const& serializer,
+		std::string_view filePath,
+		double time,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories );
+
+	/*! Adds a serializer which is implemented outside of the Ornatrix library, like BinaryGroomSerializer.
+	Registered serializers are considered by the serializer lookups of this interface after the ones returned by GetGroomSerializers().
+	The serializer must stay alive while it is registered. Registration is not thread-safe, it is meant to be done during initialization.
+	*/
+	static void RegisterGroomSerializer( IGroomSerializer& serializer, FileDeserializerFunctionType fileDeserializer = nullptr )
+	{
+		UnregisterGroomSerializer( serializer );
+		GetRegisteredGroomSerializers().push_back( std::make_pair( &serializer, fileDeserializer ) );
+	}
+
+	static void UnregisterGroomSerializer( IGroomSerializer& serializer )
+	{
+		auto& serializers = GetRegisteredGroomSerializers();
+		serializers.erase( std::remove_if( serializers.begin(), serializers.end(), [&serializer]( RegisteredGroomSerializer const& registered )
+		{
+			return registered.first == &serializer;
+		} ), serializers.end() );
+	}
+
+	//! Serializers of the library followed by the registered ones
+	EPHERE_NODISCARD Parameters::Array<IGroomSerializer*> GetAllGroomSerializers() const
+	{
+		auto result = GetGroomSerializers();
+		for( auto const& registered : GetRegisteredGroomSerializers() )
+		{
+			result.push_back( registered.first );
+		}
+
+		return result;
+	}
+
 	EPHERE_NODISCARD IGroomSerializer* GetGroomSerializerByFileExtension( std::string_view extension ) const
 	{
-		return FindFirstOrDefault( GetGroomSerializers(), nullptr, [&extension]( IGroomSerializer const* s )
+		return FindFirstOrDefault( GetAllGroomSerializers(), nullptr, [&extension]( IGroomSerializer const* s )
 		{
 			return static_cast<std::string_view>( s->GroomFileFormatExtension() ) == extension;
 		} );
@@ -350,12 +417,26 @@ struct IGrooms
 
 	EPHERE_NODISCARD IGroomSerializer* GetGroomSerializerFromContentBuffer( std::string_view contents ) const
 	{
-		return FindFirstOrDefault( GetGroomSerializers(), nullptr, [&contents]( IGroomSerializer const* s )
+		return FindFirstOrDefault( GetAllGroomSerializers(), nullptr, [&contents]( IGroomSerializer const* s )
 		{
 			return s->ContentsHasCorrectFormat( contents );
 		} );
 	}
 
+	//! Returns the registered serializer whose extension, zipped or not, the file has
+	EPHERE_NODISCARD static IGroomSerializer* FindRegisteredGroomSerializerForFile( std::string_view filePath )
+	{
+		for( auto const& registered : GetRegisteredGroomSerializers() )
+		{
+			if( registered.first->HasGroomExtension( filePath ) )
+			{
+				return registered.first;
+			}
+		}
+
+		return nullptr;
+	}
+
 	virtual bool LoadGroomFromFile( StringView filePath, SerializedGroom& ) const = 0;
 
 	/*! If no IGroomSerializer* is passed, it is derived from the file extension, or the default one is used.
@@ -379,12 +460,27 @@ struct IGrooms
 		bool ignoreExtraFiles = false,
 		bool createZipArchiveIfNeeded = true ) const
 	{
-		if( filePath.empty() )
+		GroomSerializeSettings const settings( time, writeDefaultValues, ignoreExtraFiles, createZipArchiveIfNeeded );
+		return SerializeGroomToFile( graph, filePath, settings, serializer );
+	}
+
+	//! Same as above, see GroomArchive::SerializeGroomToFile() for writing zip archives concurrently
+	Parameters::String SerializeGroomToFile(
+		Groom::IGraph const& graph,
+		std::string_view filePath,
+		GroomSerializeSettings const& settings,
+		IGroomSerializer* serializer = nullptr ) const
+	{
+		if( filePath.empty() || !Groom::LoadDeferredParameters( graph ) )
 		{
 			return "";
 		}
 
-		GroomSerializeSettings const settings( time, writeDefaultValues, ignoreExtraFiles, createZipArchiveIfNeeded );
+		if( serializer == nullptr )
+		{
+			serializer = FindRegisteredGroomSerializerForFile( filePath );
+		}
+
 		SerializedGroom result;
 		Parameters::String outputFilePath = filePath;
 		return SerializeGroom( graph, outputFilePath, settings, result, serializer ) ? outputFilePath : "";
@@ -401,7 +497,7 @@ struct IGrooms
 		GroomSerializeSettings const settings( time, writeDefaultValues, ignoreExtraFiles );
 		Parameters::String outputFilePath;
 		SerializedGroom result;
-		if( !SerializeGroom( graph, outputFilePath, settings, result, serializer ) )
+		if( !Groom::LoadDeferredParameters( graph ) || !SerializeGroom( graph, outputFilePath, settings, result, serializer ) )
 		{
 			return "";
 		}
@@ -418,15 +514,27 @@ struct IGrooms
 		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> = Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>(),
 		StringView extraFilesBaseDirectory = "" ) const = 0;
 
-	//! Expects a single file with the serialized groom. That's either an archive or a groom file without any additional files
+	/*! Expects a single file with the serialized groom. That's either an archive or a groom file without any additional files.
+	See GroomArchive::DeserializeGroomFromFile() for reading zip archives concurrently. If the file has a time sample sidecar (see GroomTimeSamples), its
+	values at time are applied to the result. */
 	EPHERE_NODISCARD UniquePtr<Groom::IGraph> DeserializeGroomFromFile(
 		std::string_view filePath,
 		double time = TimeUndefined,
 		IGroomSerializer* serializer = nullptr,
 		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories = Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>() ) const
 	{
-		SerializedGroom const groom;
-		return DeserializeGroom( filePath, groom, time, serializer, factories );
+		return ApplyTimeSampleSidecar( DeserializeGroomFromFileWithoutSidecar( filePath, time, serializer, factories ), filePath, time );
+	}
+
+	//! Applies the time sample sidecar of the groom file to a graph deserialized from it, see GroomTimeSamples::ApplySidecar()
+	EPHERE_NODISCARD static UniquePtr<Groom::IGraph> ApplyTimeSampleSidecar( UniquePtr<Groom::IGraph> graph, std::string_view filePath, double time )
+	{
+		if( graph && !GroomTimeSamples::ApplySidecar( *graph, std::string( filePath ), time ) )
+		{
+			graph.reset();
+		}
+
+		return graph;
 	}
 
 	// Expects a single buffer with the serialized groom. That's either an archive or a groom without any additional files
@@ -441,7 +549,144 @@ struct IGrooms
 		return DeserializeGroom( "", groom, time, serializer, factories );
 	}
 
+	//! Grooms with deferred parameter values (see Groom::IDeferredParameterLoader) need to be loaded with Groom::LoadDeferredParameters() first
 	virtual std::pair<UniquePtr<IHair>, UniquePtr<IPolygonMeshSA>> EvaluateGroom( Groom::IGraph&, Groom::EvaluationContext* = nullptr ) const = 0;
+
+	/*! Creates a persistent evaluation session for the graph. Unlike EvaluateGroom(), repeated evaluations through it only re-apply dirty nodes and the
+	nodes downstream of them, keeping the outputs of the other nodes from the previous evaluation.
+	*/
+	EPHERE_NODISCARD UniquePtr<Groom::GraphEvaluator> CreateEvaluator( Groom::IGraph& graph ) const
+	{
+		return UniquePtr<Groom::GraphEvaluator>( new Groom::GraphEvaluator( graph ) );
+	}
+
+	/*! Evaluates the groom at each of the times, calling the callback with the results of every frame.
+	Nodes which don't depend on the current time are evaluated only once. See Groom::EvaluateFrames().
+	@param setParameterTime Needed for grooms with animated parameters, see CreateParameterTimeFunction()
+	*/
+	bool EvaluateGroomFrames( Groom::IGraph& graph, Span<double const> times, Groom::FrameCallbackType const& callback, Groom::EvaluationContext* context = nullptr,
+		Groom::ParameterTimeFunctionType const& setParameterTime = Groom::ParameterTimeFunctionType() ) const
+	{
+		return Groom::EvaluateFrames( graph, times, callback, context, setParameterTime );
+	}
+
+	//! Evaluates frames in parallel, using one independent instance of the groom per thread. See Groom::EvaluateFrames().
+	bool EvaluateGroomFrames( Span<Groom::IGraph* const> graphs, Span<double const> times, Groom::FrameCallbackType const& callback, Groom::EvaluationContext* context = nullptr,
+		Groom::ParameterTimeFunctionType const& setParameterTime = Groom::ParameterTimeFunctionType() ) const
+	{
+		return Groom::EvaluateFrames( graphs, times, callback, context, setParameterTime );
+	}
+
+	/*! Loads the groom from a file and evaluates it at each of the times with the parameter values of every time.
+	The file and its time samples are read once, see CreateParameterTimeFunction().
+	*/
+	bool EvaluateGroomFileFrames( std::string_view filePath, Span<double const> times, Groom::FrameCallbackType const& callback,
+		Groom::EvaluationContext* context = nullptr ) const
+	{
+		auto const samples = std::make_shared<GroomTimeSamples::Samples>();
+		auto const graph = LoadTimeSamples( filePath, *samples );
+		return graph && EvaluateGroomFrames( *graph, times, callback, context, MakeParameterTimeFunction( samples ) );
+	}
+
+	/*! Returns the function setting the parameters of a graph loaded from the file to their values at a time, for EvaluateGroomFrames().
+	The groom is deserialized once at each time sample of the file, and the values which change are kept together with the time sample sidecar of the file
+	(see GroomTimeSamples::Samples). Every call then only sets the values interpolated at its time. The result is empty when the values never change.
+	*/
+	EPHERE_NODISCARD Groom::ParameterTimeFunctionType CreateParameterTimeFunction( std::string_view filePath ) const
+	{
+		auto const samples = std::make_shared<GroomTimeSamples::Samples>();
+		return LoadTimeSamples( filePath, *samples ) ? MakeParameterTimeFunction( samples ) : Groom::ParameterTimeFunctionType();
+	}
+
+private:
+
+	typedef std::pair<IGroomSerializer*, FileDeserializerFunctionType> RegisteredGroomSerializer;
+
+	UniquePtr<Groom::IGraph> DeserializeGroomFromFileWithoutSidecar( std::string_view filePath, double time, IGroomSerializer* serializer,
+		Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const> factories ) const
+	{
+		if( serializer == nullptr )
+		{
+			serializer = FindRegisteredGroomSerializerForFile( filePath );
+		}
+
+		if( serializer != nullptr && serializer->HasGroomExtension( filePath, serializer->GroomFileFormatExtension() ) )
+		{
+			for( auto const& registered : GetRegisteredGroomSerializers() )
+			{
+				if( registered.first == serializer && registered.second != nullptr )
+				{
+					return registered.second( *serializer, filePath, time, factories );
+				}
+			}
+		}
+
+		SerializedGroom const groom;
+		return DeserializeGroom( filePath, groom, time, serializer, factories );
+	}
+
+	//! Reads the time samples of the groom file and its sidecar into samples, returns the groom deserialized at the first time sample or nullptr on failure
+	UniquePtr<Groom::IGraph> LoadTimeSamples( std::string_view filePath, GroomTimeSamples::Samples& samples ) const
+	{
+		GroomInfo info;
+		std::vector<double> fileSampleTimes;
+		if( GetGroomInfoFromFile( filePath, info ) && info.timeSamples.size() > 1 )
+		{
+			fileSampleTimes.assign( info.timeSamples.begin(), info.timeSamples.end() );
+			std::sort( fileSampleTimes.begin(), fileSampleTimes.end() );
+		}
+
+		auto result = DeserializeGroomFromFileWithoutSidecar( filePath, fileSampleTimes.empty() ? TimeUndefined : fileSampleTimes.front(), nullptr,
+			Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>() );
+		if( !result || !Groom::LoadDeferredParameters( *result ) )
+		{
+			return UniquePtr<Groom::IGraph>();
+		}
+
+		for( auto index = 0; index < static_cast<int>( fileSampleTimes.size() ); ++index )
+		{
+			if( index == 0 )
+			{
+				samples.AddFileSample( *result, fileSampleTimes[index] );
+				continue;
+			}
+
+			auto const sample = DeserializeGroomFromFileWithoutSidecar( filePath, fileSampleTimes[index], nullptr,
+				Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>() );
+			if( !sample || !Groom::LoadDeferredParameters( *sample ) )
+			{
+				return UniquePtr<Groom::IGraph>();
+			}
+
+			samples.AddFileSample( *sample, fileSampleTimes[index] );
+		}
+
+		if( !samples.ReadSidecar( GroomTimeSamples::GetSidecarPath( std::string( filePath ) ), *result ) )
+		{
+			return UniquePtr<Groom::IGraph>();
+		}
+
+		return result;
+	}
+
+	static Groom::ParameterTimeFunctionType MakeParameterTimeFunction( std::shared_ptr<GroomTimeSamples::Samples const> const& samples )
+	{
+		if( !samples->IsAnimated() )
+		{
+			return Groom::ParameterTimeFunctionType();
+		}
+
+		return [samples]( Groom::IGraph& graph, double time )
+		{
+			return samples->Apply( graph, time );
+		};
+	}
+
+	static std::vector<RegisteredGroomSerializer>& GetRegisteredGroomSerializers()
+	{
+		static std::vector<RegisteredGroomSerializer> serializers;
+		return serializers;
+	}
 };
 
 struct IHairUtilities
@@ -0,0 +1,176 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/Geometry/Native/TriangleBvh.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Collision meshes of an operator like ResolveCollisions (target collision objects and the distribution mesh) indexed by a TriangleBvh which is kept
+between evaluations. The hierarchy is only rebuilt when the triangles change, when only the vertices of the meshes move it is refitted.
+*/
+class CollisionMeshIndex
+{
+public:
+
+	typedef Geometry::TriangleBvh::Triangle Triangle;
+
+	CollisionMeshIndex()
+	{
+	}
+
+	/*! Makes the index match the current state of the meshes
+	@param meshes Polygon meshes (IPolygonMeshT) to collide with, null entries are skipped
+	@return True if the hierarchy was rebuilt, false if it was refitted
+	*/
+	template <class TMesh>
+	bool Update( TMesh const* const* meshes, int meshCount )
+	{
+		typedef typename TMesh::Vector3 MeshVector;
+
+		std::vector<Geometry::Vector3f> vertices;
+		std::vector<Triangle> triangles;
+		std::vector<MeshVector> meshVertices;
+		for( auto meshIndex = 0; meshIndex < meshCount; ++meshIndex )
+		{
+			if( meshes[meshIndex] == nullptr )
+			{
+				continue;
+			}
+
+			auto const& mesh = *meshes[meshIndex];
+			auto const firstVertex = static_cast<int>( vertices.size() );
+			meshVertices.resize( mesh.GetVertexCount() );
+			if( !meshVertices.empty() )
+			{
+				mesh.GetVertices( 0, static_cast<int>( meshVertices.size() ), meshVertices.data() );
+			}
+
+			for( auto const& vertex : meshVertices )
+			{
+				vertices.push_back( Geometry::Vector3f( static_cast<float>( vertex[0] ), static_cast<float>( vertex[1] ), static_cast<float>( vertex[2] ) ) );
+			}
+
+			auto const firstTriangle = static_cast<int>( triangles.size() );
+			triangles.resize( firstTriangle + mesh.GetTriangleCount() );
+			if( mesh.GetTriangleCount() > 0 )
+			{
+				mesh.GetTriangleVerticesIndices( 0, mesh.GetTriangleCount(), &triangles[firstTriangle] );
+			}
+
+			for( auto index = firstTriangle; index < static_cast<int>( triangles.size() ); ++index )
+			{
+				for( auto corner = 0; corner < 3; ++corner )
+				{
+					triangles[index][corner] += firstVertex;
+				}
+			}
+		}
+
+		return Update( vertices.data(), static_cast<int>( vertices.size() ), triangles.data(), static_cast<int>( triangles.size() ) );
+	}
+
+	//! Same as above with the vertices and triangles of all meshes already combined
+	bool Update( Geometry::Vector3f const* vertices, int vertexCount, Triangle const* triangles, int triangleCount )
+	{
+		if( triangleCount == static_cast<int>( triangles_.size() ) && std::equal( triangles, triangles + triangleCount, triangles_.begin() )
+			&& bvh_.Refit( vertices, vertexCount ) )
+		{
+			return false;
+		}
+
+		triangles_.assign( triangles, triangles + triangleCount );
+		bvh_.Build( vertices, vertexCount, triangles, triangleCount );
+		return true;
+	}
+
+	EPHERE_NODISCARD Geometry::TriangleBvh const& GetBvh() const
+	{
+		return bvh_;
+	}
+
+private:
+
+	Geometry::TriangleBvh bvh_;
+	std::vector<Triangle> triangles_;
+};
+
+/*! Angle between the coarse tests of FindCollisionFreeAngle() when none is given: 8 steps, but at most a 16th of the maximum angle and at least one step.
+This bounds the tests to about maximumAngle / ( 8 * step ) + 3 instead of maximumAngle / step, while only collision free gaps narrower than 8 steps can
+be skipped.
+*/
+inline float GetDefaultCollisionCoarseStep( float maximumAngle, float step )
+{
+	return std::max( step, std::min( 8 * step, maximumAngle / 16 ) );
+}
+
+/*! Finds the smallest rotation of a strand which makes it free of collisions, as ResolveCollisions does when rotating colliding strands.
+
+Angles are tested coarseStep apart until one is collision free, then the interval before it is bisected until it is smaller than step. This takes
+maximumAngle / coarseStep + log2( coarseStep / step ) tests, but collision free gaps narrower than coarseStep may be skipped. Passing step as coarseStep
+tests every multiple of step up to the maximum angle like ResolveCollisions does, a larger one should be at most about the smallest angle over which the
+collision meshes can block a strand and then free it again. Each test checks all segments of the strand with a single traversal of the hierarchy.
+@param getPoints Called as void( float angle, Geometry::Vector3f* points ) to get the pointCount points of the strand rotated by angle, for example as in
+the Stiff, Bend or Soft resolve modes
+@param coarseStep Angle between the tests before bisecting, 0 to use GetDefaultCollisionCoarseStep()
+@return The smallest collision free angle found, at most step larger than the exact one. 0 if the strand doesn't collide, -1 if no tested angle up to
+maximumAngle is collision free.
+*/
+template <class TFunction>
+float FindCollisionFreeAngle( Geometry::TriangleBvh const& colliders, int pointCount, TFunction getPoints, float maximumAngle, float step,
+	float coarseStep = 0 )
+{
+	std::vector<Geometry::Vector3f> points( pointCount );
+	auto const isColliding = [&]( float angle )
+	{
+		getPoints( angle, points.data() );
+		return colliders.FindFirstIntersectingSegment( points.data(), pointCount ) >= 0;
+	};
+
+	if( !isColliding( 0 ) )
+	{
+		return 0;
+	}
+
+	step = std::max( step, 1e-6f );
+	coarseStep = std::max( coarseStep > 0 ? coarseStep : GetDefaultCollisionCoarseStep( maximumAngle, step ), step );
+	auto colliding = 0.0f;
+	auto free = -1.0f;
+	while( colliding < maximumAngle )
+	{
+		auto const angle = std::min( colliding + coarseStep, maximumAngle );
+		if( !isColliding( angle ) )
+		{
+			free = angle;
+			break;
+		}
+
+		colliding = angle;
+	}
+
+	if( free < 0 )
+	{
+		return -1;
+	}
+
+	while( free - colliding > step )
+	{
+		auto const middle = ( colliding + free ) / 2;
+		if( isColliding( middle ) )
+		{
+			colliding = middle;
+		}
+		else
+		{
+			free = middle;
+		}
+	}
+
+	return free;
+}
+
+} }
@@ -0,0 +1,693 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/Geometry/Native/Matrix.h"
+#include "Ephere/NativeTools/MacroTools.h"
+#include "Ephere/Ornatrix/GuideDependency.h"
+#include "Ephere/Ornatrix/Operators/HairFromGuidesParameters.g.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined( EPHERE_HAVE_SSE2 )
+#	include <emmintrin.h>
+#endif
+
+#if defined( EPHERE_HAVE_AVX2 )
+#	include <immintrin.h>
+#	if defined( _MSC_VER ) && !defined( __clang__ )
+#		include <intrin.h>
+#	endif
+#endif
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Interpolation of generated strands from their guides, many strands at a time, for the methods of HairFromGuidesParameters::InterpolationMethod.
+
+Strands are gathered into a Batch, which stores the points of their guides, the guide weights and the strand transforms in structure of arrays form:
+every value is followed by the same value of the other strands. The interpolation then runs over all strands of the batch with SIMD registers as wide
+as the processor supports, and the results are read back per strand. SSE2 is used by every x64 build, AVX2 if the target enables it, or with Visual C++,
+GCC 4.9 and Clang if the processor supports it. Other builds use the scalar code.
+
+Guide points are given in the space of the strand root (root at the origin), resampled to the point count of the batch. For every point:
+	Affine: the points of the guides are blended by weight.
+	Polar: the directions of the points from the root and their distances to it are blended separately, so strands don't shrink between diverging guides.
+	Segment: the directions and lengths of the segments ending at the point are blended separately and the segments are chained from the root.
+The result is transformed by the strand to object transform. All instruction sets perform the same operations in the same order. Compilers may still fuse
+multiplications and additions differently for each of them (e.g. GCC with its default -ffp-contract=fast on targets with FMA), so results of different
+instruction sets can differ by rounding.
+*/
+namespace StrandInterpolation
+{
+
+typedef HairFromGuidesParameters::InterpolationMethodType Method;
+
+enum class InstructionSet
+{
+	Scalar,
+	Sse2,
+	Avx2
+};
+
+class Batch
+{
+public:
+
+	//! Strands in a batch, a multiple of the width of all instruction sets
+	enum
+	{
+		LaneCount = 16
+	};
+
+	explicit Batch( int pointCount, int guideCount = MaxGuideInterpolationCount )
+		: pointCount_( pointCount ),
+		guideCount_( guideCount ),
+		laneCount_( 0 ),
+		guidePoints_( guideCount * pointCount * 3 * LaneCount ),
+		weights_( guideCount * LaneCount ),
+		transforms_( 12 * LaneCount ),
+		result_( pointCount * 3 * LaneCount )
+	{
+	}
+
+	EPHERE_NODISCARD int GetPointCount() const
+	{
+		return pointCount_;
+	}
+
+	EPHERE_NODISCARD int GetGuideCount() const
+	{
+		return guideCount_;
+	}
+
+	EPHERE_NODISCARD int GetLaneCount() const
+	{
+		return laneCount_;
+	}
+
+	EPHERE_NODISCARD bool IsFull() const
+	{
+		return laneCount_ == LaneCount;
+	}
+
+	//! Removes all strands, unused lanes get zero weights so they compute zeros
+	void Clear()
+	{
+		laneCount_ = 0;
+		std::fill( weights_.begin(), weights_.end(), 0.0f );
+	}
+
+	/*! Adds a generated strand to the next free lane
+	@param strandToObject Transform from the space of the strand root to object space
+	@param guidePoints GetPointCount() points of each guide in the space of the strand root, null for unused guides
+	@param weights Weight of each guide, usually adding up to 1, unused guides need a weight of 0
+	@return Lane of the strand, or -1 if the batch is full
+	*/
+	int Add( Geometry::Xform3f const& strandToObject, Geometry::Vector3f const* const* guidePoints, float const* weights )
+	{
+		if( IsFull() )
+		{
+			return -1;
+		}
+
+		auto const lane = laneCount_++;
+		for( auto guide = 0; guide < guideCount_; ++guide )
+		{
+			weights_[guide * LaneCount + lane] = weights[guide];
+			for( auto point = 0; point < pointCount_; ++point )
+			{
+				for( auto axis = 0; axis < 3; ++axis )
+				{
+					guidePoints_[GetComponentIndex( guide, point, axis ) + lane] = guidePoints[guide] != nullptr ? guidePoints[guide][point][axis] : 0.0f;
+				}
+			}
+		}
+
+		for( auto row = 0u; row < 3; ++row )
+		{
+			for( auto column = 0u; column < 4; ++column )
+			{
+				transforms_[( row * 4 + column ) * LaneCount + lane] = strandToObject( row, column );
+			}
+		}
+
+		return lane;
+	}
+
+	//! Copies the GetPointCount() interpolated points of a strand, in object space
+	void GetResult( int lane, Geometry::Vector3f* points ) const
+	{
+		for( auto point = 0; point < pointCount_; ++point )
+		{
+			for( auto axis = 0; axis < 3; ++axis )
+			{
+				points[point][axis] = result_[( point * 3 + axis ) * LaneCount + lane];
+			}
+		}
+	}
+
+	//! LaneCount values of a component of a guide point
+	EPHERE_NODISCARD float const* GetGuideComponents( int guide, int point, int axis ) const
+	{
+		return guidePoints_.data() + GetComponentIndex( guide, point, axis );
+	}
+
+	EPHERE_NODISCARD float const* GetWeights( int guide ) const
+	{
+		return weights_.data() + guide * LaneCount;
+	}
+
+	//! LaneCount values of an element of the strand transforms, element is row * 4 + column
+	EPHERE_NODISCARD float const* GetTransformElements( int element ) const
+	{
+		return transforms_.data() + element * LaneCount;
+	}
+
+	float* GetResultComponents( int point, int axis )
+	{
+		return result_.data() + ( point * 3 + axis ) * LaneCount;
+	}
+
+private:
+
+	int GetComponentIndex( int guide, int point, int axis ) const
+	{
+		return ( ( guide * pointCount_ + point ) * 3 + axis ) * LaneCount;
+	}
+
+	int pointCount_;
+	int guideCount_;
+	int laneCount_;
+
+	std::vector<float> guidePoints_;
+	std::vector<float> weights_;
+	std::vector<float> transforms_;
+	std::vector<float> result_;
+};
+
+namespace Detail
+{
+
+struct ScalarPack
+{
+	typedef float Type;
+
+	enum
+	{
+		Width = 1
+	};
+
+	static Type Load( float const* values )
+	{
+		return *values;
+	}
+
+	static void Store( float* values, Type value )
+	{
+		*values = value;
+	}
+
+	static Type Set( float value )
+	{
+		return value;
+	}
+
+	static Type Add( Type left, Type right )
+	{
+		return left + right;
+	}
+
+	static Type Subtract( Type left, Type right )
+	{
+		return left - right;
+	}
+
+	static Type Multiply( Type left, Type right )
+	{
+		return left * right;
+	}
+
+	static Type Divide( Type left, Type right )
+	{
+		return left / right;
+	}
+
+	static Type Max( Type left, Type right )
+	{
+		return std::max( left, right );
+	}
+
+	static Type Sqrt( Type value )
+	{
+		return std::sqrt( value );
+	}
+};
+
+#if defined( EPHERE_HAVE_SSE2 )
+struct Sse2Pack
+{
+	typedef __m128 Type;
+
+	enum
+	{
+		Width = 4
+	};
+
+	static Type Load( float const* values )
+	{
+		return _mm_loadu_ps( values );
+	}
+
+	static void Store( float* values, Type value )
+	{
+		_mm_storeu_ps( values, value );
+	}
+
+	static Type Set( float value )
+	{
+		return _mm_set1_ps( value );
+	}
+
+	static Type Add( Type left, Type right )
+	{
+		return _mm_add_ps( left, right );
+	}
+
+	static Type Subtract( Type left, Type right )
+	{
+		return _mm_sub_ps( left, right );
+	}
+
+	static Type Multiply( Type left, Type right )
+	{
+		return _mm_mul_ps( left, right );
+	}
+
+	static Type Divide( Type left, Type right )
+	{
+		return _mm_div_ps( left, right );
+	}
+
+	static Type Max( Type left, Type right )
+	{
+		return _mm_max_ps( left, right );
+	}
+
+	static Type Sqrt( Type value )
+	{
+		return _mm_sqrt_ps( value );
+	}
+};
+#endif
+
+#if defined( EPHERE_HAVE_AVX2 )
+struct Avx2Pack
+{
+	typedef __m256 Type;
+
+	enum
+	{
+		Width = 8
+	};
+
+	EPHERE_AVX2_FUNCTION static Type Load( float const* values )
+	{
+		return _mm256_loadu_ps( values );
+	}
+
+	EPHERE_AVX2_FUNCTION static void Store( float* values, Type value )
+	{
+		_mm256_storeu_ps( values, value );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Set( float value )
+	{
+		return _mm256_set1_ps( value );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Add( Type left, Type right )
+	{
+		return _mm256_add_ps( left, right );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Subtract( Type left, Type right )
+	{
+		return _mm256_sub_ps( left, right );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Multiply( Type left, Type right )
+	{
+		return _mm256_mul_ps( left, right );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Divide( Type left, Type right )
+	{
+		return _mm256_div_ps( left, right );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Max( Type left, Type right )
+	{
+		return _mm256_max_ps( left, right );
+	}
+
+	EPHERE_AVX2_FUNCTION static Type Sqrt( Type value )
+	{
+		return _mm256_sqrt_ps( value );
+	}
+};
+
+inline bool IsAvx2Supported()
+{
+#	if defined( _MSC_VER ) && !defined( __clang__ )
+	// AVX2 needs the processor feature and the operating system saving the AVX registers
+	int info[4];
+	__cpuid( info, 0 );
+	if( info[0] < 7 )
+	{
+		return false;
+	}
+
+	__cpuid( info, 1 );
+	auto const osxsave = ( info[2] & ( 1 << 27 ) ) != 0;
+	auto const avx = ( info[2] & ( 1 << 28 ) ) != 0;
+	if( !osxsave || !avx || ( _xgetbv( 0 ) & 6 ) != 6 )
+	{
+		return false;
+	}
+
+	__cpuidex( info, 7, 0 );
+	return ( info[1] & ( 1 << 5 ) ) != 0;
+#	elif !defined( __AVX2__ )
+	// Checks the processor feature and the operating system saving the AVX registers
+	__builtin_cpu_init();
+	return __builtin_cpu_supports( "avx2" ) != 0;
+#	else
+	// The whole target requires AVX2
+	return true;
+#	endif
+}
+#endif
+
+// Values of a run of lanes of a batch
+struct BatchLanes
+{
+	BatchLanes( Batch& batch, int lane )
+		: batch( batch ),
+		lane( lane )
+	{
+	}
+
+	EPHERE_NODISCARD int GetGuideCount() const
+	{
+		return batch.GetGuideCount();
+	}
+
+	EPHERE_NODISCARD float const* GetGuideComponent( int guide, int point, int axis ) const
+	{
+		return batch.GetGuideComponents( guide, point, axis ) + lane;
+	}
+
+	EPHERE_NODISCARD float const* GetWeight( int guide ) const
+	{
+		return batch.GetWeights( guide ) + lane;
+	}
+
+	EPHERE_NODISCARD float const* GetTransformElement( int element ) const
+	{
+		return batch.GetTransformElements( element ) + lane;
+	}
+
+	EPHERE_NODISCARD float* GetResultComponent( int point, int axis ) const
+	{
+		return batch.GetResultComponents( point, axis ) + lane;
+	}
+
+	Batch& batch;
+	int lane;
+};
+
+// Values of a single strand, the points before firstPointIndex are computed but not stored
+struct StrandLane
+{
+	StrandLane( Geometry::Xform3f const& strandToObject, Geometry::Vector3f const* const* guidePoints, float const* weights, int guideCount,
+		int firstPointIndex, Geometry::Vector3f* result )
+		: guidePoints( guidePoints ),
+		weights( weights ),
+		guideCount( guideCount ),
+		firstPointIndex( firstPointIndex ),
+		result( result ),
+		zero( 0.0f ),
+		discarded( 0.0f )
+	{
+		for( auto row = 0u; row < 3; ++row )
+		{
+			for( auto column = 0u; column < 4; ++column )
+			{
+				transform[row * 4 + column] = strandToObject( row, column );
+			}
+		}
+	}
+
+	EPHERE_NODISCARD int GetGuideCount() const
+	{
+		return guideCount;
+	}
+
+	EPHERE_NODISCARD float const* GetGuideComponent( int guide, int point, int axis ) const
+	{
+		return guidePoints[guide] != nullptr ? reinterpret_cast<float const*>( guidePoints[guide] + point ) + axis : &zero;
+	}
+
+	EPHERE_NODISCARD float const* GetWeight( int guide ) const
+	{
+		return weights + guide;
+	}
+
+	EPHERE_NODISCARD float const* GetTransformElement( int element ) const
+	{
+		return transform + element;
+	}
+
+	float* GetResultComponent( int point, int axis )
+	{
+		return point >= firstPointIndex ? &result[point - firstPointIndex][axis] : &discarded;
+	}
+
+	Geometry::Vector3f const* const* guidePoints;
+	float const* weights;
+	int guideCount;
+	int firstPointIndex;
+	Geometry::Vector3f* result;
+	float transform[12];
+	float zero;
+	float discarded;
+};
+
+#if defined( __GNUC__ ) && !defined( __clang__ )
+#	pragma GCC diagnostic push
+// The AVX2 kernel is only compiled inlined into RunAvx2(), its AVX vectors are never passed to functions built without AVX
+#	pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// Always inlined, so that the kernel is compiled for the instruction set of the function running it
+template <class Pack>
+struct Kernel
+{
+	typedef typename Pack::Type Type;
+
+	struct Vector
+	{
+		Type x, y, z;
+	};
+
+	EPHERE_FORCE_INLINE static void Run( Method method, Batch& batch )
+	{
+		for( auto lane = 0; lane < batch.GetLaneCount(); lane += Pack::Width )
+		{
+			BatchLanes lanes( batch, lane );
+			RunLanes( method, batch.GetPointCount(), lanes );
+		}
+	}
+
+	template <class Lanes>
+	EPHERE_FORCE_INLINE static void RunLanes( Method method, int pointCount, Lanes& lanes )
+	{
+		auto const guideCount = std::min( lanes.GetGuideCount(), static_cast<int>( MaxGuideInterpolationCount ) );
+		Type weights[MaxGuideInterpolationCount];
+		for( auto guide = 0; guide < guideCount; ++guide )
+		{
+			weights[guide] = Pack::Load( lanes.GetWeight( guide ) );
+		}
+
+		Type transform[12];
+		for( auto element = 0; element < 12; ++element )
+		{
+			transform[element] = Pack::Load( lanes.GetTransformElement( element ) );
+		}
+
+		Vector const zero = { Pack::Set( 0 ), Pack::Set( 0 ), Pack::Set( 0 ) };
+		Vector points[MaxGuideInterpolationCount] = { zero, zero, zero };
+		Vector previousPoints[MaxGuideInterpolationCount];
+		Vector segments[MaxGuideInterpolationCount];
+		auto position = zero;
+		for( auto point = 0; point < pointCount; ++point )
+		{
+			for( auto guide = 0; guide < guideCount; ++guide )
+			{
+				previousPoints[guide] = points[guide];
+				points[guide].x = Pack::Load( lanes.GetGuideComponent( guide, point, 0 ) );
+				points[guide].y = Pack::Load( lanes.GetGuideComponent( guide, point, 1 ) );
+				points[guide].z = Pack::Load( lanes.GetGuideComponent( guide, point, 2 ) );
+			}
+
+			if( method == Method::Polar )
+			{
+				BlendDirections( points, weights, guideCount, position );
+			}
+			else if( method == Method::Segment && point > 0 )
+			{
+				for( auto guide = 0; guide < guideCount; ++guide )
+				{
+					segments[guide].x = Pack::Subtract( points[guide].x, previousPoints[guide].x );
+					segments[guide].y = Pack::Subtract( points[guide].y, previousPoints[guide].y );
+					segments[guide].z = Pack::Subtract( points[guide].z, previousPoints[guide].z );
+				}
+
+				Vector segment;
+				BlendDirections( segments, weights, guideCount, segment );
+				position.x = Pack::Add( position.x, segment.x );
+				position.y = Pack::Add( position.y, segment.y );
+				position.z = Pack::Add( position.z, segment.z );
+			}
+			else
+			{
+				// Affine, and the roots of the segment method
+				Blend( points, weights, guideCount, position );
+			}
+
+			for( auto row = 0; row < 3; ++row )
+			{
+				auto const* const rowElements = transform + row * 4;
+				auto const value = Pack::Add( Pack::Add( Pack::Add( Pack::Multiply( rowElements[0], position.x ), Pack::Multiply( rowElements[1], position.y ) ),
+					Pack::Multiply( rowElements[2], position.z ) ), rowElements[3] );
+				Pack::Store( lanes.GetResultComponent( point, row ), value );
+			}
+		}
+	}
+
+private:
+
+	EPHERE_FORCE_INLINE static void Blend( Vector const* vectors, Type const* weights, int count, Vector& result )
+	{
+		result.x = result.y = result.z = Pack::Set( 0 );
+		for( auto index = 0; index < count; ++index )
+		{
+			result.x = Pack::Add( result.x, Pack::Multiply( weights[index], vectors[index].x ) );
+			result.y = Pack::Add( result.y, Pack::Multiply( weights[index], vectors[index].y ) );
+			result.z = Pack::Add( result.z, Pack::Multiply( weights[index], vectors[index].z ) );
+		}
+	}
+
+	EPHERE_FORCE_INLINE static void GetLength( Vector const& vector, Type& result )
+	{
+		result = Pack::Sqrt( Pack::Add( Pack::Add( Pack::Multiply( vector.x, vector.x ), Pack::Multiply( vector.y, vector.y ) ),
+			Pack::Multiply( vector.z, vector.z ) ) );
+	}
+
+	// Blends the directions and the lengths of the vectors separately, zero vectors only contribute their length
+	EPHERE_FORCE_INLINE static void BlendDirections( Vector const* vectors, Type const* weights, int count, Vector& result )
+	{
+		auto const tiny = Pack::Set( 1e-30f );
+		auto& directions = result;
+		directions.x = directions.y = directions.z = Pack::Set( 0 );
+		auto length = Pack::Set( 0 );
+		for( auto index = 0; index < count; ++index )
+		{
+			Type vectorLength;
+			GetLength( vectors[index], vectorLength );
+			auto const scale = Pack::Divide( weights[index], Pack::Max( vectorLength, tiny ) );
+			directions.x = Pack::Add( directions.x, Pack::Multiply( scale, vectors[index].x ) );
+			directions.y = Pack::Add( directions.y, Pack::Multiply( scale, vectors[index].y ) );
+			directions.z = Pack::Add( directions.z, Pack::Multiply( scale, vectors[index].z ) );
+			length = Pack::Add( length, Pack::Multiply( weights[index], vectorLength ) );
+		}
+
+		Type directionsLength;
+		GetLength( directions, directionsLength );
+		auto const scale = Pack::Divide( length, Pack::Max( directionsLength, tiny ) );
+		directions.x = Pack::Multiply( directions.x, scale );
+		directions.y = Pack::Multiply( directions.y, scale );
+		directions.z = Pack::Multiply( directions.z, scale );
+	}
+};
+
+#if defined( __GNUC__ ) && !defined( __clang__ )
+#	pragma GCC diagnostic pop
+#endif
+
+#if defined( EPHERE_HAVE_AVX2 )
+EPHERE_AVX2_FUNCTION inline void RunAvx2( Method method, Batch& batch )
+{
+	Kernel<Avx2Pack>::Run( method, batch );
+}
+#endif
+
+}
+
+//! Best instruction set supported by both the build and the processor, detected once
+inline InstructionSet GetSupportedInstructionSet()
+{
+#if defined( EPHERE_HAVE_AVX2 )
+	static auto const isAvx2Supported = Detail::IsAvx2Supported();
+	if( isAvx2Supported )
+	{
+		return InstructionSet::Avx2;
+	}
+#endif
+
+#if defined( EPHERE_HAVE_SSE2 )
+	return InstructionSet::Sse2;
+#else
+	return InstructionSet::Scalar;
+#endif
+}
+
+/*! Interpolates all strands of a batch, their points are read with Batch::GetResult()
+@param instructionSet Instruction set to use, falls back to a narrower one if not available in the build. Use the default unless the processor is known.
+*/
+inline void Interpolate( Method method, Batch& batch, InstructionSet instructionSet = GetSupportedInstructionSet() )
+{
+	switch( instructionSet )
+	{
+		case InstructionSet::Avx2:
+#if defined( EPHERE_HAVE_AVX2 )
+			Detail::RunAvx2( method, batch );
+			return;
+#endif
+		case InstructionSet::Sse2:
+#if defined( EPHERE_HAVE_SSE2 )
+			Detail::Kernel<Detail::Sse2Pack>::Run( method, batch );
+			return;
+#endif
+		case InstructionSet::Scalar:
+			Detail::Kernel<Detail::ScalarPack>::Run( method, batch );
+	}
+}
+
+/*! Interpolates a single strand without a Batch, with the same results as Interpolate() with the scalar instruction set. Cheaper for consumers which need one strand at a time.
+@param strandToObject, guidePoints, weights Same as for Batch::Add(), the guides need firstPointIndex + pointCount points
+@param result Receives pointCount points starting at firstPointIndex, in object space
+*/
+inline void InterpolateStrand( Method method, Geometry::Xform3f const& strandToObject, Geometry::Vector3f const* const* guidePoints, float const* weights,
+	int firstPointIndex, int pointCount, Geometry::Vector3f* result, int guideCount = MaxGuideInterpolationCount )
+{
+	Detail::StrandLane lane( strandToObject, guidePoints, weights, guideCount, firstPointIndex, result );
+	Detail::Kernel<Detail::ScalarPack>::RunLanes( method, firstPointIndex + pointCount, lane );
+}
+
+}
+
+} }
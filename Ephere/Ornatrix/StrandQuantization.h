@@ -0,0 +1,309 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/Geometry/Native/Matrix.h"
+#include "Ephere/NativeTools/MacroTools.h"
+#include "Ephere/NativeTools/Span.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined( EPHERE_HAVE_SSE2 )
+#	include <emmintrin.h>
+#endif
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Lossy 16-bit encoding of strand vertices and widths, for baked hair whose size is dominated by full precision vertices.
+
+The root of each strand is kept exactly. The other points are stored relative to their root, quantized to 16 bits per component inside the bounding box
+of these offsets over all strands encoded together (a block), so the error of a component is at most 1/131070 of the extent of that box, which is at most
+twice the extent of the largest strand. Widths are quantized the same way within the range of the widths of the block. Since the ranges are shared,
+a strand only adds its root to the quantized values. Strands of 10 points take 55% of the size of the floats, and the encoding compresses better, since
+the deltas of neighboring points are similar.
+
+Layout, in native byte order:
+	Block, if any strand has points: offset and step of the point components (3 floats each), offset and step of the widths if present (2 floats)
+	Per strand with at least one point: root (3 floats), quantized components of the points after the root (3 uint16 each), quantized widths of all
+	points if present (uint16 each)
+A point component is decoded as root + offset + quantized * step, a width as offset + quantized * step. Decoding converts 4 points at a time with SSE2
+where available.
+*/
+namespace StrandQuantization
+{
+
+enum
+{
+	MaxQuantizedValue = 65535
+};
+
+namespace Detail
+{
+
+inline std::size_t GetBlockHeaderSize( bool hasWidths )
+{
+	return ( 6 + ( hasWidths ? 2 : 0 ) ) * sizeof( float );
+}
+
+inline std::size_t GetStrandEncodedSize( int pointCount, bool hasWidths )
+{
+	if( pointCount <= 0 )
+	{
+		return 0;
+	}
+
+	return 3 * sizeof( float ) + ( pointCount - 1 ) * 3 * sizeof( std::uint16_t ) + ( hasWidths ? pointCount * sizeof( std::uint16_t ) : 0 );
+}
+
+inline void Append( std::string& result, void const* data, std::size_t size )
+{
+	result.append( static_cast<char const*>( data ), size );
+}
+
+inline std::uint16_t Quantize( float value, float minimum, float step )
+{
+	if( step <= 0 )
+	{
+		return 0;
+	}
+
+	auto const quantized = std::floor( ( value - minimum ) / step + 0.5f );
+	return static_cast<std::uint16_t>( std::min( std::max( quantized, 0.0f ), static_cast<float>( MaxQuantizedValue ) ) );
+}
+
+}
+
+//! Size of the encoding of strands with the given point counts
+inline std::size_t GetEncodedSize( Span<int const> strandPointCounts, bool hasWidths )
+{
+	std::size_t result = 0;
+	for( auto index = 0; index < strandPointCounts.size(); ++index )
+	{
+		result += Detail::GetStrandEncodedSize( strandPointCounts[index], hasWidths );
+	}
+
+	return result > 0 ? result + Detail::GetBlockHeaderSize( hasWidths ) : 0;
+}
+
+//! Decodes count values, result[i] = offset + values[i] * step
+inline void Dequantize( std::uint16_t const* values, int count, float offset, float step, float* result )
+{
+	auto index = 0;
+#if defined( EPHERE_HAVE_SSE2 )
+	auto const zero = _mm_setzero_si128();
+	auto const offsets = _mm_set1_ps( offset );
+	auto const steps = _mm_set1_ps( step );
+	for( ; index + 8 <= count; index += 8 )
+	{
+		auto const quantized = _mm_loadu_si128( reinterpret_cast<__m128i const*>( values + index ) );
+		auto const low = _mm_cvtepi32_ps( _mm_unpacklo_epi16( quantized, zero ) );
+		auto const high = _mm_cvtepi32_ps( _mm_unpackhi_epi16( quantized, zero ) );
+		_mm_storeu_ps( result + index, _mm_add_ps( offsets, _mm_mul_ps( low, steps ) ) );
+		_mm_storeu_ps( result + index + 4, _mm_add_ps( offsets, _mm_mul_ps( high, steps ) ) );
+	}
+#endif
+
+	for( ; index < count; ++index )
+	{
+		result[index] = offset + values[index] * step;
+	}
+}
+
+//! Decodes count vectors of 3 components, each with its own offset and step
+inline void DequantizeVectors( std::uint16_t const* values, int count, float const* offset, float const* step, Geometry::Vector3f* result )
+{
+	auto* const output = reinterpret_cast<float*>( result );
+	auto index = 0;
+#if defined( EPHERE_HAVE_SSE2 )
+	// 4 vectors are 12 components, covered by 3 registers whose lanes repeat x, y, z
+	auto const zero = _mm_setzero_si128();
+	auto const offsets0 = _mm_setr_ps( offset[0], offset[1], offset[2], offset[0] );
+	auto const offsets1 = _mm_setr_ps( offset[1], offset[2], offset[0], offset[1] );
+	auto const offsets2 = _mm_setr_ps( offset[2], offset[0], offset[1], offset[2] );
+	auto const steps0 = _mm_setr_ps( step[0], step[1], step[2], step[0] );
+	auto const steps1 = _mm_setr_ps( step[1], step[2], step[0], step[1] );
+	auto const steps2 = _mm_setr_ps( step[2], step[0], step[1], step[2] );
+	for( ; index + 4 <= count; index += 4 )
+	{
+		auto const* const input = values + 3 * index;
+		auto const first = _mm_loadu_si128( reinterpret_cast<__m128i const*>( input ) );
+		auto const last = _mm_loadl_epi64( reinterpret_cast<__m128i const*>( input + 8 ) );
+		auto const components0 = _mm_cvtepi32_ps( _mm_unpacklo_epi16( first, zero ) );
+		auto const components1 = _mm_cvtepi32_ps( _mm_unpackhi_epi16( first, zero ) );
+		auto const components2 = _mm_cvtepi32_ps( _mm_unpacklo_epi16( last, zero ) );
+		_mm_storeu_ps( output + 3 * index, _mm_add_ps( offsets0, _mm_mul_ps( components0, steps0 ) ) );
+		_mm_storeu_ps( output + 3 * index + 4, _mm_add_ps( offsets1, _mm_mul_ps( components1, steps1 ) ) );
+		_mm_storeu_ps( output + 3 * index + 8, _mm_add_ps( offsets2, _mm_mul_ps( components2, steps2 ) ) );
+	}
+#endif
+
+	for( ; index < count; ++index )
+	{
+		for( auto component = 0; component < 3; ++component )
+		{
+			output[3 * index + component] = offset[component] + values[3 * index + component] * step[component];
+		}
+	}
+}
+
+/*! Appends the encoding of strands to result, as one block
+@param widths Width of every vertex, or null to leave the widths out
+*/
+inline void Encode( Span<int const> strandPointCounts, Geometry::Vector3f const* vertices, float const* widths, std::string& result )
+{
+	auto const encodedSize = GetEncodedSize( strandPointCounts, widths != nullptr );
+	if( encodedSize == 0 )
+	{
+		return;
+	}
+
+	result.reserve( result.size() + encodedSize );
+
+	// Ranges of the offsets of the points from their roots, and of the widths, over all strands
+	float minimum[3] = { 0, 0, 0 }, maximum[3] = { 0, 0, 0 };
+	float widthMinimum = 0, widthMaximum = 0;
+	auto hasDeltas = false, hasWidthRange = false;
+	auto const* strandVertices = vertices;
+	auto const* strandWidths = widths;
+	for( auto strand = 0; strand < strandPointCounts.size(); ++strand )
+	{
+		auto const pointCount = std::max( strandPointCounts[strand], 0 );
+		for( auto point = 1; point < pointCount; ++point, hasDeltas = true )
+		{
+			for( auto component = 0; component < 3; ++component )
+			{
+				auto const delta = strandVertices[point][component] - strandVertices[0][component];
+				minimum[component] = hasDeltas ? std::min( minimum[component], delta ) : delta;
+				maximum[component] = hasDeltas ? std::max( maximum[component], delta ) : delta;
+			}
+		}
+
+		if( widths != nullptr && pointCount > 0 )
+		{
+			auto const range = std::minmax_element( strandWidths, strandWidths + pointCount );
+			widthMinimum = hasWidthRange ? std::min( widthMinimum, *range.first ) : *range.first;
+			widthMaximum = hasWidthRange ? std::max( widthMaximum, *range.second ) : *range.second;
+			hasWidthRange = true;
+			strandWidths += pointCount;
+		}
+
+		strandVertices += pointCount;
+	}
+
+	float step[3];
+	for( auto component = 0; component < 3; ++component )
+	{
+		step[component] = ( maximum[component] - minimum[component] ) / MaxQuantizedValue;
+	}
+
+	Detail::Append( result, minimum, sizeof( minimum ) );
+	Detail::Append( result, step, sizeof( step ) );
+
+	auto const widthStep = ( widthMaximum - widthMinimum ) / MaxQuantizedValue;
+	if( widths != nullptr )
+	{
+		Detail::Append( result, &widthMinimum, sizeof( float ) );
+		Detail::Append( result, &widthStep, sizeof( float ) );
+	}
+
+	std::uint16_t quantized[3];
+	for( auto strand = 0; strand < strandPointCounts.size(); ++strand )
+	{
+		auto const pointCount = strandPointCounts[strand];
+		if( pointCount <= 0 )
+		{
+			continue;
+		}
+
+		auto const& root = vertices[0];
+		Detail::Append( result, &root, 3 * sizeof( float ) );
+		for( auto point = 1; point < pointCount; ++point )
+		{
+			for( auto component = 0; component < 3; ++component )
+			{
+				quantized[component] = Detail::Quantize( vertices[point][component] - root[component], minimum[component], step[component] );
+			}
+
+			Detail::Append( result, quantized, sizeof( quantized ) );
+		}
+
+		if( widths != nullptr )
+		{
+			for( auto point = 0; point < pointCount; ++point )
+			{
+				quantized[0] = Detail::Quantize( widths[point], widthMinimum, widthStep );
+				Detail::Append( result, quantized, sizeof( std::uint16_t ) );
+			}
+
+			widths += pointCount;
+		}
+
+		vertices += pointCount;
+	}
+}
+
+/*! Decodes strands encoded by Encode()
+@param widths Receives the widths if not null, the encoding must include them then
+@return False if the size of the data doesn't match the point counts
+*/
+inline bool Decode( Span<int const> strandPointCounts, char const* data, std::size_t size, bool hasWidths, Geometry::Vector3f* vertices, float* widths )
+{
+	if( size != GetEncodedSize( strandPointCounts, hasWidths ) || ( widths != nullptr && !hasWidths ) )
+	{
+		return false;
+	}
+
+	if( size == 0 )
+	{
+		return true;
+	}
+
+	// Offsets and steps of the point components, then of the widths
+	float block[8];
+	auto const blockHeaderSize = Detail::GetBlockHeaderSize( hasWidths );
+	std::memcpy( block, data, blockHeaderSize );
+	data += blockHeaderSize;
+
+	// Quantized values are copied out since the encoding doesn't keep them aligned
+	std::vector<std::uint16_t> quantized;
+	for( auto strand = 0; strand < strandPointCounts.size(); ++strand )
+	{
+		auto const pointCount = strandPointCounts[strand];
+		if( pointCount <= 0 )
+		{
+			continue;
+		}
+
+		float root[3];
+		std::memcpy( root, data, sizeof( root ) );
+		data += sizeof( root );
+
+		auto const quantizedCount = ( pointCount - 1 ) * 3 + ( hasWidths ? pointCount : 0 );
+		quantized.resize( quantizedCount );
+		std::memcpy( quantized.data(), data, quantizedCount * sizeof( std::uint16_t ) );
+		data += quantizedCount * sizeof( std::uint16_t );
+
+		float const offset[3] = { root[0] + block[0], root[1] + block[1], root[2] + block[2] };
+		vertices[0] = Geometry::Vector3f( root[0], root[1], root[2] );
+		DequantizeVectors( quantized.data(), pointCount - 1, offset, block + 3, vertices + 1 );
+		vertices += pointCount;
+
+		if( widths != nullptr )
+		{
+			Dequantize( quantized.data() + ( pointCount - 1 ) * 3, pointCount, block[6], block[7], widths );
+			widths += pointCount;
+		}
+	}
+
+	return true;
+}
+
+}
+
+} }
@@ -0,0 +1,109 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/NativeTools/MacroTools.h"
+#include "Ephere/NativeTools/Philox.h"
+#include "Ephere/Ornatrix/Types.h"
+
+#include <cstdint>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Random numbers of one strand, for operators with a RandomSeed parameter.
+
+The numbers depend only on the seed, the id of the strand, a stream and their position in the sequence of the strand. They are computed with Philox4x32,
+with the seed and stream as the key and the strand id and position as the counter. Strands therefore get the same numbers whichever thread processes
+them and in whichever order, so operators can split their strands into any parallel ranges and still give the same result on every machine.
+
+Strands should be identified by their StrandId rather than their index, so that their numbers don't change when other strands are added or removed.
+Different random properties of a strand computed by the same operator use different streams, or consecutive numbers of one stream.
+In the SDK, ClumpAssignment::ChooseRandomCenterStrands() uses it. The operators of the library keep their own random numbers until they are switched over.
+*/
+class StrandRandom
+{
+public:
+
+	StrandRandom( int seed, StrandId strandId, std::uint32_t stream = 0 )
+		: strandId_( strandId ),
+		position_( 0 ),
+		blockIndex_( static_cast<std::uint64_t>( -1 ) )
+	{
+		key_[0] = static_cast<std::uint32_t>( seed );
+		key_[1] = stream;
+	}
+
+	//! Stream id from the name of an operator or property, so that different operators with the same seed get unrelated numbers
+	static std::uint32_t GetStream( char const* name )
+	{
+		// 32-bit FNV-1a
+		std::uint32_t result = 2166136261u;
+		for( ; *name != 0; ++name )
+		{
+			result = ( result ^ static_cast<unsigned char>( *name ) ) * 16777619u;
+		}
+
+		return result;
+	}
+
+	//! Position of the next number in the sequence of the strand
+	EPHERE_NODISCARD std::uint64_t GetPosition() const
+	{
+		return position_;
+	}
+
+	//! Moves to any position in the sequence, without generating the numbers in between
+	void SetPosition( std::uint64_t value )
+	{
+		position_ = value;
+	}
+
+	std::uint32_t NextUnsigned()
+	{
+		auto const blockIndex = position_ / 4;
+		if( blockIndex != blockIndex_ )
+		{
+			Philox4x32::Counter const counter =
+			{ {
+				strandId_,
+				0,
+				static_cast<std::uint32_t>( blockIndex ),
+				static_cast<std::uint32_t>( blockIndex >> 32 )
+			} };
+			block_ = Philox4x32::Generate( counter, key_ );
+			blockIndex_ = blockIndex;
+		}
+
+		return block_[position_++ % 4];
+	}
+
+	//! Uniform in [0, 1)
+	float NextFloat()
+	{
+		return static_cast<float>( NextUnsigned() >> 8 ) * ( 1.0f / 16777216.0f );
+	}
+
+	//! Uniform in [minimum, maximum)
+	float NextFloat( float minimum, float maximum )
+	{
+		return minimum + NextFloat() * ( maximum - minimum );
+	}
+
+	//! Uniform in [0, count)
+	int NextInt( int count )
+	{
+		return count > 0 ? static_cast<int>( ( static_cast<std::uint64_t>( NextUnsigned() ) * static_cast<std::uint32_t>( count ) ) >> 32 ) : 0;
+	}
+
+private:
+
+	Philox4x32::Key key_;
+	StrandId strandId_;
+	std::uint64_t position_;
+
+	Philox4x32::Counter block_;
+	std::uint64_t blockIndex_;
+};
+
+} }
@@ -0,0 +1,261 @@
+// Must compile with VC 2012 / GCC 4.8
+
+#pragma once
+
+#include "Ephere/NativeTools/MappedFile.h"
+#include "Ephere/NativeTools/StringToolsBase.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Ephere { namespace Ornatrix
+{
+
+/*! Removal of redundant time samples from USD text layers written by IUsdSerializer::ExportHair().
+
+The exporter writes every attribute at every frame, even the ones which don't change, e.g. the topology, texture coordinates or widths of hair whose
+shape alone is animated. A sample is redundant if it holds the same value as both of its neighbors, since USD would interpolate the same value there
+without it. An attribute whose samples all hold the same value keeps only its first sample, which USD uses at all times.
+
+Values are compared by their text, which USD writes with the shortest representation that reads back to the same value, so equal text means
+bit-identical values. Binary (crate) layers don't need this: their writer stores each distinct value only once, the samples merely refer to it.
+*/
+namespace UsdTimeSamples
+{
+
+namespace Detail
+{
+
+struct Sample
+{
+	//! Span of the whole sample in the layer, from the whitespace before the time to the comma after the value
+	char const* begin;
+	char const* end;
+
+	std::string_view value;
+};
+
+// Returns the end of a value which starts at position, nested brackets and quoted strings included
+inline char const* FindValueEnd( char const* position, char const* end )
+{
+	auto depth = 0;
+	for( ; position != end; ++position )
+	{
+		auto const character = *position;
+		if( character == '"' || character == '\'' )
+		{
+			for( ++position; position != end && *position != character; ++position )
+			{
+				if( *position == '\\' && position + 1 != end )
+				{
+					++position;
+				}
+			}
+
+			if( position == end )
+			{
+				return nullptr;
+			}
+		}
+		else if( character == '[' || character == '(' || character == '{' )
+		{
+			++depth;
+		}
+		else if( character == ']' || character == ')' || character == '}' )
+		{
+			if( depth == 0 )
+			{
+				return character == '}' ? position : nullptr;
+			}
+
+			--depth;
+		}
+		else if( character == ',' && depth == 0 )
+		{
+			return position;
+		}
+	}
+
+	return nullptr;
+}
+
+inline bool IsSpace( char const character )
+{
+	return character == ' ' || character == '\t' || character == '\r' || character == '\n';
+}
+
+inline std::string_view TrimEnd( char const* begin, char const* end )
+{
+	while( end != begin && IsSpace( end[-1] ) )
+	{
+		--end;
+	}
+
+	return std::string_view( begin, static_cast<std::size_t>( end - begin ) );
+}
+
+/*! Parses the samples of a time sample dictionary, position is just after its opening brace
+@return The closing brace, or null if the dictionary is malformed
+*/
+inline char const* ParseSamples( char const* position, char const* end, std::vector<Sample>& samples )
+{
+	samples.clear();
+	for( ;; )
+	{
+		auto const* const sampleBegin = position;
+		while( position != end && IsSpace( *position ) )
+		{
+			++position;
+		}
+
+		if( position == end )
+		{
+			return nullptr;
+		}
+
+		if( *position == '}' )
+		{
+			return position;
+		}
+
+		auto const* const colon = static_cast<char const*>( std::memchr( position, ':', static_cast<std::size_t>( end - position ) ) );
+		if( colon == nullptr )
+		{
+			return nullptr;
+		}
+
+		auto const* const valueBegin = colon + 1;
+		auto const* const valueEnd = FindValueEnd( valueBegin, end );
+		if( valueEnd == nullptr )
+		{
+			return nullptr;
+		}
+
+		Sample sample;
+		sample.begin = sampleBegin;
+		sample.value = TrimEnd( valueBegin, valueEnd );
+		position = *valueEnd == ',' ? valueEnd + 1 : valueEnd;
+		sample.end = position;
+		samples.push_back( sample );
+	}
+}
+
+// Passes the parts of the layer which are kept to append( begin, end ), returns the number of samples removed
+template <typename AppendFunctionType>
+int RemoveRedundant( std::string_view layer, AppendFunctionType append )
+{
+	static char const TimeSamplesMarker[] = ".timeSamples = {";
+	auto const markerLength = sizeof( TimeSamplesMarker ) - 1;
+
+	auto removedCount = 0;
+	std::vector<Sample> samples;
+	auto const* const end = layer.data() + layer.length();
+	auto const* copied = layer.data();
+	auto const* position = layer.data();
+	for( ;; )
+	{
+		position = std::search( position, end, TimeSamplesMarker, TimeSamplesMarker + markerLength );
+		if( position == end )
+		{
+			break;
+		}
+
+		position += markerLength;
+		auto const* const closingBrace = ParseSamples( position, end, samples );
+		if( closingBrace == nullptr )
+		{
+			continue;
+		}
+
+		auto const count = static_cast<int>( samples.size() );
+		auto isConstant = true;
+		for( auto index = 1; index < count && isConstant; ++index )
+		{
+			isConstant = samples[index].value == samples[0].value;
+		}
+
+		for( auto index = 1; index < count; ++index )
+		{
+			auto const isRedundant = isConstant
+				|| ( index + 1 < count && samples[index].value == samples[index - 1].value && samples[index].value == samples[index + 1].value );
+			if( isRedundant )
+			{
+				append( copied, samples[index].begin );
+				copied = samples[index].end;
+				++removedCount;
+			}
+		}
+
+		position = closingBrace;
+	}
+
+	append( copied, end );
+	return removedCount;
+}
+
+}
+
+/*! Writes the layer without its redundant time samples to result
+@return Number of samples removed. Dictionaries which can't be parsed are kept as they are.
+*/
+inline int RemoveRedundant( std::string_view layer, std::string& result )
+{
+	result.clear();
+	result.reserve( layer.length() );
+	return Detail::RemoveRedundant( layer, [&result]( char const* begin, char const* end )
+	{
+		result.append( begin, end );
+	} );
+}
+
+/*! Removes the redundant time samples of a USD text layer file. The file is mapped and the compacted layer is written to a temporary file next to it,
+which then replaces it, so the file stays intact if writing fails.
+*/
+inline bool RemoveRedundantFromFile( std::string const& filePath )
+{
+	auto const temporaryFilePath = filePath + ".tmp";
+	auto removedCount = 0;
+	{
+		MappedFile layer;
+		if( !layer.Open( filePath ) )
+		{
+			return false;
+		}
+
+		std::ofstream file( temporaryFilePath.c_str(), std::ios::binary | std::ios::trunc );
+		removedCount = Detail::RemoveRedundant( std::string_view( layer.data(), layer.size() ), [&file]( char const* begin, char const* end )
+		{
+			file.write( begin, static_cast<std::streamsize>( end - begin ) );
+		} );
+
+		if( removedCount == 0 || !file.flush() )
+		{
+			file.close();
+			std::remove( temporaryFilePath.c_str() );
+			return removedCount == 0;
+		}
+	}
+
+	// The layer is unmapped by now. Renaming over an existing file fails on Windows, the file is removed first there.
+	if( std::rename( temporaryFilePath.c_str(), filePath.c_str() ) == 0 )
+	{
+		return true;
+	}
+
+	if( std::remove( filePath.c_str() ) != 0 )
+	{
+		std::remove( temporaryFilePath.c_str() );
+		return false;
+	}
+
+	// Failing now leaves the compacted layer in the temporary file
+	return std::rename( temporaryFilePath.c_str(), filePath.c_str() ) == 0;
+}
+
+}
+
+} }
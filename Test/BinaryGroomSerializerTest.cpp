@@ -0,0 +1,56 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/BinaryGroomSerializer.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestBinaryGroomBlocks()
+{
+	std::vector<float> const values( 1000, 0.5f );
+	std::vector<BinaryGroomSerializer::Block> blocks( 2 );
+	blocks[0].kind = BinaryGroomSerializer::BlockKind::Structure;
+	blocks[0].encoding = BinaryGroomSerializer::BlockEncoding::Raw;
+	blocks[0].setIndex = blocks[0].parameterId = blocks[0].elementSize = 0;
+	blocks[0].data = "nodes:";
+	blocks[1].kind = BinaryGroomSerializer::BlockKind::ParameterArray;
+	blocks[1].encoding = BinaryGroomSerializer::BlockEncoding::Raw;
+	blocks[1].name = "guidesFromMesh";
+	blocks[1].setIndex = 1;
+	blocks[1].parameterId = 7;
+	blocks[1].elementSize = sizeof( float );
+	blocks[1].data = std::string_view( reinterpret_cast<char const*>( values.data() ), values.size() * sizeof( float ) );
+
+	auto const encoded = BinaryGroomSerializer::EncodeBlocks( blocks );
+	{
+		std::ofstream file( "BinaryGroomTest.oxg.bin", std::ios::binary );
+		file.write( encoded.data(), encoded.size() );
+	}
+
+	MappedFile const mappedFile( "BinaryGroomTest.oxg.bin" );
+	TEST( mappedFile.IsOpen() && mappedFile.size() == static_cast<std::size_t>( encoded.size() ) );
+
+	std::vector<BinaryGroomSerializer::Block> decoded;
+	TEST( BinaryGroomSerializer::DecodeBlocks( std::string_view( mappedFile.data(), mappedFile.size() ), decoded ) );
+	TEST( decoded.size() == 2 && decoded[1].name == "guidesFromMesh" && decoded[1].setIndex == 1 && decoded[1].parameterId == 7 );
+	TEST( ( decoded[1].data.data() - mappedFile.data() ) % BinaryGroomSerializer::BlockAlignment == 0 );
+	TEST( std::memcmp( decoded[1].data.data(), values.data(), values.size() * sizeof( float ) ) == 0 );
+	TEST( !BinaryGroomSerializer::DecodeBlocks( std::string_view( mappedFile.data(), BinaryGroomSerializer::HeaderSize + 10 ), decoded ) );
+
+	// A block count which doesn't fit in the block table is rejected before anything is allocated for the blocks
+	std::string corrupted( encoded.data(), encoded.size() );
+	std::uint32_t const blockCount = 0xffffffffu;
+	std::memcpy( &corrupted[BinaryGroomSerializer::Magic().length() + sizeof( std::uint32_t )], &blockCount, sizeof( blockCount ) );
+	TEST( !BinaryGroomSerializer::DecodeBlocks( corrupted, decoded ) && decoded.empty() );
+
+	std::string_view structure;
+	auto isComplete = true;
+	TEST( BinaryGroomSerializer::DecodeStructurePrefix( std::string_view( mappedFile.data(), BinaryGroomSerializer::HeaderSize + 3 ), structure, isComplete ) );
+	TEST( !isComplete && structure == "nod" );
+	std::remove( "BinaryGroomTest.oxg.bin" );
+}
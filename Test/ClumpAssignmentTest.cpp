@@ -0,0 +1,112 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/ClumpAssignment.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestClumpAssignment()
+{
+	// Two clump levels whose clumps follow strands, the finer level only clumps within regions
+	auto const strandCount = 5000;
+	std::vector<Geometry::Vector3f> roots( strandCount );
+	std::vector<int> regions( strandCount );
+	for( auto strand = 0; strand < strandCount; ++strand )
+	{
+		StrandRandom random( 1, static_cast<StrandId>( strand ) );
+		roots[strand] = Geometry::Vector3f( random.NextFloat(), random.NextFloat(), 0 );
+		regions[strand] = roots[strand].x() < 0.5f ? 0 : 1;
+	}
+
+	std::vector<Geometry::Vector3f> centers[2];
+	std::vector<int> centerStrands[2], centerRegions[2];
+	for( auto level = 0; level < 2; ++level )
+	{
+		for( auto strand = 0; strand < strandCount; strand += level == 0 ? 97 : 13 )
+		{
+			centers[level].push_back( roots[strand] );
+			centerStrands[level].push_back( strand );
+			centerRegions[level].push_back( regions[strand] );
+		}
+	}
+
+	ClumpAssignment assignment( strandCount, 256 );
+	assignment.AddLevel( centers[0], centerStrands[0].data() );
+	assignment.AddLevel( centers[1], centerStrands[1].data(), centerRegions[1].data() );
+
+	ThreadPool pool( 4 );
+	TEST( assignment.Assign( &pool, roots, regions.data(), 8 ) );
+	for( auto strand = 0; strand < strandCount; strand += 7 )
+	{
+		for( auto level = 0; level < 2; ++level )
+		{
+			auto expected = -1;
+			auto expectedDistance = std::numeric_limits<float>::max();
+			for( auto center = 0; center < static_cast<int>( centers[level].size() ); ++center )
+			{
+				auto const dx = centers[level][center].x() - roots[strand].x(), dy = centers[level][center].y() - roots[strand].y();
+				if( ( level == 0 || centerRegions[level][center] == regions[strand] ) && dx * dx + dy * dy < expectedDistance )
+				{
+					expected = center;
+					expectedDistance = dx * dx + dy * dy;
+				}
+			}
+
+			TEST( assignment.GetClumps( level )[strand] == expected );
+		}
+	}
+
+	// Pipelined parallel attraction gives the same result as attracting one level after another
+	auto const attract = [&]( std::vector<float>& values, int level, int firstStrand, int count )
+	{
+		auto const clumps = assignment.GetClumps( level );
+		for( auto strand = firstStrand; strand < firstStrand + count; ++strand )
+		{
+			auto const centerStrand = clumps[strand] >= 0 ? centerStrands[level][clumps[strand]] : -1;
+			if( centerStrand >= 0 && centerStrand != strand )
+			{
+				values[strand] += 0.5f * ( values[centerStrand] - values[strand] );
+			}
+		}
+
+		return true;
+	};
+
+	std::vector<float> serialValues( strandCount ), parallelValues( strandCount );
+	for( auto strand = 0; strand < strandCount; ++strand )
+	{
+		serialValues[strand] = parallelValues[strand] = static_cast<float>( strand % 101 );
+	}
+
+	for( auto level = 0; level < 2; ++level )
+	{
+		attract( serialValues, level, 0, strandCount );
+	}
+
+	TEST( assignment.Attract( &pool, [&]( int level, int firstStrand, int count )
+	{
+		return attract( parallelValues, level, firstStrand, count );
+	} ) );
+
+	TEST( serialValues == parallelValues );
+
+	// Random centers are the same on any number of threads, and strands keep being picked when other strands are removed
+	std::vector<StrandId> strandIds( strandCount );
+	for( auto strand = 0; strand < strandCount; ++strand )
+	{
+		strandIds[strand] = static_cast<StrandId>( strand );
+	}
+
+	auto const randomCenters = ClumpAssignment::ChooseRandomCenterStrands( &pool, strandIds, 200, 5, 256 );
+	TEST( randomCenters == ClumpAssignment::ChooseRandomCenterStrands( nullptr, strandIds, 200, 5 ) );
+	TEST( randomCenters.size() == 200 );
+	TEST( ClumpAssignment::ChooseRandomCenterStrands( nullptr, strandIds, strandCount + 1, 5 ).size() == static_cast<std::size_t>( strandCount ) );
+	strandIds.erase( strandIds.begin() + strandIds.size() / 2, strandIds.end() );
+	auto const halfRandomCenters = ClumpAssignment::ChooseRandomCenterStrands( &pool, strandIds, 200, 5, 256 );
+	TEST( halfRandomCenters.size() == 200 );
+	TEST( std::includes( halfRandomCenters.begin(), halfRandomCenters.end(), randomCenters.begin(),
+		std::lower_bound( randomCenters.begin(), randomCenters.end(), strandCount / 2 ) ) );
+}
@@ -0,0 +1,52 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/IHair.h"
+#include "Ephere/Ornatrix/Groom/IOperator.h"
+
+#include <memory>
+#include <vector>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestEvaluationContextExtension()
+{
+	Groom::CancellationToken cancellationToken;
+	Groom::ExtendedEvaluationContext extendedContext;
+	extendedContext.extension.cancellationToken = &cancellationToken;
+	Groom::EvaluationContext& context = extendedContext;
+	auto batchCount = 0;
+	auto const countBatches = [&batchCount]( int, int strandCount )
+	{
+		++batchCount;
+		return strandCount > 0;
+	};
+
+	TEST( context.ForEachStrandBatch( 10, countBatches, 4 ) && batchCount == 3 );
+	cancellationToken.Cancel();
+	TEST( !context.ForEachStrandBatch( 10, countBatches, 4 ) && batchCount == 3 );
+
+	// Contexts without an extension, like the ones created by the library, give the defaults
+	Groom::EvaluationContext const plainContext = {};
+	TEST( plainContext.GetExtension() == nullptr && !plainContext.IsCancelled() && plainContext.GetWorkerCount() == 0 );
+	Groom::ExtendedEvaluationContext const copiedContext( context );
+	TEST( copiedContext.GetExtension() == &copiedContext.extension && copiedContext.IsCancelled() );
+
+	// More live contexts than the lock-free lookup has slots for, and slots reused after their contexts are gone
+	std::vector<std::unique_ptr<Groom::ExtendedEvaluationContext>> contexts;
+	for( auto index = 0; index < 300; ++index )
+	{
+		contexts.push_back( std::unique_ptr<Groom::ExtendedEvaluationContext>( new Groom::ExtendedEvaluationContext ) );
+		contexts.back()->extension.workerCount = index + 1;
+	}
+
+	contexts.erase( contexts.begin(), contexts.begin() + 100 );
+	contexts.push_back( std::unique_ptr<Groom::ExtendedEvaluationContext>( new Groom::ExtendedEvaluationContext ) );
+	contexts.back()->extension.workerCount = 301;
+	for( auto index = 0; index < static_cast<int>( contexts.size() ); ++index )
+	{
+		TEST( contexts[index]->GetExtension() == &contexts[index]->extension && contexts[index]->GetWorkerCount() == index + 101 );
+	}
+
+	TEST( context.IsCancelled() );
+}
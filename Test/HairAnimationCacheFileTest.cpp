@@ -0,0 +1,172 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/HairAnimationCacheFile.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestHairAnimationCache()
+{
+	// Strands of 2, 3 and 1 points in blocks of 2 strands, vertex i at frame f is ( f, i, 0 ) with width i + f
+	{
+		HairAnimationCacheFile::Writer writer( "HairAnimationCacheTest.oxhc", { 2, 3, 1 }, true, 2 );
+		TEST( writer.IsOpen() );
+		for( auto frame = 0; frame < 4; ++frame )
+		{
+			std::vector<Geometry::Vector3f> vertices;
+			std::vector<float> widths;
+			for( auto vertex = 0; vertex < 6; ++vertex )
+			{
+				vertices.push_back( Geometry::Vector3f( static_cast<float>( frame ), static_cast<float>( vertex ), 0 ) );
+				widths.push_back( static_cast<float>( vertex + frame ) );
+			}
+
+			TEST( writer.AddFrame( frame * 10.0, vertices, widths ) );
+		}
+
+		TEST( !writer.AddFrame( 0, std::vector<Geometry::Vector3f>( 6 ), std::vector<float>( 6 ) ) );
+		TEST( writer.Close() );
+	}
+
+	// Room for the blocks of two frames
+	HairAnimationCacheFile::Reader reader( 2 * 6 * 4 * sizeof( float ) );
+	TEST( reader.Open( "HairAnimationCacheTest.oxhc" ) );
+	TEST( reader.GetStrandCount() == 3 && reader.GetVertexCount() == 6 && reader.HasWidths() && reader.GetTimes().size() == 4 );
+
+	Geometry::Vector3f vertices[4];
+	TEST( reader.GetVertices( 15, 1, 2, vertices ) );
+	TEST( vertices[0] == Geometry::Vector3f( 1.5f, 2, 0 ) && vertices[3] == Geometry::Vector3f( 1.5f, 5, 0 ) );
+	TEST( reader.GetDecodeCount() == 4 );
+
+	float widths[6];
+	TEST( reader.GetWidths( 12.5, 0, 3, widths ) && widths[0] == 1.25f && widths[5] == 6.25f );
+	TEST( reader.GetDecodeCount() == 4 );
+
+	TEST( reader.GetVertices( -5, 2, 1, vertices ) && vertices[0] == Geometry::Vector3f( 0, 5, 0 ) );
+	TEST( reader.GetVertices( 100, 0, 1, vertices ) && vertices[1] == Geometry::Vector3f( 3, 1, 0 ) );
+	TEST( reader.GetDecodeCount() == 6 );
+
+	// Frame 1 was evicted by frames 0 and 3
+	TEST( reader.GetVertices( 10, 0, 1, vertices ) && vertices[0] == Geometry::Vector3f( 1, 0, 0 ) );
+	TEST( reader.GetDecodeCount() == 7 );
+	TEST( !reader.GetVertices( 10, 2, 2, vertices ) );
+	reader.Close();
+
+	// Counts in the header whose index would be larger than the file are rejected, even when its size overflows
+	{
+		std::fstream file( "HairAnimationCacheTest.oxhc", std::ios::binary | std::ios::in | std::ios::out );
+		std::uint32_t const counts[] = { 0x10000000u, 1, 1, 0xFFFFFFFFu };
+		file.seekp( HairAnimationCacheFile::Detail::MagicSize );
+		file.write( reinterpret_cast<char const*>( counts ), sizeof( counts ) );
+	}
+
+	TEST( !reader.Open( "HairAnimationCacheTest.oxhc" ) && !reader.IsOpen() );
+	std::remove( "HairAnimationCacheTest.oxhc" );
+}
+
+void TestStrandQuantization()
+{
+	// Strands of 1, 9 and 6 points, enough for both the vectorized and the remaining points to be decoded
+	int const pointCounts[] = { 1, 9, 6 };
+	std::vector<Geometry::Vector3f> vertices;
+	std::vector<float> widths;
+	for( auto index = 0; index < 16; ++index )
+	{
+		vertices.push_back( Geometry::Vector3f( 10.0f + index * 0.37f, -5.0f + std::sin( index * 0.5f ), index * index * 0.01f ) );
+		widths.push_back( 0.1f + index * 0.013f );
+	}
+
+	std::string encoded;
+	StrandQuantization::Encode( pointCounts, vertices.data(), widths.data(), encoded );
+	TEST( encoded.size() == StrandQuantization::GetEncodedSize( pointCounts, true ) && encoded.size() < vertices.size() * 4 * sizeof( float ) );
+
+	std::vector<Geometry::Vector3f> decodedVertices( vertices.size() );
+	std::vector<float> decodedWidths( widths.size() );
+	TEST( StrandQuantization::Decode( pointCounts, encoded.data(), encoded.size(), true, decodedVertices.data(), decodedWidths.data() ) );
+	TEST( decodedVertices[0] == vertices[0] && decodedVertices[1] == vertices[1] && decodedVertices[10] == vertices[10] );
+	for( auto index = 0; index < 16; ++index )
+	{
+		for( auto component = 0; component < 3; ++component )
+		{
+			TEST( std::abs( decodedVertices[index][component] - vertices[index][component] ) < 1e-4f );
+		}
+
+		TEST( std::abs( decodedWidths[index] - widths[index] ) < 1e-5f );
+	}
+
+	TEST( !StrandQuantization::Decode( pointCounts, encoded.data(), encoded.size() - 1, true, decodedVertices.data(), nullptr ) );
+
+	// The ranges are shared by the block, so strands of 10 points take 55% of the size of the floats
+	std::vector<int> const tenPointCounts( 100, 10 );
+	std::vector<Geometry::Vector3f> tenPointVertices( 1000 );
+	for( auto index = 0; index < 1000; ++index )
+	{
+		tenPointVertices[index] = Geometry::Vector3f( index / 10 * 0.5f, std::cos( index * 0.3f ), index % 10 * 0.2f );
+	}
+
+	encoded.clear();
+	StrandQuantization::Encode( tenPointCounts, tenPointVertices.data(), nullptr, encoded );
+	TEST( encoded.size() == StrandQuantization::GetEncodedSize( tenPointCounts, false ) );
+	TEST( encoded.size() < 0.56 * tenPointVertices.size() * 3 * sizeof( float ) );
+	std::vector<Geometry::Vector3f> decodedTenPointVertices( tenPointVertices.size() );
+	TEST( StrandQuantization::Decode( tenPointCounts, encoded.data(), encoded.size(), false, decodedTenPointVertices.data(), nullptr ) );
+	TEST( std::abs( decodedTenPointVertices[999][1] - tenPointVertices[999][1] ) < 1e-4f );
+
+	{
+		HairAnimationCacheFile::Writer writer( "HairAnimationCacheTest.oxhc", std::vector<int>( pointCounts, pointCounts + 3 ), true, 2,
+			Deflater::BestSpeed, true );
+		TEST( writer.AddFrame( 0, vertices, widths ) && writer.Close() );
+	}
+
+	HairAnimationCacheFile::Reader reader;
+	TEST( reader.Open( "HairAnimationCacheTest.oxhc" ) && reader.IsQuantized() );
+	TEST( reader.GetVertices( 0, 0, 3, decodedVertices.data() ) && reader.GetWidths( 0, 0, 3, decodedWidths.data() ) );
+	TEST( decodedVertices[10] == vertices[10] && std::abs( decodedVertices[15][2] - vertices[15][2] ) < 1e-4f );
+	TEST( std::abs( decodedWidths[15] - widths[15] ) < 1e-5f );
+	reader.Close();
+	std::remove( "HairAnimationCacheTest.oxhc" );
+}
+
+void TestProgressiveHairAnimationCache()
+{
+	TEST( HairAnimationCacheFile::GetProgressiveOrder( 5 ) == std::vector<int>( { 0, 4, 2, 1, 3 } ) );
+	TEST( HairAnimationCacheFile::GetProgressiveOrder( 0 ).empty() && HairAnimationCacheFile::GetProgressiveOrder( 1 ) == std::vector<int>( 1, 0 ) );
+
+	// Strand i has i + 1 points at x = i
+	std::vector<int> pointCounts;
+	std::vector<Geometry::Vector3f> vertices;
+	for( auto strand = 0; strand < 5; ++strand )
+	{
+		pointCounts.push_back( strand + 1 );
+		for( auto point = 0; point <= strand; ++point )
+		{
+			vertices.push_back( Geometry::Vector3f( static_cast<float>( strand ), static_cast<float>( point ), 0 ) );
+		}
+	}
+
+	{
+		HairAnimationCacheFile::Writer writer( "HairAnimationCacheTest.oxhc", pointCounts, false, 2, Deflater::BestSpeed, false, true );
+		TEST( writer.AddFrame( 0, vertices ) && writer.Close() );
+	}
+
+	HairAnimationCacheFile::Reader reader;
+	TEST( reader.Open( "HairAnimationCacheTest.oxhc" ) && reader.IsProgressive() );
+	TEST( reader.GetOriginalStrandIndices() == HairAnimationCacheFile::GetProgressiveOrder( 5 ) );
+	TEST( reader.GetStrandPointCounts() == std::vector<int>( { 1, 5, 3, 2, 4 } ) );
+
+	// The preview only reads the first block, the rest is read when the full hair is needed
+	auto const previewStrandCount = reader.GetPreviewStrandCount( 0.4f );
+	TEST( previewStrandCount == 2 );
+	Geometry::Vector3f storedVertices[15];
+	TEST( reader.GetVertices( 0, 0, previewStrandCount, storedVertices ) && reader.GetDecodeCount() == 1 );
+	TEST( storedVertices[0] == Geometry::Vector3f( 0, 0, 0 ) && storedVertices[5] == Geometry::Vector3f( 4, 4, 0 ) );
+	TEST( reader.GetVertices( 0, 0, 5, storedVertices ) && reader.GetDecodeCount() == 3 );
+	TEST( storedVertices[14] == Geometry::Vector3f( 3, 3, 0 ) );
+	reader.Close();
+	std::remove( "HairAnimationCacheTest.oxhc" );
+}
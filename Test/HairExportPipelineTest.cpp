@@ -0,0 +1,194 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/IHair.h"
+#include "Ephere/Ornatrix/HairExportPipeline.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+namespace
+{
+
+// Stands in for the USD exporter: asks for the frames one after another and takes a while to write each of them
+struct TestHairExporter : IUsdSerializer
+{
+	StringView GroomFileFormatExtension() const override
+	{
+		return ExtensionUsd();
+	}
+
+	StringView GroomZippedFormatExtension() const override
+	{
+		return ExtensionUsdZip();
+	}
+
+	bool ContentsHasCorrectFormat( StringView ) const override
+	{
+		return false;
+	}
+
+	bool GetGroomInfoFromContentBuffer( StringView, GroomInfo& ) const override
+	{
+		return false;
+	}
+
+	bool SerializeGroom( Groom::IGraph const&, GroomSerializeSettings const&, SerializedGroom& ) const override
+	{
+		return false;
+	}
+
+	UniquePtr<Groom::IGraph> DeserializeGroom( SerializedGroom const&, double, Span<std::pair<Parameters::TypeId, Parameters::FactoryFunction> const>,
+		StringView ) const override
+	{
+		return UniquePtr<Groom::IGraph>();
+	}
+
+	bool IsUsdFile( StringView ) const override
+	{
+		return false;
+	}
+
+	bool ExportHair( void* node, ExportHairOptions const& options, StringView, StringView ) const override
+	{
+		for( auto time = options.timeStart; time <= options.timeEnd; time += options.timeStep )
+		{
+			auto const result = options.evaluator( node, time, 0 );
+			if( result.canceled )
+			{
+				return false;
+			}
+
+			writtenHair.push_back( result.hair );
+			std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+		}
+
+		return true;
+	}
+
+	mutable std::vector<IHair*> writtenHair;
+};
+
+// Each frame's hair is identified by the address of its element in frameHair
+struct TestHairExportNode
+{
+	TestHairExportNode()
+		: frameHair( 8 ),
+		runningCount( 0 ),
+		maxRunningCount( 0 ),
+		releasedCount( 0 )
+	{
+	}
+
+	static IUsdSerializer::ExportHairOptions::EvaluateResult Evaluate( void* node, double time, double )
+	{
+		auto& self = *static_cast<TestHairExportNode*>( node );
+		auto const running = ++self.runningCount;
+		auto maxRunning = self.maxRunningCount.load();
+		while( running > maxRunning && !self.maxRunningCount.compare_exchange_weak( maxRunning, running ) )
+		{
+		}
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+		--self.runningCount;
+
+		IUsdSerializer::ExportHairOptions::EvaluateResult result;
+		result.hair = reinterpret_cast<IHair*>( &self.frameHair[static_cast<int>( time )] );
+		return result;
+	}
+
+	static void Release( void* node, IHair* )
+	{
+		++static_cast<TestHairExportNode*>( node )->releasedCount;
+	}
+
+	std::vector<int> frameHair;
+	std::atomic<int> runningCount;
+	std::atomic<int> maxRunningCount;
+	std::atomic<int> releasedCount;
+};
+
+}
+
+void TestPipelinedExport()
+{
+	TestHairExporter exporter;
+	TestHairExportNode node;
+	IUsdSerializer::ExportHairOptions const options( &TestHairExportNode::Evaluate, true, true, false, false, 1, 0, 7, 1, 24 );
+	TEST( !ExportHairPipelined( exporter, &node, options, PipelinedExportOptions( 3, 4 ), "Test.usda" ) && exporter.writtenHair.empty() );
+	TEST( ExportHairPipelined( exporter, &node, options, PipelinedExportOptions( 3, 4, &TestHairExportNode::Release, false ), "Test.usda" ) );
+	TEST( exporter.writtenHair.size() == 8 );
+	for( auto index = 0; index < 8; ++index )
+	{
+		TEST( exporter.writtenHair[index] == reinterpret_cast<IHair*>( &node.frameHair[index] ) );
+	}
+
+	TEST( node.maxRunningCount > 1 && node.maxRunningCount <= 3 );
+	TEST( node.releasedCount == 8 );
+}
+
+void TestUsdTimeSamples()
+{
+	std::string const layer =
+		"def BasisCurves \"hair\"\n"
+		"{\n"
+		"    int[] curveVertexCounts.timeSamples = {\n"
+		"        0: [2, 2],\n"
+		"        1: [2, 2],\n"
+		"        2: [2, 2],\n"
+		"    }\n"
+		"    float[] widths.timeSamples = {\n"
+		"        0: [0.1, 0.2],\n"
+		"        1: [0.1, 0.2],\n"
+		"        2: [0.1, 0.2],\n"
+		"        3: [0.3, 0.2],\n"
+		"        4: [0.1, 0.2],\n"
+		"    }\n"
+		"    string[] names.timeSamples = {\n"
+		"        0: [\"a, ]\"],\n"
+		"        1: [\"b\"],\n"
+		"    }\n"
+		"}\n";
+	std::string compacted;
+	TEST( UsdTimeSamples::RemoveRedundant( std::string_view( layer.data(), layer.size() ), compacted ) == 3 );
+	TEST( compacted ==
+		"def BasisCurves \"hair\"\n"
+		"{\n"
+		"    int[] curveVertexCounts.timeSamples = {\n"
+		"        0: [2, 2],\n"
+		"    }\n"
+		"    float[] widths.timeSamples = {\n"
+		"        0: [0.1, 0.2],\n"
+		"        2: [0.1, 0.2],\n"
+		"        3: [0.3, 0.2],\n"
+		"        4: [0.1, 0.2],\n"
+		"    }\n"
+		"    string[] names.timeSamples = {\n"
+		"        0: [\"a, ]\"],\n"
+		"        1: [\"b\"],\n"
+		"    }\n"
+		"}\n" );
+	std::string recompacted;
+	TEST( UsdTimeSamples::RemoveRedundant( std::string_view( compacted.data(), compacted.size() ), recompacted ) == 0 && recompacted == compacted );
+
+	{
+		std::ofstream file( "UsdTimeSamplesTest.usda", std::ios::binary );
+		file << layer;
+	}
+
+	TEST( UsdTimeSamples::RemoveRedundantFromFile( "UsdTimeSamplesTest.usda" ) );
+	{
+		std::ifstream file( "UsdTimeSamplesTest.usda", std::ios::binary );
+		std::stringstream contents;
+		contents << file.rdbuf();
+		TEST( contents.str() == compacted );
+		TEST( !std::ifstream( "UsdTimeSamplesTest.usda.tmp" ) );
+	}
+
+	std::remove( "UsdTimeSamplesTest.usda" );
+}
@@ -1,14 +1,11 @@
+#include "Tests.h"
+
 #include "Ephere/Geometry/Native/IPolygonMesh.h"
 #include "Ephere/Ornatrix/IHair.h"
 #include "Ephere/Ornatrix/Ornatrix.h"
 #include "Ephere/Ornatrix/Ramp.h"
 #include "Ephere/Ornatrix/Operators/RootGeneratorParameters.g.h"
 
-#include <iostream>
-
-#define TEST( condition ) \
-	if( condition ) {} else { std::cout << "Test failed in " << __FILE__ << '(' << __LINE__ << "), message: " << #condition << '\n'; std::exit( 1 ); } void(0)
-
 using namespace Ephere;
 using namespace Ephere::Ornatrix;
 
@@ -16,6 +13,23 @@ int main()
 {
 	TEST( Ramp( 1 ).Evaluate( 0.5f ) == 1 );
 
+	TestRunTaskGraph();
+	TestNestedTaskGraph();
+	TestEvaluationContextExtension();
+	TestBinaryGroomBlocks();
+	TestZipArchive();
+	TestGroomInfoProbe();
+	TestPipelinedExport();
+	TestUsdTimeSamples();
+	TestHairAnimationCache();
+	TestStrandQuantization();
+	TestProgressiveHairAnimationCache();
+	TestPointBvh();
+	TestStrandInterpolation();
+	TestInstancedHair();
+	TestStrandRandom();
+	TestClumpAssignment();
+	TestStrandCollision();
 
 	auto logger = []( Log::Level level, char const* message )
 	{
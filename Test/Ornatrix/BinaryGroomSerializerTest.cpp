@@ -0,0 +1,112 @@
+#include "PrecompiledHeaders.h"
+
+#include "Utilities.h"
+#include "Ephere/Ornatrix/BinaryGroomSerializer.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+#include "Ephere/Ornatrix/Groom/DeferredParameterLoader.h"
+#include "Ephere/Ornatrix/Operators/RootGeneratorParameters.g.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace Ephere;
+using namespace Ornatrix;
+using namespace std;
+
+TEST_CASE( "BinaryGroomSerializer" )
+{
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( SampleGroomFilename + ".yaml"s );
+	REQUIRE( groom != nullptr );
+	groom->FindNode( GuidesFromMeshNodeName )->GetOperator().GetParameterSet( RootGeneratorParameters::GetName() )->Set<RootGeneratorParameters::RootCount>( 50 );
+
+	BinaryGroomSerializer binarySerializer( *TheOrnatrixLibrary.grooms->GetGroomSerializers()[0], 16 );
+	IGrooms::RegisterGroomSerializer( binarySerializer, &BinaryGroomSerializer::DeserializeMappedFile );
+
+	SECTION( "File" )
+	{
+		auto const filePath = TheOrnatrixLibrary.grooms->SerializeGroomToFile( *groom, "SampleGroom.oxg.bin" );
+		REQUIRE( filePath == "SampleGroom.oxg.bin" );
+
+		// Saving through the library doesn't modify the graph, but still stores the large arrays as raw blocks
+		{
+			MappedFile const file( filePath );
+			REQUIRE( file.IsOpen() );
+			vector<BinaryGroomSerializer::Block> blocks;
+			REQUIRE( BinaryGroomSerializer::DecodeBlocks( string_view( file.data(), file.size() ), blocks ) );
+			REQUIRE( count_if( blocks.begin(), blocks.end(), []( BinaryGroomSerializer::Block const& block )
+			{
+				return block.kind == BinaryGroomSerializer::BlockKind::ParameterArray;
+			} ) > 0 );
+		}
+
+		REQUIRE( TheOrnatrixLibrary.grooms->EvaluateGroom( *groom ).first->GetStrandCount() == 50 );
+
+		{
+			auto const binaryGroom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( filePath );
+			REQUIRE( binaryGroom != nullptr );
+			auto const hair = TheOrnatrixLibrary.grooms->EvaluateGroom( *binaryGroom ).first;
+			REQUIRE( hair );
+			REQUIRE( hair->GetStrandCount() == 50 );
+		}
+
+		// Mapped by the groom above until it was deleted
+		FileRemove( filePath );
+	}
+
+	SECTION( "Arrays" )
+	{
+		// A mutable graph has its large arrays stored as raw blocks, and gets them back afterwards
+		SerializedGroom serialized;
+		REQUIRE( binarySerializer.SerializeGroom( *groom, GroomSerializeSettings(), serialized ) );
+		vector<BinaryGroomSerializer::Block> blocks;
+		REQUIRE( BinaryGroomSerializer::DecodeBlocks( string_view( serialized.contentBuffer.data(), serialized.contentBuffer.length() ), blocks ) );
+		REQUIRE( count_if( blocks.begin(), blocks.end(), []( BinaryGroomSerializer::Block const& block )
+		{
+			return block.kind == BinaryGroomSerializer::BlockKind::ParameterArray;
+		} ) > 0 );
+		REQUIRE( TheOrnatrixLibrary.grooms->EvaluateGroom( *groom ).first->GetStrandCount() == 50 );
+
+		static string const ArraysFilePath = "SampleGroomArrays.oxg.bin";
+		{
+			ofstream arraysFile( ArraysFilePath, ios::binary );
+			arraysFile.write( serialized.contentBuffer.data(), static_cast<streamsize>( serialized.contentBuffer.length() ) );
+		}
+
+		{
+			auto const arraysGroom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( ArraysFilePath );
+			REQUIRE( arraysGroom != nullptr );
+			REQUIRE( TheOrnatrixLibrary.grooms->EvaluateGroom( *arraysGroom ).first->GetStrandCount() == 50 );
+		}
+
+		auto lazyGroom = BinaryGroomSerializer::DeserializeMappedFileLazily( binarySerializer, ArraysFilePath, TimeUndefined,
+			Span<pair<Parameters::TypeId, Parameters::FactoryFunction> const>() );
+		REQUIRE( lazyGroom != nullptr );
+		auto const loader = Groom::FindDeferredParameterLoader( *lazyGroom );
+		REQUIRE( loader != nullptr );
+		auto deferredNodeCount = 0;
+		for( auto index = 0; index < lazyGroom->GetNodeCount(); ++index )
+		{
+			deferredNodeCount += loader->HasDeferredValues( lazyGroom->GetNode( index ) ) ? 1 : 0;
+		}
+
+		REQUIRE( deferredNodeCount > 0 );
+
+		Groom::EvaluationContext context = {};
+		auto const evaluator = TheOrnatrixLibrary.grooms->CreateEvaluator( *lazyGroom );
+		REQUIRE( evaluator->Evaluate( context ) );
+		REQUIRE( evaluator->GetResultHair() != nullptr );
+		REQUIRE( ( *evaluator->GetResultHair() )->GetStrandCount() == 50 );
+		for( auto index = 0; index < evaluator->GetNodeCount(); ++index )
+		{
+			REQUIRE( ( !evaluator->GetNode( index ).IsEnabled() || !loader->HasDeferredValues( evaluator->GetNode( index ) ) ) );
+		}
+
+		// The loader is forgotten together with the groom
+		auto const* const lazyGroomAddress = lazyGroom.get();
+		lazyGroom.reset();
+		REQUIRE( Groom::FindDeferredParameterLoader( *lazyGroomAddress ) == nullptr );
+		FileRemove( ArraysFilePath );
+	}
+
+	IGrooms::UnregisterGroomSerializer( binarySerializer );
+}
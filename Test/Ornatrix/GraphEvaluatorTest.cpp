@@ -0,0 +1,171 @@
+#include "PrecompiledHeaders.h"
+
+#include "Utilities.h"
+#include "Ephere/Ornatrix/IHair.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+#include "Ephere/Ornatrix/Groom/GraphEvaluator.h"
+#include "Ephere/Ornatrix/Groom/GroomProfile.h"
+#include "Ephere/Ornatrix/Groom/HairPool.h"
+
+#include <algorithm>
+
+using namespace Ephere;
+using namespace Ornatrix;
+using namespace Groom;
+using namespace std;
+
+namespace
+{
+
+// Cancels the evaluation once a node was applied
+struct CancelAfterNodeProfiler : IEvaluationProfiler
+{
+	CancelAfterNodeProfiler( INode const* node, CancellationToken& cancellationToken )
+		: node( node ),
+		cancellationToken( &cancellationToken )
+	{
+	}
+
+	void OnNodeEvaluated( NodeProfile const& profile ) override
+	{
+		if( profile.node == node )
+		{
+			cancellationToken->Cancel();
+		}
+	}
+
+	INode const* node;
+	CancellationToken* cancellationToken;
+};
+
+UniquePtr<IHair> CreateLibraryHair( bool initAsGuides )
+{
+	return TheOrnatrixLibrary.library->CreateHair( initAsGuides );
+}
+
+}
+
+TEST_CASE( "GraphEvaluator" )
+{
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( SampleGroomFilename + ".yaml"s );
+	REQUIRE( groom != nullptr );
+	auto const guidesFromMeshNode = groom->FindNode( GuidesFromMeshNodeName );
+	REQUIRE( guidesFromMeshNode );
+
+	GroomProfile profile;
+	ExtendedEvaluationContext context;
+	context.extension.workerCount = 2;
+	context.extension.profiler = &profile;
+	auto const evaluator = TheOrnatrixLibrary.grooms->CreateEvaluator( *groom );
+	REQUIRE( evaluator->Evaluate( context ) );
+	REQUIRE( evaluator->GetExecutedNodeIndices().size() == evaluator->GetNodeCount() );
+	REQUIRE( static_cast<int>( profile.GetEntries().size() ) == evaluator->GetNodeCount() );
+	REQUIRE( profile.ToChromeTraceJson().find( "\"guidesFromMesh\"" ) != string::npos );
+	REQUIRE( evaluator->GetResultHair() != nullptr );
+	REQUIRE( ( *evaluator->GetResultHair() )->GetStrandCount() == 30 );
+
+	SECTION( "Incremental" )
+	{
+		// Nothing changed, nothing is re-applied
+		REQUIRE( evaluator->Evaluate( context ) );
+		REQUIRE( evaluator->GetExecutedNodeIndices().empty() );
+
+		guidesFromMeshNode->SetDirty();
+		REQUIRE( evaluator->Evaluate( context ) );
+		REQUIRE( evaluator->WasExecuted( *guidesFromMeshNode ) );
+		REQUIRE_FALSE( evaluator->WasExecuted( groom->GetCurrentTimeNode() ) );
+	}
+
+	SECTION( "Cancellation" )
+	{
+		CancellationToken cancellationToken;
+		cancellationToken.Cancel();
+		context.extension.cancellationToken = &cancellationToken;
+		guidesFromMeshNode->SetDirty();
+		REQUIRE_FALSE( evaluator->Evaluate( context ) );
+		REQUIRE( evaluator->GetStatus() == ApplyResult::Cancelled );
+
+		// Cancelled right after the guides were generated, the nodes using them still need to be applied by the next evaluation
+		cancellationToken.Reset();
+		CancelAfterNodeProfiler cancellingProfiler( guidesFromMeshNode, cancellationToken );
+		context.extension.workerCount = 1;
+		context.extension.profiler = &cancellingProfiler;
+		REQUIRE_FALSE( evaluator->Evaluate( context ) );
+		REQUIRE( evaluator->WasExecuted( *guidesFromMeshNode ) );
+		auto const guidesFromMeshIndex = evaluator->GetNodeIndex( guidesFromMeshNode );
+		vector<int> successorIndices;
+		for( auto index = 0; index < evaluator->GetNodeCount(); ++index )
+		{
+			auto const predecessors = evaluator->GetPredecessors( index );
+			if( find( predecessors.begin(), predecessors.end(), guidesFromMeshIndex ) != predecessors.end() )
+			{
+				REQUIRE_FALSE( evaluator->WasExecuted( evaluator->GetNode( index ) ) );
+				successorIndices.push_back( index );
+			}
+		}
+
+		REQUIRE_FALSE( successorIndices.empty() );
+		cancellationToken.Reset();
+		context.extension.profiler = nullptr;
+		REQUIRE( evaluator->Evaluate( context ) );
+		REQUIRE_FALSE( evaluator->WasExecuted( *guidesFromMeshNode ) );
+		for( auto const index : successorIndices )
+		{
+			REQUIRE( evaluator->WasExecuted( evaluator->GetNode( index ) ) );
+		}
+	}
+}
+
+TEST_CASE( "EvaluateGroomFrames" )
+{
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( SampleGroomFilename + ".yaml"s );
+	REQUIRE( groom != nullptr );
+
+	double const times[] = { 1, 2, 3 };
+	vector<double> evaluatedTimes;
+	auto areOnlyTimeDependentNodesReapplied = true;
+	REQUIRE( TheOrnatrixLibrary.grooms->EvaluateGroomFrames( *groom, times, [&]( int frameIndex, double time, GraphEvaluator const& evaluator )
+	{
+		if( evaluator.GetResultHair() == nullptr )
+		{
+			return false;
+		}
+
+		// Frames after the first one only re-apply the time dependent nodes
+		for( auto const nodeIndex : evaluator.GetExecutedNodeIndices() )
+		{
+			areOnlyTimeDependentNodesReapplied = areOnlyTimeDependentNodesReapplied && ( frameIndex == 0 || evaluator.IsTimeDependent( nodeIndex ) );
+		}
+
+		evaluatedTimes.push_back( time );
+		return true;
+	} ) );
+	REQUIRE( evaluatedTimes == vector<double>( begin( times ), end( times ) ) );
+	REQUIRE( areOnlyTimeDependentNodesReapplied );
+}
+
+TEST_CASE( "HairPool" )
+{
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( SampleGroomFilename + ".yaml"s );
+	REQUIRE( groom != nullptr );
+
+	HairPool hairPool( &CreateLibraryHair );
+	hairPool.CreateHair( false ).reset();
+	auto const hair = hairPool.CreateHair( false );
+	REQUIRE( hair );
+	REQUIRE( hair->GetStrandCount() == 0 );
+	REQUIRE( hairPool.GetCreatedCount() == 1 );
+
+	ExtendedEvaluationContext context;
+	context.extension.hairAllocator = &hairPool;
+	auto const evaluator = TheOrnatrixLibrary.grooms->CreateEvaluator( *groom );
+	REQUIRE( evaluator->Evaluate( context ) );
+	REQUIRE( evaluator->GetResultHair() != nullptr );
+
+	// The factory function of the context stays in place for hair which can't come from the allocator, and is restored afterwards
+	context.hairFactoryFunction = &CreateLibraryHair;
+	auto const cachedEvaluator = TheOrnatrixLibrary.grooms->CreateEvaluator( *groom );
+	REQUIRE( cachedEvaluator->Evaluate( context ) );
+	REQUIRE( cachedEvaluator->GetResultHair() != nullptr );
+	REQUIRE( context.hairFactoryFunction == &CreateLibraryHair );
+}
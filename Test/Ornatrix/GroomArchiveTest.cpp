@@ -0,0 +1,29 @@
+#include "PrecompiledHeaders.h"
+
+#include "Utilities.h"
+#include "Ephere/Ornatrix/GroomArchive.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+
+using namespace Ephere;
+using namespace Ornatrix;
+using namespace std;
+
+TEST_CASE( "GroomArchive" )
+{
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( SampleGroomFilename + ".yaml"s );
+	REQUIRE( groom != nullptr );
+
+	ThreadPool pool( 4 );
+	GroomArchive::Settings const archiveSettings( Deflater::BestSpeed, &pool );
+	auto const filePath = GroomArchive::SerializeGroomToFile( *TheOrnatrixLibrary.grooms, *groom, "SampleGroom.oxg.zip", GroomSerializeSettings(), archiveSettings );
+	REQUIRE( filePath == "SampleGroom.oxg.zip" );
+
+	// Read by the library as well as by the SDK
+	REQUIRE( TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( filePath ) != nullptr );
+	auto const zippedGroom = GroomArchive::DeserializeGroomFromFile( *TheOrnatrixLibrary.grooms, filePath, TimeUndefined, archiveSettings );
+	REQUIRE( zippedGroom != nullptr );
+	auto const hair = TheOrnatrixLibrary.grooms->EvaluateGroom( *zippedGroom ).first;
+	REQUIRE( hair );
+	REQUIRE( hair->GetStrandCount() == 30 );
+	FileRemove( filePath );
+}
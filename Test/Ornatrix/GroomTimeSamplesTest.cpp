@@ -0,0 +1,112 @@
+#include "PrecompiledHeaders.h"
+
+#include "Utilities.h"
+#include "Ephere/Ornatrix/GroomTimeSamples.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+#include "Ephere/Ornatrix/Operators/RootGeneratorParameters.g.h"
+
+#include <cmath>
+
+using namespace Ephere;
+using namespace Ornatrix;
+using namespace std;
+
+TEST_CASE( "GroomTimeSamples" )
+{
+	static string const GroomFilePath = SampleGroomFilename + ".yaml"s;
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( GroomFilePath );
+	REQUIRE( groom != nullptr );
+	auto const rootGenParams = groom->FindNode( GuidesFromMeshNodeName )->GetOperator().GetParameterSet( RootGeneratorParameters::GetName() );
+	REQUIRE( rootGenParams );
+	rootGenParams->Set<RootGeneratorParameters::RootCount>( 50 );
+
+	auto const randomness = [&rootGenParams]
+	{
+		return rootGenParams->Get<RootGeneratorParameters::UniformDistributionRandomness>()->GetValue();
+	};
+
+	auto const savedRandomness = randomness();
+	auto const sidecarPath = GroomTimeSamples::GetSidecarPath( GroomFilePath );
+	{
+		GroomTimeSamples::Writer writer( *groom, sidecarPath, true );
+		REQUIRE( writer.IsOpen() );
+		auto writtenValueCount = 0;
+		REQUIRE( writer.AppendTimeSample( *groom, 0, &writtenValueCount ) );
+		REQUIRE( writtenValueCount == 0 );
+		rootGenParams->Set<RootGeneratorParameters::RootCount>( 60 );
+		rootGenParams->Set<RootGeneratorParameters::UniformDistributionRandomness>( savedRandomness + 1 );
+		REQUIRE( writer.AppendTimeSample( *groom, 1, &writtenValueCount ) );
+		REQUIRE( writtenValueCount == 2 );
+		rootGenParams->Set<RootGeneratorParameters::RootCount>( 50 );
+		rootGenParams->Set<RootGeneratorParameters::UniformDistributionRandomness>( savedRandomness );
+	}
+
+	SECTION( "Reader" )
+	{
+		GroomTimeSamples::Reader reader;
+		REQUIRE( reader.Open( sidecarPath ) );
+		REQUIRE( reader.GetTimes().size() == 2 );
+		REQUIRE( reader.Apply( *groom, 1.5 ) );
+		REQUIRE( rootGenParams->Get<RootGeneratorParameters::RootCount>()->GetValue() == 60 );
+		REQUIRE( abs( randomness() - ( savedRandomness + 1 ) ) < 1e-6f );
+
+		// Floating point values are interpolated, others are stepped
+		REQUIRE( reader.Apply( *groom, 0.5 ) );
+		REQUIRE( rootGenParams->Get<RootGeneratorParameters::RootCount>()->GetValue() == 50 );
+		REQUIRE( abs( randomness() - ( savedRandomness + 0.5f ) ) < 1e-6f );
+		REQUIRE( reader.Apply( *groom, -1 ) );
+		REQUIRE( randomness() == savedRandomness );
+	}
+
+	SECTION( "Samples" )
+	{
+		// The sidecar is read once, applying a time doesn't read the file again and marks the changed nodes dirty
+		GroomTimeSamples::Samples samples;
+		REQUIRE( samples.ReadSidecar( sidecarPath, *groom ) );
+		REQUIRE( samples.IsAnimated() );
+		FileRemove( sidecarPath );
+		auto* const guidesFromMeshNode = groom->FindNode( GuidesFromMeshNodeName );
+		guidesFromMeshNode->SetDirty( false, false );
+		REQUIRE( samples.Apply( *groom, 1.5 ) );
+		REQUIRE( guidesFromMeshNode->IsDirty() );
+		REQUIRE( rootGenParams->Get<RootGeneratorParameters::RootCount>()->GetValue() == 60 );
+		REQUIRE( abs( randomness() - ( savedRandomness + 1 ) ) < 1e-6f );
+		REQUIRE( samples.Apply( *groom, 0.5 ) );
+		REQUIRE( rootGenParams->Get<RootGeneratorParameters::RootCount>()->GetValue() == 50 );
+		REQUIRE( abs( randomness() - ( savedRandomness + 0.5f ) ) < 1e-6f );
+
+		guidesFromMeshNode->SetDirty( false, false );
+		REQUIRE( samples.Apply( *groom, 0.5 ) );
+		REQUIRE_FALSE( guidesFromMeshNode->IsDirty() );
+		REQUIRE( samples.Apply( *groom, -1 ) );
+		REQUIRE( randomness() == savedRandomness );
+	}
+
+	SECTION( "Deserialize" )
+	{
+		// Loading the groom at a time applies the sidecar too, and the sidecar makes the groom animated
+		auto const sampledGroom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( GroomFilePath, 1 );
+		REQUIRE( sampledGroom != nullptr );
+		REQUIRE( sampledGroom->FindNode( GuidesFromMeshNodeName )->GetOperator().GetParameterSet( RootGeneratorParameters::GetName() )
+			->Get<RootGeneratorParameters::RootCount>()->GetValue() == 60 );
+		REQUIRE( TheOrnatrixLibrary.grooms->CreateParameterTimeFunction( GroomFilePath ) );
+	}
+
+	FileRemove( sidecarPath );
+}
+
+TEST_CASE( "EvaluateGroomFileFrames" )
+{
+	// The sample groom has two time samples, its parameters are set for every frame
+	static string const GroomFilePath = SampleGroomFilename + ".yaml"s;
+	REQUIRE( TheOrnatrixLibrary.grooms->CreateParameterTimeFunction( GroomFilePath ) );
+
+	double const times[] = { 1, 2, 3 };
+	auto evaluatedFrameCount = 0;
+	REQUIRE( TheOrnatrixLibrary.grooms->EvaluateGroomFileFrames( GroomFilePath, times, [&]( int, double, Groom::GraphEvaluator const& evaluator )
+	{
+		++evaluatedFrameCount;
+		return evaluator.GetResultHair() != nullptr;
+	} ) );
+	REQUIRE( evaluatedFrameCount == 3 );
+}
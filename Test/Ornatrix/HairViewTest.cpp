@@ -0,0 +1,29 @@
+#include "PrecompiledHeaders.h"
+
+#include "Utilities.h"
+#include "Ephere/Ornatrix/IHair.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+
+using namespace Ephere;
+using namespace Ornatrix;
+using namespace std;
+
+TEST_CASE( "HairView" )
+{
+	auto const groom = TheOrnatrixLibrary.grooms->DeserializeGroomFromFile( SampleGroomFilename + ".yaml"s );
+	REQUIRE( groom != nullptr );
+	auto const hair = TheOrnatrixLibrary.grooms->EvaluateGroom( *groom ).first;
+	REQUIRE( hair );
+
+	// The view refers to the storage of the hair
+	auto const hairView = hair->ReadView();
+	REQUIRE( hairView.strandCount == 30 );
+	REQUIRE( hairView.vertices.size() == hair->GetVertexCount() );
+	REQUIRE( hairView.vertices.data() == hair->ReadVertices().data() );
+	REQUIRE( hairView.strandIds.size() == ( hair->HasStrandIds() ? 30 : 0 ) );
+	for( auto strandIndex = 0; strandIndex < hairView.strandCount; ++strandIndex )
+	{
+		REQUIRE( hairView.GetStrandVertices( strandIndex ).data() == hair->ReadVertices().data() + hair->GetStrandFirstVertexIndex( strandIndex ) );
+		REQUIRE( hairView.GetStrandVertices( strandIndex ).size() == hair->GetStrandPointCount( strandIndex ) );
+	}
+}
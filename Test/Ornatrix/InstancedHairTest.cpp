@@ -0,0 +1,68 @@
+#include "PrecompiledHeaders.h"
+
+#include "Ephere/Ornatrix/GuideRootIndex.h"
+#include "Ephere/Ornatrix/InstancedHair.h"
+#include "Ephere/Ornatrix/Ornatrix.h"
+
+using namespace Ephere;
+using namespace Geometry;
+using namespace Ornatrix;
+using namespace std;
+
+TEST_CASE( "InstancedHairExpand" )
+{
+	// Expanded instanced hair keeps the strand ids and transforms of the strands
+	Vector3f const guidePoints[] = { Vector3f( 0, 0, 0 ), Vector3f( 0, 0, 1 ) };
+	InstancedHair instancedHair( 3 );
+	instancedHair.SetGuides( 1, 2, guidePoints );
+	auto strandToObject = Xform3f::Identity();
+	GuideDependency2 const guide = { 0, 1 };
+	for( StrandId strandId = 5; strandId < 8; ++strandId )
+	{
+		strandToObject( 1, 3 ) = static_cast<float>( strandId );
+		REQUIRE( instancedHair.AddStrand( strandToObject, &guide, 1, nullptr, &strandId ) );
+	}
+
+	auto const hair = TheOrnatrixLibrary.library->CreateHair( false );
+	REQUIRE( instancedHair.Expand( *hair, 2 ) );
+	REQUIRE( hair->GetStrandCount() == 3 );
+	REQUIRE( hair->HasStrandIds() );
+	REQUIRE( hair->GetStrandId( 2 ) == 7 );
+	REQUIRE( hair->HasStrandToObjectTransforms() );
+	Xform3f transform;
+	Vector3f tip;
+	REQUIRE( hair->GetStrandToObjectTransforms( 2, 1, &transform ) );
+	REQUIRE( transform( 1, 3 ) == 7 );
+	REQUIRE( hair->GetStrandPoints( 2, 2, 1, &tip, IHair::Object ) );
+	REQUIRE( tip == Vector3f( 0, 7, 1 ) );
+
+	SECTION( "GuideRootIndex" )
+	{
+		// The roots of the expanded strands index them as guides
+		GuideRootIndex rootIndex;
+		REQUIRE( rootIndex.Update( *hair ) );
+		REQUIRE( rootIndex.GetGuideCount() == 3 );
+		GuideDependency guides;
+		REQUIRE( rootIndex.FindClosestGuides( Vector3f( 0, 6.8f, 0 ), guides ) == 3 );
+		REQUIRE( guides.closestRootIndices[0] == 2 );
+		REQUIRE_FALSE( rootIndex.Update( *hair ) );
+
+		// A guide without points is left out, the guides after it keep their indices
+		auto const sparseGuides = TheOrnatrixLibrary.library->CreateHair( true );
+		sparseGuides->SetUsesStrandTopology( true );
+		sparseGuides->SetStrandCount( 3 );
+		Vector3f const roots[] = { Vector3f( 0, 0, 0 ), Vector3f( 0, 0, 1 ), Vector3f( 5, 0, 0 ), Vector3f( 5, 0, 1 ) };
+		sparseGuides->SetVertexCount( 4 );
+		REQUIRE( sparseGuides->SetVertices( 0, 4, roots, IHair::Object ) );
+		StrandTopology const topologies[] = { { 0, 2 }, { 2, 0 }, { 2, 2 } };
+		REQUIRE( sparseGuides->SetStrandTopologies( 0, 3, topologies ) );
+		REQUIRE( rootIndex.Update( *sparseGuides ) );
+		REQUIRE( rootIndex.GetGuideCount() == 2 );
+		REQUIRE( rootIndex.FindClosestGuides( Vector3f( 4, 0, 0 ), guides ) == 2 );
+		REQUIRE( guides.closestRootIndices[0] == 2 );
+		REQUIRE( guides.closestRootIndices[1] == 0 );
+		vector<int> guidesInRadius;
+		rootIndex.FindGuidesInRadius( Vector3f( 5, 0, 0 ), 1, guidesInRadius );
+		REQUIRE( guidesInRadius == vector<int>( 1, 2 ) );
+	}
+}
@@ -5,12 +5,15 @@
 #include "Ephere/Geometry/Native/PolygonMeshUtilities.h"
 #include "Ephere/Geometry/Native/SharedNurbsCurves.h"
 #include "Ephere/Geometry/Native/Test/Utilities.h"
+#include "Ephere/Ornatrix/HairExportPipeline.h"
 #include "Ephere/Ornatrix/IHair.h"
 #include "Ephere/Ornatrix/Ornatrix.h"
 #include "Ephere/Ornatrix/ParameterComponents.h"
 #include "Ephere/Ornatrix/Operators/GroomerParameters.g.h"
 #include "Ephere/Ornatrix/Operators/GuidesFromCurvesParameters.g.h"
 
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 
 using namespace Ephere;
@@ -221,6 +224,22 @@ TEST_CASE( "UsdHairExport" )
 	REQUIRE( usdSerializer->ExportHair( &hair, options, TestAnimatedFileName ) );
 	RequireFileCrc( TestAnimatedFileName, 0x3947655a );
 	//FileRemove( TestAnimatedFileName );
+
+	static string const TestBinaryFileName = "HairCurvesAnimated.usdc";
+	REQUIRE( usdSerializer->ExportHair( &hair, options, TestBinaryFileName ) );
+	{
+		ifstream file( TestBinaryFileName, ios::binary );
+		string header( 8, '\0' );
+		file.read( &header[0], 8 );
+		REQUIRE( IUsdSerializer::IsBinaryUsdContents( header ) );
+	}
+	FileRemove( TestBinaryFileName );
+
+	// Topology and texture coordinates don't change, only their first sample is kept
+	static string const TestCompactedFileName = "HairCurvesAnimatedCompacted.usda";
+	REQUIRE( ExportHairPipelined( *usdSerializer, &hair, options, PipelinedExportOptions(), TestCompactedFileName ) );
+	REQUIRE( filesystem::file_size( TestCompactedFileName ) < filesystem::file_size( TestAnimatedFileName ) );
+	FileRemove( TestCompactedFileName );
 }
 
 using namespace Ephere;
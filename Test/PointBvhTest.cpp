@@ -0,0 +1,81 @@
+#include "Tests.h"
+
+#include "Ephere/Geometry/Native/PointBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Ephere;
+
+void TestPointBvh()
+{
+	// Compare the queries with brute force on pseudo-random points, before and after moving them
+	std::vector<Geometry::Vector3f> points( 1000 );
+	unsigned seed = 1;
+	auto const random = [&seed]
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>( seed >> 8 ) / ( 1 << 24 );
+	};
+
+	for( auto& point : points )
+	{
+		point = Geometry::Vector3f( random(), random(), random() * 0.1f );
+	}
+
+	Geometry::PointBvh<3> bvh;
+	bvh.Build( points.data(), static_cast<int>( points.size() ) );
+	for( auto pass = 0; pass < 2; ++pass )
+	{
+		for( auto query = 0; query < 50; ++query )
+		{
+			Geometry::Vector3f const position( random(), random(), random() * 0.1f );
+			std::vector<std::pair<float, int>> expected;
+			for( auto index = 0; index < static_cast<int>( points.size() ); ++index )
+			{
+				auto const difference = Geometry::Vector3f( points[index].x() - position.x(), points[index].y() - position.y(), points[index].z() - position.z() );
+				expected.push_back( std::make_pair( difference.x() * difference.x() + difference.y() * difference.y() + difference.z() * difference.z(), index ) );
+			}
+
+			std::sort( expected.begin(), expected.end() );
+
+			int indices[5];
+			float squaredDistances[5];
+			TEST( bvh.FindNearest( position, 5, indices, squaredDistances ) == 5 );
+			for( auto index = 0; index < 5; ++index )
+			{
+				TEST( squaredDistances[index] == expected[index].first );
+			}
+
+			std::vector<int> inRadius;
+			bvh.FindInRadius( position, 0.1f, inRadius );
+			auto const expectedInRadius = std::count_if( expected.begin(), expected.end(), []( std::pair<float, int> const& item )
+			{
+				return item.first <= 0.1f * 0.1f;
+			} );
+			TEST( static_cast<int>( inRadius.size() ) == expectedInRadius );
+			TEST( bvh.FindNearest( position, 3, indices, nullptr, std::sqrt( ( expected[1].first + expected[2].first ) / 2 ) ) == 2 && indices[0] == expected[0].second );
+		}
+
+		for( auto& point : points )
+		{
+			point = Geometry::Vector3f( point.x() * 2 + random() * 0.2f, point.y() - random() * 0.3f, point.z() );
+		}
+
+		TEST( bvh.Refit( points.data(), static_cast<int>( points.size() ) ) );
+	}
+
+	TEST( !bvh.Refit( points.data(), 10 ) );
+
+	// Points at an infinite squared distance are never found
+	points[0] = Geometry::Vector3f( std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() );
+	Geometry::PointBvh<3> farPoint;
+	farPoint.Build( points.data(), 1 );
+	int farIndex;
+	TEST( farPoint.FindNearest( Geometry::Vector3f( 0, 0, 0 ), 1, &farIndex ) == 0 );
+	Geometry::PointBvh<3> empty;
+	empty.Build( nullptr, 0 );
+	int index;
+	TEST( empty.FindNearest( Geometry::Vector3f( 0, 0, 0 ), 1, &index ) == 0 );
+}
@@ -0,0 +1,113 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/StrandCollision.h"
+#include "Ephere/Ornatrix/StrandRandom.h"
+
+#include <cmath>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestStrandCollision()
+{
+	// A grid of 20 x 20 quads at z = 1 above a straight strand of length 2 rotating around the x axis
+	std::vector<Geometry::Vector3f> vertices;
+	std::vector<Geometry::TriangleBvh::Triangle> triangles;
+	for( auto row = 0; row <= 20; ++row )
+	{
+		for( auto column = 0; column <= 20; ++column )
+		{
+			vertices.push_back( Geometry::Vector3f( column - 10.0f, row - 10.0f, 1 ) );
+			if( row < 20 && column < 20 )
+			{
+				auto const corner = row * 21 + column;
+				Geometry::TriangleBvh::Triangle const first = { { corner, corner + 1, corner + 22 } };
+				Geometry::TriangleBvh::Triangle const second = { { corner, corner + 22, corner + 21 } };
+				triangles.push_back( first );
+				triangles.push_back( second );
+			}
+		}
+	}
+
+	CollisionMeshIndex index;
+	TEST( index.Update( vertices.data(), static_cast<int>( vertices.size() ), triangles.data(), static_cast<int>( triangles.size() ) ) );
+	auto const& bvh = index.GetBvh();
+
+	float parameter;
+	int triangle;
+	TEST( bvh.IntersectSegment( Geometry::Vector3f( 0.25f, 0.5f, 0 ), Geometry::Vector3f( 0.25f, 0.5f, 2 ), &parameter, &triangle ) );
+	TEST( parameter == 0.5f && triangle / 2 == 10 * 20 + 10 );
+	TEST( !bvh.IntersectSegment( Geometry::Vector3f( 0, 0, 0 ), Geometry::Vector3f( 0, 0, 0.9f ) ) );
+	TEST( !bvh.IntersectSegment( Geometry::Vector3f( 11, 0, 0 ), Geometry::Vector3f( 11, 0, 2 ) ) );
+
+	// Testing a polyline at once matches testing its segments one by one
+	Geometry::Vector3f polyline[6];
+	StrandRandom random( 5, 0 );
+	for( auto test = 0; test < 200; ++test )
+	{
+		for( auto& point : polyline )
+		{
+			point = Geometry::Vector3f( random.NextFloat( -12, 12 ), random.NextFloat( -12, 12 ), random.NextFloat( 0, 2 ) );
+		}
+
+		auto expected = -1;
+		for( auto segment = 0; segment < 5 && expected < 0; ++segment )
+		{
+			expected = bvh.IntersectSegment( polyline[segment], polyline[segment + 1] ) ? segment : -1;
+		}
+
+		TEST( bvh.FindFirstIntersectingSegment( polyline, 6 ) == expected );
+	}
+
+	// Long polylines have several segments per group, a wave below the grid with its crests poking through it in a few places
+	std::vector<Geometry::Vector3f> wave( 70 );
+	for( auto test = 0; test < 50; ++test )
+	{
+		auto const phase = random.NextFloat( 0, 2 * Pif );
+		auto const height = random.NextFloat( 0.5f, 1.2f );
+		for( auto point = 0; point < 70; ++point )
+		{
+			wave[point] = Geometry::Vector3f( point * 0.3f - 10.5f, random.NextFloat( -9, 9 ), height * ( 0.5f + 0.5f * std::sin( phase + point * 0.4f ) ) );
+		}
+
+		auto expected = -1;
+		for( auto segment = 0; segment < 69 && expected < 0; ++segment )
+		{
+			expected = bvh.IntersectSegment( wave[segment], wave[segment + 1] ) ? segment : -1;
+		}
+
+		TEST( bvh.FindFirstIntersectingSegment( wave.data(), 70 ) == expected );
+	}
+
+	auto const getPoints = []( float angle, Geometry::Vector3f* points )
+	{
+		auto const radians = angle * Pif / 180;
+		for( auto point = 0; point < 5; ++point )
+		{
+			points[point] = Geometry::Vector3f( 0.25f, 0.5f * point * std::sin( radians ), 0.5f * point * std::cos( radians ) );
+		}
+	};
+
+	// The strand is free once its tip is below the grid, beyond 60 degrees, whether every step is tested or coarse steps are bisected
+	TEST( GetDefaultCollisionCoarseStep( 180, 0.25f ) == 2 && GetDefaultCollisionCoarseStep( 16, 0.25f ) == 1 && GetDefaultCollisionCoarseStep( 2, 0.25f ) == 0.25f );
+	auto angle = FindCollisionFreeAngle( bvh, 5, getPoints, 180, 0.25f, 0.25f );
+	TEST( angle >= 59.9f && angle <= 60.25f && angle == std::floor( angle * 4 ) / 4 );
+	angle = FindCollisionFreeAngle( bvh, 5, getPoints, 180, 0.25f );
+	TEST( angle >= 59.9f && angle <= 60.25f );
+	angle = FindCollisionFreeAngle( bvh, 5, getPoints, 180, 0.25f, 10 );
+	TEST( angle >= 59.9f && angle <= 60.25f );
+
+	// Moving the grid up refits the hierarchy, which then frees the strand beyond acos( 0.75 ) = 41.41 degrees
+	for( auto& vertex : vertices )
+	{
+		vertex.z() = 1.5f;
+	}
+
+	TEST( !index.Update( vertices.data(), static_cast<int>( vertices.size() ), triangles.data(), static_cast<int>( triangles.size() ) ) );
+	angle = FindCollisionFreeAngle( bvh, 5, getPoints, 180, 0.25f, 10 );
+	TEST( angle > 41.4f && angle <= 41.7f );
+	TEST( FindCollisionFreeAngle( bvh, 5, getPoints, 30, 0.25f, 10 ) == -1 );
+
+	triangles.pop_back();
+	TEST( index.Update( vertices.data(), static_cast<int>( vertices.size() ), triangles.data(), static_cast<int>( triangles.size() ) ) );
+}
@@ -0,0 +1,154 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/InstancedHair.h"
+#include "Ephere/Ornatrix/StrandInterpolation.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestStrandInterpolation()
+{
+	using namespace StrandInterpolation;
+
+	// Two straight guides of length 2 at a right angle, blended half way
+	Geometry::Vector3f const guide0[] = { Geometry::Vector3f( 0, 0, 0 ), Geometry::Vector3f( 1, 0, 0 ), Geometry::Vector3f( 2, 0, 0 ) };
+	Geometry::Vector3f const guide1[] = { Geometry::Vector3f( 0, 0, 0 ), Geometry::Vector3f( 0, 1, 0 ), Geometry::Vector3f( 0, 2, 0 ) };
+	Geometry::Vector3f const* const guides[] = { guide0, guide1, nullptr };
+	float const weights[] = { 0.5f, 0.5f, 0 };
+	auto strandToObject = Geometry::Xform3f::Zero();
+	strandToObject( 0, 0 ) = strandToObject( 1, 1 ) = strandToObject( 2, 2 ) = 1;
+	strandToObject( 2, 3 ) = 10;
+
+	Batch batch( 3 );
+	TEST( batch.Add( strandToObject, guides, weights ) == 0 );
+	Geometry::Vector3f points[3];
+	Interpolate( Method::Affine, batch );
+	batch.GetResult( 0, points );
+	TEST( points[0] == Geometry::Vector3f( 0, 0, 10 ) && points[2] == Geometry::Vector3f( 1, 1, 10 ) );
+
+	Interpolate( Method::Polar, batch );
+	batch.GetResult( 0, points );
+	TEST( std::abs( points[2].x() - std::sqrt( 2.0f ) ) < 1e-5f && std::abs( points[2].y() - std::sqrt( 2.0f ) ) < 1e-5f && points[2].z() == 10 );
+
+	Interpolate( Method::Segment, batch );
+	batch.GetResult( 0, points );
+	TEST( std::abs( points[1].x() - std::sqrt( 0.5f ) ) < 1e-5f && std::abs( points[2].y() - std::sqrt( 2.0f ) ) < 1e-5f );
+
+	// Every instruction set gives the results of the scalar code up to rounding, for full and partial batches
+	unsigned seed = 7;
+	auto const random = [&seed]
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>( seed >> 8 ) / ( 1 << 24 ) - 0.5f;
+	};
+
+	Batch randomBatch( 5 );
+	std::vector<Geometry::Vector3f> guidePoints( 3 * 5 );
+	for( auto strandCount : { static_cast<int>( Batch::LaneCount ), 11 } )
+	{
+		randomBatch.Clear();
+		for( auto strand = 0; strand < strandCount; ++strand )
+		{
+			for( auto& point : guidePoints )
+			{
+				point = Geometry::Vector3f( random(), random(), random() );
+			}
+
+			Geometry::Vector3f const* const randomGuides[] = { &guidePoints[0], &guidePoints[5], &guidePoints[10] };
+			float const randomWeights[] = { 0.2f, 0.3f, 0.5f };
+			for( auto row = 0u; row < 3; ++row )
+			{
+				for( auto column = 0u; column < 4; ++column )
+				{
+					strandToObject( row, column ) = random();
+				}
+			}
+
+			randomBatch.Add( strandToObject, randomGuides, randomWeights );
+		}
+
+		for( auto method : { Method::Polar, Method::Affine, Method::Segment } )
+		{
+			std::vector<Geometry::Vector3f> expected( 5 * strandCount ), actual( 5 * strandCount );
+			Interpolate( method, randomBatch, InstructionSet::Scalar );
+			for( auto strand = 0; strand < strandCount; ++strand )
+			{
+				randomBatch.GetResult( strand, &expected[5 * strand] );
+			}
+
+			for( auto instructionSet : { InstructionSet::Sse2, GetSupportedInstructionSet() } )
+			{
+				Interpolate( method, randomBatch, instructionSet );
+				for( auto strand = 0; strand < strandCount; ++strand )
+				{
+					randomBatch.GetResult( strand, &actual[5 * strand] );
+				}
+
+				for( auto point = 0; point < 5 * strandCount; ++point )
+				{
+					for( auto axis = 0; axis < 3; ++axis )
+					{
+						TEST( std::abs( actual[point][axis] - expected[point][axis] ) <= 1e-5f * std::max( 1.0f, std::abs( expected[point][axis] ) ) );
+					}
+				}
+			}
+		}
+	}
+}
+
+void TestInstancedHair()
+{
+	// Guides of 3 points resampled to 5, strands generated on request match the ones generated in one go
+	Geometry::Vector3f const guidePoints[] =
+	{
+		Geometry::Vector3f( 0, 0, 0 ), Geometry::Vector3f( 0, 0, 1 ), Geometry::Vector3f( 0, 0, 2 ),
+		Geometry::Vector3f( 0, 0, 0 ), Geometry::Vector3f( 1, 0, 0 ), Geometry::Vector3f( 1, 1, 0 )
+	};
+	StrandId const guideIds[] = { 10, 20 };
+
+	InstancedHair hair( 5 );
+	hair.SetGuides( 2, 3, guidePoints, guideIds );
+	TEST( hair.GetGuideCount() == 2 );
+
+	auto strandToObject = Geometry::Xform3f::Zero();
+	strandToObject( 0, 0 ) = strandToObject( 1, 1 ) = strandToObject( 2, 2 ) = 1;
+	for( auto strand = 0; strand < 40; ++strand )
+	{
+		auto const weight = strand / 39.0f;
+		GuideDependency2 const guides[] = { { 10, 1 - weight }, { 20, weight } };
+		strandToObject( 0, 3 ) = static_cast<float>( strand );
+		StrandId const strandId = 100 + strand;
+		TEST( hair.AddStrand( strandToObject, guides, 2, nullptr, &strandId ) );
+	}
+
+	GuideDependency2 const unknownGuide = { 30, 1 };
+	TEST( !hair.AddStrand( strandToObject, &unknownGuide, 1 ) );
+	TEST( hair.GetStrandCount() == 40 && hair.GetVertexCount() == 200 && !hair.HasSurfacePositions() );
+	StrandId strandIds[2];
+	TEST( hair.HasStrandIds() && hair.GetStrandIds( 38, 2, strandIds ) && strandIds[0] == 138 && strandIds[1] == 139 );
+
+	std::vector<Geometry::Vector3f> vertices( hair.GetVertexCount() );
+	TEST( hair.GetVertices( 0, hair.GetStrandCount(), vertices.data() ) );
+	TEST( vertices[1] == Geometry::Vector3f( 0, 0, 0.5f ) && vertices[4] == Geometry::Vector3f( 0, 0, 2 ) );
+	TEST( vertices[39 * 5 + 4] == Geometry::Vector3f( 40, 1, 0 ) );
+
+	Geometry::Vector3f points[2];
+	for( auto strand = 0; strand < hair.GetStrandCount(); ++strand )
+	{
+		TEST( hair.GetStrandPoints( strand, 3, 2, points ) );
+		TEST( points[0] == vertices[strand * 5 + 3] && points[1] == vertices[strand * 5 + 4] );
+	}
+
+	TEST( !hair.GetVertices( 30, 11, vertices.data() ) && !hair.GetStrandPoints( 0, 4, 2, points ) && !hair.GetStrandPoints( 40, 0, 1, points ) );
+
+	// Single strands give the same points as batches with the segment method too, which chains the points before the requested ones
+	InstancedHair segmentHair( 5, InstancedHair::Method::Segment );
+	segmentHair.SetGuides( 2, 3, guidePoints, guideIds );
+	GuideDependency2 const segmentGuides[] = { { 10, 0.3f }, { 20, 0.7f } };
+	TEST( segmentHair.AddStrand( strandToObject, segmentGuides, 2 ) && !segmentHair.HasStrandIds() );
+	TEST( segmentHair.GetVertices( 0, 1, vertices.data() ) && segmentHair.GetStrandPoints( 0, 3, 2, points ) );
+	TEST( points[0] == vertices[3] && points[1] == vertices[4] );
+}
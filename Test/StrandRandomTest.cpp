@@ -0,0 +1,68 @@
+#include "Tests.h"
+
+#include "Ephere/NativeTools/ThreadPool.h"
+#include "Ephere/Ornatrix/StrandRandom.h"
+
+#include <algorithm>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestStrandRandom()
+{
+	// Known answers from the Philox reference implementation
+	Philox4x32::Counter const zeroCounter = { { 0, 0, 0, 0 } };
+	Philox4x32::Key const zeroKey = { { 0, 0 } };
+	Philox4x32::Counter const zeroResult = { { 0x6627e8d5u, 0xe169c58du, 0xbc57ac4cu, 0x9b00dbd8u } };
+	TEST( Philox4x32::Generate( zeroCounter, zeroKey ) == zeroResult );
+
+	Philox4x32::Counter const piCounter = { { 0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u } };
+	Philox4x32::Key const piKey = { { 0xa4093822u, 0x299f31d0u } };
+	Philox4x32::Counter const piResult = { { 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u } };
+	TEST( Philox4x32::Generate( piCounter, piKey ) == piResult );
+
+	// Strands get the same numbers when processed serially or in parallel ranges
+	auto const strandCount = 10000;
+	auto const generate = []( int strand, float* values )
+	{
+		StrandRandom random( 42, static_cast<StrandId>( strand ), StrandRandom::GetStream( "Frizz" ) );
+		for( auto index = 0; index < 7; ++index )
+		{
+			values[index] = random.NextFloat();
+		}
+	};
+
+	std::vector<float> serial( strandCount * 7 ), parallel( strandCount * 7 );
+	for( auto strand = 0; strand < strandCount; ++strand )
+	{
+		generate( strand, &serial[strand * 7] );
+	}
+
+	ThreadPool pool( 4 );
+	TEST( RunTaskGraph( &pool, std::vector<std::vector<int>>( 37 ), [&]( int range )
+	{
+		for( auto strand = range * strandCount / 37; strand < ( range + 1 ) * strandCount / 37; ++strand )
+		{
+			generate( strand, &parallel[strand * 7] );
+		}
+
+		return true;
+	} ) );
+
+	TEST( serial == parallel );
+	TEST( std::all_of( serial.begin(), serial.end(), []( float value )
+	{
+		return value >= 0 && value < 1;
+	} ) );
+
+	StrandRandom random( 42, 17, StrandRandom::GetStream( "Frizz" ) );
+	random.SetPosition( 5 );
+	TEST( random.NextFloat() == serial[17 * 7 + 5] && random.GetPosition() == 6 );
+	TEST( StrandRandom( 42, 17, StrandRandom::GetStream( "Curl" ) ).NextFloat() != serial[17 * 7] );
+	TEST( StrandRandom( 43, 17, StrandRandom::GetStream( "Frizz" ) ).NextFloat() != serial[17 * 7] );
+	for( auto index = 0; index < 100; ++index )
+	{
+		auto const value = random.NextInt( 3 );
+		TEST( value >= 0 && value < 3 );
+	}
+}
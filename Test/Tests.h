@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+#define TEST( condition ) \
+	if( condition ) {} else { std::cout << "Test failed in " << __FILE__ << '(' << __LINE__ << "), message: " << #condition << '\n'; std::exit( 1 ); } void(0)
+
+// Tests of the SDK headers which don't need the Ornatrix library, one function per feature.
+// The tests using the library are in Test/Ornatrix.
+
+void TestBinaryGroomBlocks();
+
+void TestClumpAssignment();
+
+void TestEvaluationContextExtension();
+
+void TestGroomInfoProbe();
+
+void TestHairAnimationCache();
+
+void TestInstancedHair();
+
+void TestNestedTaskGraph();
+
+void TestPipelinedExport();
+
+void TestPointBvh();
+
+void TestProgressiveHairAnimationCache();
+
+void TestRunTaskGraph();
+
+void TestStrandCollision();
+
+void TestStrandInterpolation();
+
+void TestStrandQuantization();
+
+void TestStrandRandom();
+
+void TestUsdTimeSamples();
+
+void TestZipArchive();
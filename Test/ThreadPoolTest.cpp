@@ -0,0 +1,46 @@
+#include "Tests.h"
+
+#include "Ephere/NativeTools/ThreadPool.h"
+
+using namespace Ephere;
+
+void TestRunTaskGraph()
+{
+	// Diamond: 0 -> 1, 0 -> 2, 1 + 2 -> 3
+	std::vector<std::vector<int>> const predecessors = { {}, { 0 }, { 0 }, { 1, 2 } };
+	ThreadPool pool( 4 );
+	std::atomic<int> finishedMask( 0 );
+	auto const succeeded = RunTaskGraph( &pool, predecessors, [&]( int taskIndex )
+	{
+		for( auto const predecessorIndex : predecessors[taskIndex] )
+		{
+			if( ( finishedMask & ( 1 << predecessorIndex ) ) == 0 )
+			{
+				return false;
+			}
+		}
+
+		finishedMask |= 1 << taskIndex;
+		return true;
+	} );
+	TEST( succeeded && finishedMask == 15 );
+
+	std::vector<std::vector<int>> const cyclic = { {}, { 2 }, { 1 } };
+	TEST( !RunTaskGraph( &pool, cyclic, []( int ) { return true; } ) );
+}
+
+void TestNestedTaskGraph()
+{
+	// A task graph run from the tasks of another graph on the same pool, with more outer tasks than workers
+	ThreadPool pool( 2 );
+	std::atomic<int> innerTaskCount( 0 );
+	TEST( RunTaskGraph( &pool, std::vector<std::vector<int>>( 4 ), [&]( int )
+	{
+		return RunTaskGraph( &pool, std::vector<std::vector<int>>( 3, std::vector<int>() ), [&]( int )
+		{
+			++innerTaskCount;
+			return true;
+		} );
+	} ) );
+	TEST( innerTaskCount == 12 );
+}
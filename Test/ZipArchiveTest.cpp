@@ -0,0 +1,83 @@
+#include "Tests.h"
+
+#include "Ephere/Ornatrix/GroomArchive.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace Ephere;
+using namespace Ephere::Ornatrix;
+
+void TestZipArchive()
+{
+	std::string text;
+	for( auto index = 0; index < 20000; ++index )
+	{
+		text += "strand " + std::to_string( index % 97 ) + '\n';
+	}
+
+	std::vector<ZipArchiveEntryView> entries( 3 );
+	entries[0].name = "Groom.oxg.yaml";
+	entries[0].contents = std::string_view( text.data(), text.size() );
+	entries[1].name = "empty";
+	entries[2].name = "binary";
+	entries[2].contents = std::string_view( "\x01\x02\x03", 3 );
+
+	Crc32 const crc32;
+	auto const half = text.size() / 2;
+	TEST( Crc32::Combine( crc32.Update( 0, text.data(), half ), crc32.Update( 0, text.data() + half, text.size() - half ), text.size() - half )
+		== crc32.Update( 0, text.data(), text.size() ) );
+
+	ThreadPool pool( 4 );
+	for( auto level = 0; level <= Deflater::BestCompression; level += 3 )
+	{
+		std::ostringstream archive;
+		TEST( WriteZipArchive( entries, level, &pool, archive, 10000 ) );
+
+		std::vector<ZipArchiveEntry> files;
+		auto const archiveContents = archive.str();
+		TEST( ReadZipArchive( std::string_view( archiveContents.data(), archiveContents.size() ), &pool, files ) );
+		TEST( files.size() == 3 && files[0].name == "Groom.oxg.yaml" && files[0].contents == text && files[1].contents.empty() );
+		TEST( files[2].contents == "\x01\x02\x03" );
+		TEST( level == 0 || archiveContents.size() < text.size() / 2 );
+	}
+}
+
+void TestGroomInfoProbe()
+{
+	// Deflated zip archive with a texture and a YAML groom
+	static char const ZippedGroom[] =
+		"\x50\x4b\x03\x04\x14\x00\x00\x00\x08\x00\x8a\x26\x51\x5d\x83\x16\xdc\x8c\x03\x00\x00\x00\x01\x00\x00\x00\x13\x00\x00\x00\x74\x65"
+		"\x78\x74\x75\x72\x65\x73\x2f\x72\x65\x61\x64\x6d\x65\x2e\x74\x78\x74\xab\x00\x00\x50\x4b\x03\x04\x14\x00\x00\x00\x08\x00\x8a\x26"
+		"\x51\x5d\x52\x83\x98\x23\x4d\x00\x00\x00\x55\x00\x00\x00\x0d\x00\x00\x00\x54\x65\x73\x74\x2e\x6f\x78\x67\x2e\x79\x61\x6d\x6c\x53"
+		"\x8d\x74\xf4\xf5\x51\x30\xd4\x33\xe2\xd2\xd5\xd5\xe5\xca\x2f\xca\x4b\x2c\x29\xca\xac\x70\x2f\xca\xcf\xcf\x0d\x4b\x2d\x2a\xce\xcc"
+		"\xcf\xb3\x52\x30\xe6\x2a\xc9\xcc\x4d\x0d\x4e\xcc\x2d\xc8\x49\x2d\xb6\xe2\x52\x50\xd0\x55\x30\x00\x93\x86\x5c\x79\xf9\x29\x30\x21"
+		"\x45\x1b\xdf\xd4\xe2\x0c\x3b\x85\xea\x5a\x2e\x00\x50\x4b\x01\x02\x14\x03\x14\x00\x00\x00\x08\x00\x8a\x26\x51\x5d\x83\x16\xdc\x8c"
+		"\x03\x00\x00\x00\x01\x00\x00\x00\x13\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x80\x01\x00\x00\x00\x00\x74\x65\x78\x74\x75\x72"
+		"\x65\x73\x2f\x72\x65\x61\x64\x6d\x65\x2e\x74\x78\x74\x50\x4b\x01\x02\x14\x03\x14\x00\x00\x00\x08\x00\x8a\x26\x51\x5d\x52\x83\x98"
+		"\x23\x4d\x00\x00\x00\x55\x00\x00\x00\x0d\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x80\x01\x34\x00\x00\x00\x54\x65\x73\x74\x2e"
+		"\x6f\x78\x67\x2e\x79\x61\x6d\x6c\x50\x4b\x05\x06\x00\x00\x00\x00\x02\x00\x02\x00\x7c\x00\x00\x00\xac\x00\x00\x00\x00\x00";
+	{
+		std::ofstream file( "GroomInfoProbeTest.oxg.zip", std::ios::binary );
+		file.write( ZippedGroom, sizeof( ZippedGroom ) - 1 );
+	}
+
+	auto const isGroomEntry = []( std::string_view entryName )
+	{
+		return EndsWith( entryName, IGrooms::DefaultFileExtension() );
+	};
+
+	std::string prefix;
+	std::string_view header;
+	auto isComplete = true;
+	TEST( GroomInfoProbe::ReadGroomPrefix( "GroomInfoProbeTest.oxg.zip", isGroomEntry, 70, prefix, isComplete ) );
+	TEST( !isComplete && prefix.size() == 70 && StartsWith( std::string_view( prefix.data(), prefix.size() ), "%YAML 1.2" ) );
+	TEST( GroomInfoProbe::GetHeader( std::string_view( prefix.data(), prefix.size() ), isComplete, header ) );
+	TEST( EndsWith( header, "timeSamples:\n  - 0\n  - 1\n" ) );
+	TEST( !GroomInfoProbe::GetHeader( std::string_view( prefix.data(), 40 ), false, header ) );
+
+	TEST( GroomInfoProbe::ReadGroomPrefix( "GroomInfoProbeTest.oxg.zip", isGroomEntry, GroomInfoProbe::DefaultPrefixSize, prefix, isComplete ) );
+	TEST( isComplete && prefix.size() == 85 && EndsWith( std::string_view( prefix.data(), prefix.size() ), "!<Mesh> {}\n" ) );
+	std::remove( "GroomInfoProbeTest.oxg.zip" );
+}